@@ -0,0 +1,122 @@
+/**
+ * Implementation of the arena
+ *
+ * Include for std::max and std::min used to size the chunks
+ */
+#include "arena.h"
+#include <algorithm>
+
+thread_local Arena* Arena::activeArena = nullptr;
+
+Arena::~Arena() {
+    while (first) {
+        Chunk* next = first->next;
+        ::operator delete(first);
+        first = next;
+    }
+}
+
+/**
+ * Index of the smallest power of two that holds bytes, starting from 2^MIN_CLASS
+ */
+size_t Arena::sizeClass(size_t bytes) {
+    if (bytes <= (size_t(1) << MIN_CLASS)) return 0;
+    return (sizeof(unsigned long long) * 8 - __builtin_clzll(bytes - 1)) - MIN_CLASS;
+}
+
+/**
+ * Takes bytes from the current chunk, moving to the next kept chunk or adding a new one when it is full
+ */
+void* Arena::allocateFromChunks(size_t bytes) {
+    while (true) {
+        if (cursor && static_cast<size_t>(limit - cursor) >= bytes) {
+            void* block = cursor;
+            cursor += bytes;
+            return block;
+        }
+
+        if (current && current->next) {
+            current = current->next;
+        } else {
+            size_t size = std::max(current ? std::min(current->size * 2, MAX_CHUNK) : FIRST_CHUNK, bytes);
+            Chunk* chunk = static_cast<Chunk*>(::operator new(sizeof(Chunk) + size));
+            chunk->next = nullptr;
+            chunk->size = size;
+            if (current) {
+                current->next = chunk;
+            } else {
+                first = chunk;
+            }
+            current = chunk;
+        }
+
+        cursor = reinterpret_cast<char*>(current + 1);
+        limit = cursor + current->size;
+    }
+}
+
+void* Arena::allocate(size_t bytes) {
+    size_t index = sizeClass(bytes);
+    if (FreeBlock* block = freeLists[index]) {
+        freeLists[index] = block->next;
+        return block;
+    }
+    return allocateFromChunks(size_t(1) << (index + MIN_CLASS));
+}
+
+/**
+ * The block goes to the free list of its class, the memory returns to the chunks only with reset
+ */
+void Arena::deallocate(void* pointer, size_t bytes) {
+    if (!pointer) return;
+    size_t index = sizeClass(bytes);
+    FreeBlock* block = static_cast<FreeBlock*>(pointer);
+    block->next = freeLists[index];
+    freeLists[index] = block;
+}
+
+/**
+ * Forgets every allocation, keeping the first chunks (up to RETAINED_BYTES) for the next execution
+ */
+void Arena::reset() {
+    for (auto& list : freeLists) {
+        list = nullptr;
+    }
+
+    size_t kept = 0;
+    Chunk** link = &first;
+    while (*link) {
+        Chunk* chunk = *link;
+        if (kept + chunk->size <= RETAINED_BYTES) {
+            kept += chunk->size;
+            link = &chunk->next;
+        } else {
+            *link = chunk->next;
+            ::operator delete(chunk);
+        }
+    }
+
+    current = first;
+    cursor = first ? reinterpret_cast<char*>(first + 1) : nullptr;
+    limit = first ? cursor + first->size : nullptr;
+}
+
+/**
+ * The arena of the calling thread
+ */
+Arena& Arena::local() {
+    static thread_local Arena arena;
+    return arena;
+}
+
+ArenaScope::ArenaScope(Arena& scopeArena) : arena(scopeArena), previous(Arena::activeArena) {
+    Arena::activeArena = &arena;
+    arena.users++;
+}
+
+ArenaScope::~ArenaScope() {
+    if (--arena.users == 0) {
+        arena.reset();
+    }
+    Arena::activeArena = previous;
+}
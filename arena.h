@@ -0,0 +1,161 @@
+/**
+ * Guard Headers
+ */
+#ifndef ARENA_H
+#define ARENA_H
+
+/**
+ * Include for size_t used for sizes
+ *
+ * Include for std::bad_alloc and ::operator new used when no arena is active
+ */
+#include <cstddef>
+#include <new>
+
+/**
+ * Memory of the values of one execution (list buffers and dictionary tables)
+ *
+ * Memory is taken from large chunks chained together, a new chunk (twice as large as the previous one up to
+ * MAX_CHUNK, or as large as the request) is added when the current one is full
+ *
+ * Sizes are rounded up to a power of two (size class), a freed block goes to the free list of its class
+ * and is reused by the next allocation of the same class: a list that doubles its buffer leaves the old one
+ * to the next list that reaches that size
+ *
+ * At the end of the execution everything is released in one operation (reset): the free lists are emptied
+ * and allocation starts again from the first chunk, the chunks are kept (up to RETAINED_BYTES) for the next
+ * execution on the same thread, so a worker running many scripts stops calling the system allocator
+ *
+ * Every thread has its own arena (local), which is used while at least one ArenaScope is open on it;
+ * an arena is never shared between threads, so it needs no locks (a green thread has its own arena too,
+ * which moves with it from one worker to another but is used by one of them at a time)
+ */
+class Arena {
+private:
+    struct Chunk {
+        Chunk* next;
+        size_t size;
+    };
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    static constexpr size_t FIRST_CHUNK = 64 * 1024;
+    static constexpr size_t MAX_CHUNK = 64 * 1024 * 1024;
+    static constexpr size_t RETAINED_BYTES = 64 * 1024 * 1024;
+    static constexpr size_t MIN_CLASS = 4;
+    static constexpr size_t CLASSES = 48;
+
+    Chunk* first = nullptr;
+    Chunk* current = nullptr;
+    char* cursor = nullptr;
+    char* limit = nullptr;
+
+    FreeBlock* freeLists[CLASSES] = {};
+
+    size_t users = 0;
+
+    static thread_local Arena* activeArena;
+
+    static size_t sizeClass(size_t bytes);
+
+    void* allocateFromChunks(size_t bytes);
+
+    friend class ArenaScope;
+
+public:
+    Arena() = default;
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t bytes);
+    void deallocate(void* pointer, size_t bytes);
+
+    void reset();
+
+    static Arena& local();
+
+    /**
+     * Size of the block given for a request of bytes, the whole block can be used
+     */
+    static size_t blockSize(size_t bytes) {
+        return size_t(1) << (sizeClass(bytes) + MIN_CLASS);
+    }
+
+    static Arena* active() {
+        return activeArena;
+    }
+
+    /**
+     * Makes arena (or none) the active one of the thread and returns the previous one, without opening a scope:
+     * used by the Scheduler to switch the arena together with the green thread that runs on the thread
+     */
+    static Arena* exchangeActive(Arena* arena) {
+        Arena* previous = activeArena;
+        activeArena = arena;
+        return previous;
+    }
+};
+
+/**
+ * Makes an arena the active one of the thread until the end of the scope
+ *
+ * Scopes can be nested (also on the same arena); when the last scope of an arena closes, the arena is reset,
+ * so every value allocated in it must have been destroyed by then
+ */
+class ArenaScope {
+private:
+    Arena& arena;
+    Arena* previous;
+
+public:
+    explicit ArenaScope(Arena& scopeArena);
+    ~ArenaScope();
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+};
+
+/**
+ * Allocator of the containers of the values (List, dictionary tables)
+ *
+ * It has no state: memory comes from the active arena of the thread, or from the heap when there is none.
+ * A block must be freed with the same arena active as when it was allocated, which holds because
+ * values are created and destroyed inside the execution that uses them
+ */
+template<typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    ArenaAllocator() noexcept = default;
+
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>&) noexcept {}
+
+    T* allocate(size_t count) {
+        if (Arena* arena = Arena::active()) {
+            return static_cast<T*>(arena->allocate(count * sizeof(T)));
+        }
+        return static_cast<T*>(::operator new(count * sizeof(T)));
+    }
+
+    void deallocate(T* pointer, size_t count) noexcept {
+        if (Arena* arena = Arena::active()) {
+            arena->deallocate(pointer, count * sizeof(T));
+            return;
+        }
+        ::operator delete(pointer);
+    }
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U>&) const noexcept { return true; }
+
+    template<typename U>
+    bool operator!=(const ArenaAllocator<U>&) const noexcept { return false; }
+};
+
+#endif // ARENA_H
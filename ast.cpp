@@ -28,6 +28,14 @@ void ListAccess::accept(ASTVisitor& visitor) {
     visitor.visit(*this);
 }
 
+void MatrixAccess::accept(ASTVisitor& visitor) {
+    visitor.visit(*this);
+}
+
+void Length::accept(ASTVisitor& visitor) {
+    visitor.visit(*this);
+}
+
 void UnaryOperation::accept(ASTVisitor& visitor) {
     visitor.visit(*this);
 }
@@ -53,14 +61,42 @@ void ListAssignment::accept(ASTVisitor& visitor) {
     visitor.visit(*this);
 }
 
+void MatrixAssignment::accept(ASTVisitor& visitor) {
+    visitor.visit(*this);
+}
+
+void MultipleAssignment::accept(ASTVisitor& visitor) {
+    visitor.visit(*this);
+}
+
 void ListCreation::accept(ASTVisitor& visitor) {
     visitor.visit(*this);
 }
 
+void DictCreation::accept(ASTVisitor& visitor) {
+    visitor.visit(*this);
+}
+
+void MatrixCreation::accept(ASTVisitor& visitor) {
+    visitor.visit(*this);
+}
+
 void ListAppend::accept(ASTVisitor& visitor) {
     visitor.visit(*this);
 }
 
+void ListBulkAppend::accept(ASTVisitor& visitor) {
+    visitor.visit(*this);
+}
+
+void ListLoad::accept(ASTVisitor& visitor) {
+    visitor.visit(*this);
+}
+
+void ListSave::accept(ASTVisitor& visitor) {
+    visitor.visit(*this);
+}
+
 void PrintStatement::accept(ASTVisitor& visitor) {
     visitor.visit(*this);
 }
@@ -121,6 +157,8 @@ std::string BinaryOperation::toString() const {
         case Operator::NOT_EQUAL: opStr = " != "; break;
         case Operator::AND: opStr = " and "; break;
         case Operator::OR: opStr = " or "; break;
+        case Operator::IN: opStr = " in "; break;
+        case Operator::NOT_IN: opStr = " not in "; break;
     }
     return "(" + left->toString() + opStr + right->toString() + ")";
 }
@@ -140,4 +178,26 @@ std::string IfStatement::toString() const {
     }
     
     return result;
-}
\ No newline at end of file
+}
+/**
+ * Return a string with the targets and the values separated by commas
+ */
+std::string MultipleAssignment::toString() const {
+    std::string result;
+    
+    for (size_t i = 0; i < targets.size(); i++) {
+        if (i > 0) result += ", ";
+        result += targets[i].name;
+        if (targets[i].index) result += "[" + targets[i].index->toString() + "]";
+        if (targets[i].column) result += "[" + targets[i].column->toString() + "]";
+    }
+    
+    result += " = ";
+    
+    for (size_t i = 0; i < values.size(); i++) {
+        if (i > 0) result += ", ";
+        result += values[i]->toString();
+    }
+    
+    return result;
+}
@@ -14,10 +14,13 @@
  * Memory: for smart pointers (unique_ptr)
  * 
  * String: to handle strings
+ * 
+ * FastDivisor: cached magic number of the divisions by an invariant divisor
  */
 #include <vector>
 #include <memory>
 #include <string>
+#include "fastdiv.h"
 
 /**
  * Advance Declaration so that in case I can use it before having declared it 
@@ -148,6 +151,51 @@ public:
     }
 };
 
+/**
+ * AST node to read a cell of a matrix (m[i][j], grid[r + 1][c], ...)
+ * 
+ * Inherits from Expression by polymorphism
+ * 
+ * Stores matrix name as string and the row and column expressions
+ */
+class MatrixAccess : public Expression {
+public:
+    std::string matrixName;
+    std::unique_ptr<Expression> row;
+    std::unique_ptr<Expression> column;
+    
+    MatrixAccess(const std::string& name, std::unique_ptr<Expression> r, std::unique_ptr<Expression> c)
+        : matrixName(name), row(std::move(r)), column(std::move(c)) {
+        dataType = DataType::INTEGER;
+    }
+    
+    void accept(ASTVisitor& visitor) override;
+    std::string toString() const override {
+        return matrixName + "[" + row->toString() + "][" + column->toString() + "]";
+    }
+};
+
+/**
+ * AST node for the length of a list or dictionary (len(x), len(d), ...)
+ * 
+ * Inherits from Expression by polymorphism
+ * 
+ * Stores the expression whose length is computed
+ */
+class Length : public Expression {
+public:
+    std::unique_ptr<Expression> operand;
+    
+    Length(std::unique_ptr<Expression> expr) : operand(std::move(expr)) {
+        dataType = DataType::INTEGER;
+    }
+    
+    void accept(ASTVisitor& visitor) override;
+    std::string toString() const override {
+        return "len(" + operand->toString() + ")";
+    }
+};
+
 /**
 * AST node for unary operations (-x, not x)
 *
@@ -179,7 +227,10 @@ public:
  * 
  * Stores left operand, operator and right operand
  * 
- * +, -, *, /, <, >, >=, <=, ==, !?, and, or
+ * +, -, *, /, <, >, >=, <=, ==, !?, and, or, in, not in
+ * 
+ * invariantDivisor is set by the Optimizer on divisions whose divisor is constant or loop invariant,
+ * they are executed with the magic number stored in divisor
  */
 class BinaryOperation : public Expression {
 public:
@@ -195,12 +246,17 @@ public:
         EQUAL,          
         NOT_EQUAL,      
         AND,    
-        OR       
+        OR,
+        IN,
+        NOT_IN
     };
     
     std::unique_ptr<Expression> left;
     Operator op;
     std::unique_ptr<Expression> right;
+
+    bool invariantDivisor = false;
+    FastDivisor divisor;
     
     BinaryOperation(std::unique_ptr<Expression> l, Operator operation, std::unique_ptr<Expression> r)
         : left(std::move(l)), op(operation), right(std::move(r)) {}
@@ -267,14 +323,67 @@ public:
     }
 };
 
+/**
+ * AST node for matrix assignment (m[i][j] = expr, grid[0][0] = 1, ...)
+ * 
+ * Stores matrix name, row and column expressions and value expression
+ */
+class MatrixAssignment : public Statement {
+public:
+    std::string matrixName;
+    std::unique_ptr<Expression> row;
+    std::unique_ptr<Expression> column;
+    std::unique_ptr<Expression> value;
+    
+    MatrixAssignment(const std::string& name, std::unique_ptr<Expression> r, std::unique_ptr<Expression> c,
+                     std::unique_ptr<Expression> val)
+        : matrixName(name), row(std::move(r)), column(std::move(c)), value(std::move(val)) {}
+    
+    void accept(ASTVisitor& visitor) override;
+    std::string toString() const override {
+        return matrixName + "[" + row->toString() + "][" + column->toString() + "] = " + value->toString();
+    }
+};
+
+/**
+ * AST node for tuple assignment (a, b = b, a + b, v[i], v[j] = v[j], v[i], ...)
+ * 
+ * Stores the targets, each one a variable or an element (index is null for a variable,
+ * column is set only for a cell of a matrix), and one value expression per target
+ * 
+ * All the values are evaluated before the first target is assigned, like in Python
+ */
+class MultipleAssignment : public Statement {
+public:
+    struct Target {
+        std::string name;
+        std::unique_ptr<Expression> index;
+        std::unique_ptr<Expression> column;
+        
+        Target(const std::string& n, std::unique_ptr<Expression> idx, std::unique_ptr<Expression> col = nullptr)
+            : name(n), index(std::move(idx)), column(std::move(col)) {}
+    };
+    
+    std::vector<Target> targets;
+    std::vector<std::unique_ptr<Expression>> values;
+    
+    void accept(ASTVisitor& visitor) override;
+    std::string toString() const override;
+};
+
 /**
  * AST node for list creation (x = list())
  * 
  * Stores the variable name
+ * 
+ * recycleBuffer is set by the Optimizer on creations inside a loop, when the variable already holds
+ * a list its elements are destroyed and its buffer is kept for the new list
  */
 class ListCreation : public Statement {
 public:
     std::string variableName;
+
+    bool recycleBuffer = false;
     
     ListCreation(const std::string& name) : variableName(name) {}
     
@@ -284,6 +393,43 @@ public:
     }
 };
 
+/**
+ * AST node for dictionary creation (x = dict())
+ * 
+ * Stores the variable name
+ */
+class DictCreation : public Statement {
+public:
+    std::string variableName;
+    
+    DictCreation(const std::string& name) : variableName(name) {}
+    
+    void accept(ASTVisitor& visitor) override;
+    std::string toString() const override {
+        return variableName + " = dict()";
+    }
+};
+
+/**
+ * AST node for matrix creation (x = matrix(rows, cols))
+ * 
+ * Stores the variable name and the expressions of the dimensions
+ */
+class MatrixCreation : public Statement {
+public:
+    std::string variableName;
+    std::unique_ptr<Expression> rows;
+    std::unique_ptr<Expression> columns;
+    
+    MatrixCreation(const std::string& name, std::unique_ptr<Expression> r, std::unique_ptr<Expression> c)
+        : variableName(name), rows(std::move(r)), columns(std::move(c)) {}
+    
+    void accept(ASTVisitor& visitor) override;
+    std::string toString() const override {
+        return variableName + " = matrix(" + rows->toString() + ", " + columns->toString() + ")";
+    }
+};
+
 /**
  * AST node for appending to a list (x.append(10))
  * 
@@ -303,6 +449,66 @@ public:
     }
 };
 
+/**
+ * AST node for a run of appends of literal values to the same list
+ * 
+ * v.append(1)
+ * v.append(2)
+ * v.append(3)
+ * 
+ * The parser collapses the run into a single node holding the packed literals (booleans are stored as 0/1),
+ * so generated scripts with thousands of appends are executed with one lookup and one reserve
+ */
+class ListBulkAppend : public Statement {
+public:
+    std::string listName;
+    DataType elementType;
+    std::vector<int> values;
+    
+    ListBulkAppend(const std::string& name, DataType type) : listName(name), elementType(type) {}
+    
+    void accept(ASTVisitor& visitor) override;
+    std::string toString() const override {
+        return listName + ".append(...) x " + std::to_string(values.size());
+    }
+};
+
+/**
+ * AST node for loading a list of integers from a binary file (x = load_ints("data.bin"))
+ * 
+ * Stores the variable name and the file path
+ */
+class ListLoad : public Statement {
+public:
+    std::string variableName;
+    std::string path;
+    
+    ListLoad(const std::string& name, const std::string& file) : variableName(name), path(file) {}
+    
+    void accept(ASTVisitor& visitor) override;
+    std::string toString() const override {
+        return variableName + " = load_ints(\"" + path + "\")";
+    }
+};
+
+/**
+ * AST node for saving a list of integers to a binary file (save_ints(x, "data.bin"))
+ * 
+ * Stores the list name and the file path
+ */
+class ListSave : public Statement {
+public:
+    std::string listName;
+    std::string path;
+    
+    ListSave(const std::string& name, const std::string& file) : listName(name), path(file) {}
+    
+    void accept(ASTVisitor& visitor) override;
+    std::string toString() const override {
+        return "save_ints(" + listName + ", \"" + path + "\")";
+    }
+};
+
 /**
  * AST node for printing (print(x), print (10))
  * 
@@ -429,14 +635,23 @@ public:
     virtual void visit(BooleanLiteral& node) = 0;
     virtual void visit(Identifier& node) = 0;
     virtual void visit(ListAccess& node) = 0;
+    virtual void visit(MatrixAccess& node) = 0;
+    virtual void visit(Length& node) = 0;
     virtual void visit(UnaryOperation& node) = 0;
     virtual void visit(BinaryOperation& node) = 0;
     
     // Istruzioni
     virtual void visit(Assignment& node) = 0;
     virtual void visit(ListAssignment& node) = 0;
+    virtual void visit(MatrixAssignment& node) = 0;
+    virtual void visit(MultipleAssignment& node) = 0;
     virtual void visit(ListCreation& node) = 0;
+    virtual void visit(DictCreation& node) = 0;
+    virtual void visit(MatrixCreation& node) = 0;
     virtual void visit(ListAppend& node) = 0;
+    virtual void visit(ListBulkAppend& node) = 0;
+    virtual void visit(ListLoad& node) = 0;
+    virtual void visit(ListSave& node) = 0;
     virtual void visit(PrintStatement& node) = 0;
     virtual void visit(BreakStatement& node) = 0;
     virtual void visit(ContinueStatement& node) = 0;
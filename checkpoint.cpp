@@ -0,0 +1,393 @@
+/**
+ * Implementation of the checkpoints
+ *
+ * Include for FileSink used to write the file in large blocks
+ *
+ * Include for std::memcpy used to copy the fields and the packed integers
+ *
+ * Include for std::rename and std::remove used to replace the previous checkpoint
+ *
+ * Include for std::runtime_error used for the files that cannot be read
+ *
+ * Include for std::min used to split the lists into chunks
+ *
+ * Include for std::ifstream used to read the header of the checkpoint
+ *
+ * Include for the POSIX primitives used to map the file (open, fstat, mmap)
+ */
+#include "checkpoint.h"
+#include "output.h"
+#include <cstring>
+#include <cstdio>
+#include <stdexcept>
+#include <algorithm>
+#include <fstream>
+#include <fcntl.h>
+
+#ifdef _WIN32
+#include <iterator>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * "PYCKPT02" read as a 64-bit integer, a file written on a machine with the other byte order does not match
+ */
+static const uint64_t MAGIC = 0x3230545043594850ULL;
+
+/**
+ * Elements of a list packed together (256 KiB of ints), a chunk with another type is written element by element
+ */
+static const size_t PACK_CHUNK = 1 << 16;
+
+// ================= WRITE =================
+
+template<typename T>
+static void writeField(FileSink& file, T field) {
+    file.write(reinterpret_cast<const char*>(&field), sizeof(T));
+}
+
+static void writeValue(FileSink& file, const Value& value);
+
+/**
+ * Writes the length and the chunks of the list, packing the integers of a chunk into ints until an element
+ * of another type shows that the chunk must be written one value at a time
+ */
+static void writeList(FileSink& file, const List& list) {
+    writeField(file, static_cast<uint64_t>(list.size()));
+
+    std::vector<int32_t> packed(std::min(list.size(), PACK_CHUNK));
+    for (size_t start = 0; start < list.size(); start += PACK_CHUNK) {
+        size_t count = std::min(PACK_CHUNK, list.size() - start);
+        const Value* elements = list.data() + start;
+
+        size_t i = 0;
+        while (i < count && elements[i].type == Value::INTEGER) {
+            packed[i] = *std::get_if<int>(&elements[i].data);
+            i++;
+        }
+
+        if (i == count) {
+            writeField(file, static_cast<uint8_t>(1));
+            file.write(reinterpret_cast<const char*>(packed.data()), count * sizeof(int32_t));
+        } else {
+            writeField(file, static_cast<uint8_t>(0));
+            for (size_t j = 0; j < count; j++) {
+                writeValue(file, elements[j]);
+            }
+        }
+    }
+}
+
+static void writeValue(FileSink& file, const Value& value) {
+    writeField(file, static_cast<uint8_t>(value.type));
+    switch (value.type) {
+        case Value::INTEGER:
+            writeField(file, static_cast<int32_t>(value.getInt()));
+            return;
+        case Value::BOOLEAN:
+            writeField(file, static_cast<uint8_t>(value.getBool() ? 1 : 0));
+            return;
+        case Value::LIST:
+            writeList(file, value.getList());
+            return;
+        case Value::DICT: {
+            const auto& entries = value.getDict().items();
+            writeField(file, static_cast<uint64_t>(entries.size()));
+            for (const auto& entry : entries) {
+                writeValue(file, Dict::decodeKey(entry.key));
+                writeValue(file, entry.value);
+            }
+            return;
+        }
+        case Value::MATRIX: {
+            const auto& matrix = value.getMatrix();
+            writeField(file, static_cast<int32_t>(matrix.rows()));
+            writeField(file, static_cast<int32_t>(matrix.columns()));
+            if (matrix.rows() > 0 && matrix.columns() > 0) {
+                size_t cells = static_cast<size_t>(matrix.rows()) * static_cast<size_t>(matrix.columns());
+                file.write(reinterpret_cast<const char*>(matrix.row(0)), cells * sizeof(int32_t));
+            }
+            return;
+        }
+        case Value::UNDEFINED:
+            return;
+    }
+}
+
+void saveCheckpoint(const std::string& path, uint64_t source, uint64_t outputBytes, const ResumePath& position,
+                    const std::unordered_map<std::string, Value>& variables) {
+    std::string temporary = path + ".tmp";
+    {
+        FileSink file(temporary);
+        writeField(file, MAGIC);
+        writeField(file, source);
+        writeField(file, outputBytes);
+
+        writeField(file, static_cast<uint64_t>(position.size()));
+        for (size_t index : position) {
+            writeField(file, static_cast<uint64_t>(index));
+        }
+
+        writeField(file, static_cast<uint64_t>(variables.size()));
+        for (const auto& [name, value] : variables) {
+            writeField(file, static_cast<uint32_t>(name.size()));
+            file.write(name.data(), name.size());
+            writeValue(file, value);
+        }
+        file.close();
+    }
+
+#ifdef _WIN32
+    std::remove(path.c_str());
+#endif
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Cannot write checkpoint file " + path);
+    }
+}
+
+// ================= READ =================
+
+/**
+ * Bytes of the checkpoint still to decode, every read checks that they are enough
+ */
+struct CheckpointReader {
+    const char* cursor;
+    const char* end;
+    const std::string& path;
+
+    void read(void* field, size_t size) {
+        require(size);
+        std::memcpy(field, cursor, size);
+        cursor += size;
+    }
+
+    template<typename T>
+    T field() {
+        T value;
+        read(&value, sizeof(T));
+        return value;
+    }
+
+    void require(size_t size) const {
+        if (static_cast<size_t>(end - cursor) < size) fail();
+    }
+
+    [[noreturn]] void fail() const {
+        throw std::runtime_error("Invalid checkpoint file " + path);
+    }
+};
+
+static Value readValue(CheckpointReader& in);
+
+/**
+ * Reads the chunks of a list, a packed chunk is converted with one pass over its ints
+ */
+static List readList(CheckpointReader& in) {
+    uint64_t size = in.field<uint64_t>();
+    in.require(size);
+
+    List list;
+    list.reserve(static_cast<size_t>(size));
+    for (uint64_t start = 0; start < size; start += PACK_CHUNK) {
+        size_t count = static_cast<size_t>(std::min<uint64_t>(PACK_CHUNK, size - start));
+        uint8_t packed = in.field<uint8_t>();
+        if (packed == 1) {
+            in.require(count * sizeof(int32_t));
+            for (size_t i = 0; i < count; i++) {
+                int32_t n;
+                std::memcpy(&n, in.cursor + i * sizeof(int32_t), sizeof(int32_t));
+                list.push_back(Value(static_cast<int>(n)));
+            }
+            in.cursor += count * sizeof(int32_t);
+        } else if (packed == 0) {
+            for (size_t i = 0; i < count; i++) {
+                list.push_back(readValue(in));
+            }
+        } else {
+            in.fail();
+        }
+    }
+    return list;
+}
+
+static Value readValue(CheckpointReader& in) {
+    switch (in.field<uint8_t>()) {
+        case Value::INTEGER:
+            return Value(static_cast<int>(in.field<int32_t>()));
+        case Value::BOOLEAN:
+            return Value(in.field<uint8_t>() != 0);
+        case Value::LIST:
+            return Value(readList(in));
+        case Value::DICT: {
+            uint64_t size = in.field<uint64_t>();
+            Dict dict;
+            for (uint64_t i = 0; i < size; i++) {
+                Value key = readValue(in);
+                if (key.type != Value::INTEGER && key.type != Value::BOOLEAN) in.fail();
+                dict[key] = readValue(in);
+            }
+            return Value(std::move(dict));
+        }
+        case Value::MATRIX: {
+            int32_t rows = in.field<int32_t>();
+            int32_t columns = in.field<int32_t>();
+            if (rows < 0 || columns < 0) in.fail();
+            size_t cells = static_cast<size_t>(rows) * static_cast<size_t>(columns);
+            in.require(cells * sizeof(int32_t));
+            Matrix matrix(rows, columns);
+            if (cells > 0) {
+                std::memcpy(&matrix.at(0, 0), in.cursor, cells * sizeof(int32_t));
+            }
+            in.cursor += cells * sizeof(int32_t);
+            return Value(std::move(matrix));
+        }
+        case Value::UNDEFINED:
+            return Value();
+        default:
+            in.fail();
+    }
+}
+
+/**
+ * Checks the magic and the source hash, returns the bytes printed
+ */
+static uint64_t decodeHeader(CheckpointReader& in, uint64_t source) {
+    if (in.field<uint64_t>() != MAGIC) in.fail();
+    if (in.field<uint64_t>() != source) {
+        throw std::runtime_error("Checkpoint file " + in.path + " belongs to a different program");
+    }
+    return in.field<uint64_t>();
+}
+
+/**
+ * Decodes the whole file, the variables are replaced only once every field has been read
+ */
+static ResumePath decodeCheckpoint(CheckpointReader& in, uint64_t source,
+                                   std::unordered_map<std::string, Value>& variables, uint64_t& outputBytes) {
+    uint64_t printed = decodeHeader(in, source);
+
+    uint64_t depth = in.field<uint64_t>();
+    in.require(depth * sizeof(uint64_t));
+    ResumePath position;
+    for (uint64_t i = 0; i < depth; i++) {
+        position.push_back(static_cast<size_t>(in.field<uint64_t>()));
+    }
+
+    uint64_t count = in.field<uint64_t>();
+    std::unordered_map<std::string, Value> loaded;
+    for (uint64_t i = 0; i < count; i++) {
+        uint32_t length = in.field<uint32_t>();
+        in.require(length);
+        std::string name(in.cursor, length);
+        in.cursor += length;
+        loaded[name] = readValue(in);
+    }
+    if (in.cursor != in.end) in.fail();
+
+    variables = std::move(loaded);
+    outputBytes = printed;
+    return position;
+}
+
+ResumePath loadCheckpoint(const std::string& path, uint64_t source, std::unordered_map<std::string, Value>& variables,
+                          uint64_t& outputBytes) {
+#ifdef _WIN32
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open checkpoint file " + path);
+    }
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    CheckpointReader in{content.data(), content.data() + content.size(), path};
+    return decodeCheckpoint(in, source, variables, outputBytes);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open checkpoint file " + path);
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        throw std::runtime_error("Invalid checkpoint file " + path);
+    }
+
+    size_t size = static_cast<size_t>(info.st_size);
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("Cannot open checkpoint file " + path);
+    }
+    madvise(mapped, size, MADV_SEQUENTIAL);
+
+    const char* bytes = static_cast<const char*>(mapped);
+    CheckpointReader in{bytes, bytes + size, path};
+    try {
+        ResumePath position = decodeCheckpoint(in, source, variables, outputBytes);
+        munmap(mapped, size);
+        return position;
+    } catch (...) {
+        munmap(mapped, size);
+        throw;
+    }
+#endif
+}
+
+uint64_t checkpointOutputBytes(const std::string& path, uint64_t source) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open checkpoint file " + path);
+    }
+    char header[3 * sizeof(uint64_t)];
+    file.read(header, sizeof(header));
+    CheckpointReader in{header, header + file.gcount(), path};
+    return decodeHeader(in, source);
+}
+
+// ================= POSITIONS =================
+
+static void findLoopPositions(Statement& stmt, ResumePath& path,
+                              std::unordered_map<const WhileStatement*, ResumePath>& positions) {
+    if (auto block = dynamic_cast<Block*>(&stmt)) {
+        path.push_back(0);
+        for (size_t i = 0; i < block->statements.size(); i++) {
+            path.back() = i;
+            findLoopPositions(*block->statements[i], path, positions);
+        }
+        path.pop_back();
+    } else if (auto ifStmt = dynamic_cast<IfStatement*>(&stmt)) {
+        path.push_back(0);
+        findLoopPositions(*ifStmt->thenBlock, path, positions);
+        for (size_t i = 0; i < ifStmt->elifClauses.size(); i++) {
+            path.back() = i + 1;
+            findLoopPositions(*ifStmt->elifClauses[i].body, path, positions);
+        }
+        if (ifStmt->elseBlock) {
+            path.back() = ifStmt->elifClauses.size() + 1;
+            findLoopPositions(*ifStmt->elseBlock, path, positions);
+        }
+        path.pop_back();
+    } else if (auto loop = dynamic_cast<WhileStatement*>(&stmt)) {
+        positions[loop] = path;
+        findLoopPositions(*loop->body, path, positions);
+    }
+}
+
+std::unordered_map<const WhileStatement*, ResumePath> findLoopPositions(Program& program) {
+    std::unordered_map<const WhileStatement*, ResumePath> positions;
+    ResumePath path(1);
+    for (size_t i = 0; i < program.statements.size(); i++) {
+        path[0] = i;
+        findLoopPositions(*program.statements[i], path, positions);
+    }
+    return positions;
+}
+
+bool isLoopPosition(Program& program, const ResumePath& position) {
+    for (const auto& [loop, path] : findLoopPositions(program)) {
+        if (path == position) return true;
+    }
+    return false;
+}
@@ -0,0 +1,77 @@
+/**
+ * Guard Headers
+ */
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+/**
+ * Include for AST definitions, the position is a path in the Program
+ *
+ * Include for ResumePath used for the position
+ *
+ * Include for Value, the variables are saved with their values
+ *
+ * Include for std::string and std::unordered_map used for file names and the variables
+ *
+ * Include for uint64_t used for the hash of the source
+ */
+#include "ast.h"
+#include "compiler.h"
+#include "value.h"
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+
+/**
+ * Checkpoints of a running program (--checkpoint-every=SECONDS, --resume=FILE)
+ *
+ * A checkpoint is taken at the back-edge of a loop, where the whole state of the program is its variables
+ * and the loop that is about to check its condition: every enclosing statement is an ancestor of the loop
+ * in the AST (there are no functions), so the position is the path of the loop from the root of the Program,
+ * one element for the index of the top level statement followed by a ResumePath
+ *
+ * The file is binary, in the byte order of the machine:
+ *
+ *     magic, hash of the source, bytes printed, position (count and indices), variables (count, then name and value of each)
+ *
+ * The bytes printed are the whole output of the program up to the checkpoint (of the first run and of every
+ * resumed one): with --output the file is cut back to them on resume, dropping what was printed after the checkpoint
+ *
+ * A value is its type followed by the payload; a list is its length followed by chunks of up to PACK_CHUNK
+ * elements, a chunk of integers is one flag byte and the packed 32-bit ints, written and read with bulk copies,
+ * any other chunk holds one value per element; the cells of a matrix are already packed and are copied as they are
+ */
+
+/**
+ * Writes the checkpoint to a temporary file next to path and then renames it over path,
+ * so a job stopped while writing still has the previous checkpoint
+ */
+void saveCheckpoint(const std::string& path, uint64_t source, uint64_t outputBytes, const ResumePath& position,
+                    const std::unordered_map<std::string, Value>& variables);
+
+/**
+ * Reads the checkpoint of the program whose source has that hash: fills the variables and the bytes printed
+ * and returns the position
+ *
+ * Throws std::runtime_error if the file cannot be read, is not a checkpoint or belongs to another program
+ */
+ResumePath loadCheckpoint(const std::string& path, uint64_t source, std::unordered_map<std::string, Value>& variables,
+                          uint64_t& outputBytes);
+
+/**
+ * Reads only the header of the checkpoint and returns the bytes printed, the output file is prepared
+ * with them before the program starts; throws like loadCheckpoint
+ */
+uint64_t checkpointOutputBytes(const std::string& path, uint64_t source);
+
+/**
+ * Position of every loop of the program, nested ones included
+ */
+std::unordered_map<const WhileStatement*, ResumePath> findLoopPositions(Program& program);
+
+/**
+ * True if position is the position of a loop of the program
+ */
+bool isLoopPosition(Program& program, const ResumePath& position);
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,1239 @@
+/**
+ * Implementation of the loops compiled into closures
+ *
+ * Include for the Interpreter, used for the fallbacks, the variables and the counters
+ *
+ * Include for CountedLoop, the loops compiled in two versions
+ *
+ * Include for std::vector and std::pair used for the statements of a block, the elif clauses and the assignments
+ */
+#include "compiler.h"
+#include "interpreter.h"
+#include "optimizer.h"
+#include <vector>
+#include <utility>
+
+/**
+ * Compiles the loop, the first execution happens with run()
+ *
+ * The loop is compiled for the types of the variables at this moment, which is the moment it is entered,
+ * without speculating where typeFeedback says that it failed before
+ */
+CompiledLoop::CompiledLoop(Interpreter& owner, WhileStatement& node, TypeFeedback& typeFeedback)
+    : interpreter(owner), feedback(typeFeedback) {
+    findStableIntegers(node);
+    loop = compileLoop(node, false, ResumePath());
+}
+
+/**
+ * Continues the loop from the current state of the variables (its condition is the next thing to evaluate)
+ *
+ * The live state is transferred by binding the stable integers to their Values, which must still be integers
+ *
+ * Returns true when the loop has ended; false after a deoptimization, with the position of the statement
+ * to execute next in resumeAt (empty to continue from the condition)
+ */
+bool CompiledLoop::run(ResumePath& resumeAt) {
+    for (auto& entry : slots) {
+        VariableSlot& variable = *entry.second;
+        if (!variable.stable) continue;
+
+        Value* value = find(variable);
+        if (!value || value->type != Value::INTEGER) {
+            feedback.unstableVariables.insert(variable.name);
+            resumeAt.clear();
+            return false;
+        }
+        variable.integer = &std::get<int>(value->data);
+    }
+
+    if (loop() != ExecStatus::DEOPTIMIZE) return true;
+
+    feedback.failedGuards.insert(*deoptimizedAt);
+    resumeAt = *deoptimizedAt;
+    return false;
+}
+
+// ================= TYPE SPECULATION =================
+
+/**
+ * Collects the assignments of a loop: the expression assigned to each variable, or unstable
+ * for the statements that can give it a list, a dictionary or a matrix
+ */
+static void collectAssignments(Statement& stmt, std::vector<std::pair<std::string, const Expression*>>& assignments,
+                               std::unordered_set<std::string>& unstable) {
+    if (auto assignment = dynamic_cast<Assignment*>(&stmt)) {
+        assignments.emplace_back(assignment->variableName, assignment->value.get());
+    } else if (auto multiple = dynamic_cast<MultipleAssignment*>(&stmt)) {
+        for (size_t i = 0; i < multiple->targets.size(); i++) {
+            if (!multiple->targets[i].index) {
+                assignments.emplace_back(multiple->targets[i].name, multiple->values[i].get());
+            }
+        }
+    } else if (auto creation = dynamic_cast<ListCreation*>(&stmt)) {
+        unstable.insert(creation->variableName);
+    } else if (auto creation = dynamic_cast<DictCreation*>(&stmt)) {
+        unstable.insert(creation->variableName);
+    } else if (auto creation = dynamic_cast<MatrixCreation*>(&stmt)) {
+        unstable.insert(creation->variableName);
+    } else if (auto load = dynamic_cast<ListLoad*>(&stmt)) {
+        unstable.insert(load->variableName);
+    } else if (auto block = dynamic_cast<Block*>(&stmt)) {
+        for (auto& inner : block->statements) {
+            collectAssignments(*inner, assignments, unstable);
+        }
+    } else if (auto ifStmt = dynamic_cast<IfStatement*>(&stmt)) {
+        collectAssignments(*ifStmt->thenBlock, assignments, unstable);
+        for (auto& elif : ifStmt->elifClauses) {
+            collectAssignments(*elif.body, assignments, unstable);
+        }
+        if (ifStmt->elseBlock) {
+            collectAssignments(*ifStmt->elseBlock, assignments, unstable);
+        }
+    } else if (auto loop = dynamic_cast<WhileStatement*>(&stmt)) {
+        collectAssignments(*loop->body, assignments, unstable);
+    }
+}
+
+/**
+ * Finds the variables that are integers now and can only be assigned integers by the loop
+ *
+ * The others are marked unstable, until no assignment changes the result: a variable that receives
+ * the value of an unstable one becomes unstable too
+ */
+void CompiledLoop::findStableIntegers(WhileStatement& node) {
+    std::vector<std::pair<std::string, const Expression*>> assignments;
+    unstable.insert(feedback.unstableVariables.begin(), feedback.unstableVariables.end());
+    collectAssignments(*node.body, assignments, unstable);
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (const auto& assignment : assignments) {
+            if (unstable.count(assignment.first)) continue;
+            if (!isIntegerVariable(assignment.first) || !isIntegerExpression(*assignment.second)) {
+                unstable.insert(assignment.first);
+                changed = true;
+            }
+        }
+    }
+}
+
+bool CompiledLoop::isIntegerVariable(const std::string& name) const {
+    if (unstable.count(name)) return false;
+    auto it = interpreter.variables.find(name);
+    return it != interpreter.variables.end() && it->second.type == Value::INTEGER;
+}
+
+/**
+ * True if the expression can only complete with an integer: arithmetic always gives an integer or an error,
+ * and so does the cell of a matrix
+ */
+bool CompiledLoop::isIntegerExpression(const Expression& expr) const {
+    if (dynamic_cast<const NumberLiteral*>(&expr) || dynamic_cast<const Length*>(&expr) ||
+        dynamic_cast<const MatrixAccess*>(&expr)) {
+        return true;
+    }
+    if (auto identifier = dynamic_cast<const Identifier*>(&expr)) {
+        return isIntegerVariable(identifier->name);
+    }
+    if (auto unary = dynamic_cast<const UnaryOperation*>(&expr)) {
+        return unary->op == UnaryOperation::Operator::MINUS;
+    }
+    if (auto binary = dynamic_cast<const BinaryOperation*>(&expr)) {
+        switch (binary->op) {
+            case BinaryOperation::Operator::ADD:
+            case BinaryOperation::Operator::SUBTRACT:
+            case BinaryOperation::Operator::MULTIPLY:
+            case BinaryOperation::Operator::DIVIDE:
+                return true;
+            default:
+                return false;
+        }
+    }
+    return false;
+}
+
+// ================= VARIABLES =================
+
+/**
+ * Returns the slot of a variable, the same for every use of the name in the loop
+ */
+VariableSlot* CompiledLoop::slot(const std::string& name) {
+    auto& entry = slots[name];
+    if (!entry) {
+        entry = std::make_unique<VariableSlot>();
+        entry->name = name;
+        entry->stable = isIntegerVariable(name);
+    }
+    return entry.get();
+}
+
+/**
+ * Returns the value of the variable, or nullptr if it has never been assigned
+ */
+Value* CompiledLoop::find(VariableSlot& slot) {
+    if (!slot.value) {
+        auto it = interpreter.variables.find(slot.name);
+        if (it == interpreter.variables.end()) return nullptr;
+        slot.value = &it->second;
+    }
+    return slot.value;
+}
+
+/**
+ * Returns the value of the variable, with the errors of Interpreter::visit(Identifier&)
+ */
+Value& CompiledLoop::lookup(VariableSlot& slot) {
+    Value* value = find(slot);
+    if (!value) {
+        throw RuntimeError("Undefined variable '" + slot.name + "'");
+    }
+    if (value->type == Value::UNDEFINED) {
+        throw RuntimeError("Variable '" + slot.name + "' is undefined");
+    }
+    return *value;
+}
+
+/**
+ * True if the access is one of those checked on entry by the counted loop being compiled, offset is its k
+ */
+bool CompiledLoop::hoisted(const std::string& list, const Expression& index, int& offset) {
+    return counted && counted->covers(list, index, offset);
+}
+
+// ================= FALLBACKS =================
+
+/**
+ * Evaluates the expression with the tree walker
+ */
+Value CompiledLoop::fallback(Expression& expr) {
+    return interpreter.evaluateExpression(expr);
+}
+
+/**
+ * Executes the statement with the tree walker, break and continue become status codes
+ */
+ExecStatus CompiledLoop::fallback(Statement& stmt) {
+    try {
+        interpreter.executeStatement(stmt);
+    } catch (const BreakException&) {
+        return ExecStatus::BREAK;
+    } catch (const ContinueException&) {
+        return ExecStatus::CONTINUE;
+    }
+    return ExecStatus::NORMAL;
+}
+
+/**
+ * Stores a copy of the path that the closures can point to
+ */
+const ResumePath* CompiledLoop::keep(const ResumePath& path) {
+    paths.push_back(path);
+    return &paths.back();
+}
+
+/**
+ * Turns a failed guard of a speculative statement into a deoptimization at its position
+ *
+ * The statement of a step of a trace is left as it is, runTrace catches its guards with the position
+ * left in stepPosition
+ */
+CompiledStatement CompiledLoop::guarded(CompiledStatement statement, const ResumePath& path) {
+    if (!speculative) return statement;
+
+    if (traceStep) {
+        traceStep = false;
+        stepPosition = keep(path);
+        return statement;
+    }
+
+    const ResumePath* position = keep(path);
+    return [this, statement, position]() {
+        try {
+            return statement();
+        } catch (const GuardFailure&) {
+            deoptimizedAt = position;
+            return ExecStatus::DEOPTIMIZE;
+        }
+    };
+}
+
+// ================= EXPRESSIONS =================
+
+CompiledExpression CompiledLoop::compile(Expression& expr) {
+    if (auto number = dynamic_cast<NumberLiteral*>(&expr)) {
+        Value value(number->value);
+        return [value]() { return value; };
+    }
+
+    if (auto boolean = dynamic_cast<BooleanLiteral*>(&expr)) {
+        Value value(boolean->value);
+        return [value]() { return value; };
+    }
+
+    if (auto identifier = dynamic_cast<Identifier*>(&expr)) {
+        VariableSlot* variable = slot(identifier->name);
+        return [this, variable]() { return lookup(*variable); };
+    }
+
+    if (auto access = dynamic_cast<ListAccess*>(&expr)) {
+        VariableSlot* variable = slot(access->listName);
+        int offset;
+        if (hoisted(access->listName, *access->index, offset)) {
+            VariableSlot* counter = slot(counted->counter);
+            return [variable, counter, offset]() -> Value { return variable->elements[*counter->integer + offset]; };
+        }
+        CompiledExpression index = compile(*access->index);
+        return [this, variable, index, access]() -> Value {
+            Value* container = find(*variable);
+            if (container && container->type == Value::LIST) {
+                Value position = index();
+                if (position.type == Value::INTEGER) {
+                    const auto& list = std::get<List>(container->data);
+                    int i = std::get<int>(position.data);
+                    if (i >= 0 && static_cast<size_t>(i) < list.size()) return list[i];
+                }
+            } else if (container && container->type == Value::DICT) {
+                const Value* value = container->getDict().find(index());
+                if (value) return *value;
+            }
+            return fallback(*access);
+        };
+    }
+
+    if (auto access = dynamic_cast<MatrixAccess*>(&expr)) {
+        VariableSlot* variable = slot(access->matrixName);
+        CompiledExpression row = compile(*access->row);
+        CompiledExpression column = compile(*access->column);
+        return [this, variable, row, column, access]() -> Value {
+            Value* container = find(*variable);
+            if (container && container->type == Value::MATRIX) {
+                Value i = row();
+                Value j = column();
+                if (i.type == Value::INTEGER && j.type == Value::INTEGER) {
+                    const auto& matrix = std::get<Matrix>(container->data);
+                    if (matrix.contains(std::get<int>(i.data), std::get<int>(j.data))) {
+                        return Value(matrix.at(std::get<int>(i.data), std::get<int>(j.data)));
+                    }
+                }
+            }
+            return fallback(*access);
+        };
+    }
+
+    if (auto length = dynamic_cast<Length*>(&expr)) {
+        auto identifier = dynamic_cast<Identifier*>(length->operand.get());
+        if (!identifier) {
+            return [this, length]() { return fallback(*length); };
+        }
+        VariableSlot* variable = slot(identifier->name);
+        return [this, variable, length]() -> Value {
+            Value* container = find(*variable);
+            if (container && container->type == Value::LIST) {
+                return Value(static_cast<int>(container->getList().size()));
+            }
+            if (container && container->type == Value::DICT) {
+                return Value(static_cast<int>(container->getDict().size()));
+            }
+            if (container && container->type == Value::MATRIX) {
+                return Value(container->getMatrix().rows());
+            }
+            return fallback(*length);
+        };
+    }
+
+    if (auto unary = dynamic_cast<UnaryOperation*>(&expr)) {
+        UnaryOperation::Operator op = unary->op;
+        if (speculative && op == UnaryOperation::Operator::MINUS) {
+            CompiledInteger value = compileInteger(expr);
+            return [value]() { return Value(value()); };
+        }
+        CompiledExpression operand = compile(*unary->operand);
+        if (op == UnaryOperation::Operator::MINUS) {
+            return [this, operand, op]() {
+                Value value = operand();
+                if (value.type == Value::INTEGER) return Value(-std::get<int>(value.data));
+                return interpreter.performUnaryOperation(op, value);
+            };
+        }
+        return [this, operand, op]() {
+            Value value = operand();
+            if (value.type == Value::BOOLEAN) return Value(!std::get<bool>(value.data));
+            return interpreter.performUnaryOperation(op, value);
+        };
+    }
+
+    if (auto binary = dynamic_cast<BinaryOperation*>(&expr)) {
+        return compileBinary(*binary);
+    }
+
+    return [this, &expr]() { return fallback(expr); };
+}
+
+/**
+ * Each operator gets its own closure, so the operator is not tested at every execution
+ *
+ * INT_OPERATION builds the closure of an operator on two integers, any other pair of types
+ * goes to Interpreter::performBinaryOperation which computes the result or reports the error
+ */
+#define INT_OPERATION(RESULT)                                                          \
+    [this, left, right, op]() {                                                        \
+        Value l = left();                                                              \
+        Value r = right();                                                             \
+        if (l.type == Value::INTEGER && r.type == Value::INTEGER) {                    \
+            int a = std::get<int>(l.data);                                             \
+            int b = std::get<int>(r.data);                                             \
+            return Value(RESULT);                                                      \
+        }                                                                              \
+        return interpreter.performBinaryOperation(l, op, r);                           \
+    }
+
+CompiledExpression CompiledLoop::compileBinary(BinaryOperation& node) {
+    BinaryOperation::Operator op = node.op;
+    BinaryOperation* binary = &node;
+
+    if (op == BinaryOperation::Operator::IN || op == BinaryOperation::Operator::NOT_IN) {
+        return [this, binary]() { return fallback(*binary); };
+    }
+
+    if (speculative && isIntegerExpression(node)) {
+        CompiledInteger value = compileInteger(node);
+        return [value]() { return Value(value()); };
+    }
+
+    CompiledExpression left = compile(*node.left);
+    CompiledExpression right = compile(*node.right);
+
+    switch (op) {
+        case BinaryOperation::Operator::AND:
+            return [this, left, right, binary]() {
+                Value l = left();
+                if (l.type == Value::BOOLEAN) {
+                    if (!std::get<bool>(l.data)) return Value(false);
+                    Value r = right();
+                    if (r.type == Value::BOOLEAN) return r;
+                }
+                return fallback(*binary);
+            };
+        case BinaryOperation::Operator::OR:
+            return [this, left, right, binary]() {
+                Value l = left();
+                if (l.type == Value::BOOLEAN) {
+                    if (std::get<bool>(l.data)) return Value(true);
+                    Value r = right();
+                    if (r.type == Value::BOOLEAN) return r;
+                }
+                return fallback(*binary);
+            };
+        case BinaryOperation::Operator::ADD: return INT_OPERATION(a + b);
+        case BinaryOperation::Operator::SUBTRACT: return INT_OPERATION(a - b);
+        case BinaryOperation::Operator::MULTIPLY: return INT_OPERATION(a * b);
+        case BinaryOperation::Operator::LESS: return INT_OPERATION(a < b);
+        case BinaryOperation::Operator::LESS_EQUAL: return INT_OPERATION(a <= b);
+        case BinaryOperation::Operator::GREATER: return INT_OPERATION(a > b);
+        case BinaryOperation::Operator::GREATER_EQUAL: return INT_OPERATION(a >= b);
+        case BinaryOperation::Operator::DIVIDE:
+            return [this, left, right, op, binary]() {
+                Value l = left();
+                Value r = right();
+                if (l.type == Value::INTEGER && r.type == Value::INTEGER) {
+                    int a = std::get<int>(l.data);
+                    int b = std::get<int>(r.data);
+                    if (binary->invariantDivisor && FastDivisor::supports(b)) {
+                        return Value(binary->divisor.divide(a, b));
+                    }
+                    if (b != 0) return Value(a / b);
+                }
+                return interpreter.performBinaryOperation(l, op, r);
+            };
+        case BinaryOperation::Operator::EQUAL:
+        case BinaryOperation::Operator::NOT_EQUAL: {
+            bool equal = op == BinaryOperation::Operator::EQUAL;
+            return [this, left, right, op, equal]() {
+                Value l = left();
+                Value r = right();
+                if (l.type == Value::INTEGER && r.type == Value::INTEGER) {
+                    return Value((std::get<int>(l.data) == std::get<int>(r.data)) == equal);
+                }
+                if (l.type == Value::BOOLEAN && r.type == Value::BOOLEAN) {
+                    return Value((std::get<bool>(l.data) == std::get<bool>(r.data)) == equal);
+                }
+                return interpreter.performBinaryOperation(l, op, r);
+            };
+        }
+        default:
+            return [this, binary]() { return fallback(*binary); };
+    }
+}
+
+#undef INT_OPERATION
+
+/**
+ * Speculative: an expression expected to give an integer, computed without Values
+ *
+ * Every check that fails (wrong type, index out of range, division by zero) throws GuardFailure,
+ * the statement is then repeated by the tree walker, which gives the result or the error
+ */
+CompiledInteger CompiledLoop::compileInteger(Expression& expr) {
+    if (auto number = dynamic_cast<NumberLiteral*>(&expr)) {
+        int value = number->value;
+        return [value]() { return value; };
+    }
+
+    if (auto identifier = dynamic_cast<Identifier*>(&expr)) {
+        VariableSlot* variable = slot(identifier->name);
+        if (variable->stable) {
+            return [variable]() { return *variable->integer; };
+        }
+        return [this, variable]() {
+            Value* value = find(*variable);
+            if (!value || value->type != Value::INTEGER) throw GuardFailure();
+            return std::get<int>(value->data);
+        };
+    }
+
+    if (auto access = dynamic_cast<ListAccess*>(&expr)) {
+        VariableSlot* variable = slot(access->listName);
+        int offset;
+        if (hoisted(access->listName, *access->index, offset)) {
+            VariableSlot* counter = slot(counted->counter);
+            return [variable, counter, offset]() {
+                const Value& element = variable->elements[*counter->integer + offset];
+                if (element.type != Value::INTEGER) throw GuardFailure();
+                return std::get<int>(element.data);
+            };
+        }
+        CompiledInteger index = compileInteger(*access->index);
+        return [this, variable, index]() {
+            Value* container = find(*variable);
+            if (!container) throw GuardFailure();
+
+            const Value* element = nullptr;
+            if (container->type == Value::LIST) {
+                const auto& list = std::get<List>(container->data);
+                int i = index();
+                if (i >= 0 && static_cast<size_t>(i) < list.size()) element = &list[i];
+            } else if (container->type == Value::DICT) {
+                element = container->getDict().find(Value(index()));
+            }
+
+            if (!element || element->type != Value::INTEGER) throw GuardFailure();
+            return std::get<int>(element->data);
+        };
+    }
+
+    if (auto access = dynamic_cast<MatrixAccess*>(&expr)) {
+        VariableSlot* variable = slot(access->matrixName);
+        CompiledInteger row = compileInteger(*access->row);
+        CompiledInteger column = compileInteger(*access->column);
+        return [this, variable, row, column]() {
+            Value* container = find(*variable);
+            if (!container || container->type != Value::MATRIX) throw GuardFailure();
+
+            const auto& matrix = std::get<Matrix>(container->data);
+            int i = row();
+            int j = column();
+            if (!matrix.contains(i, j)) throw GuardFailure();
+            return matrix.at(i, j);
+        };
+    }
+
+    if (auto unary = dynamic_cast<UnaryOperation*>(&expr)) {
+        if (unary->op == UnaryOperation::Operator::MINUS) {
+            CompiledInteger operand = compileInteger(*unary->operand);
+            return [operand]() { return -operand(); };
+        }
+    }
+
+    if (auto binary = dynamic_cast<BinaryOperation*>(&expr)) {
+        switch (binary->op) {
+            case BinaryOperation::Operator::ADD: {
+                CompiledInteger left = compileInteger(*binary->left);
+                CompiledInteger right = compileInteger(*binary->right);
+                return [left, right]() { return left() + right(); };
+            }
+            case BinaryOperation::Operator::SUBTRACT: {
+                CompiledInteger left = compileInteger(*binary->left);
+                CompiledInteger right = compileInteger(*binary->right);
+                return [left, right]() { return left() - right(); };
+            }
+            case BinaryOperation::Operator::MULTIPLY: {
+                CompiledInteger left = compileInteger(*binary->left);
+                CompiledInteger right = compileInteger(*binary->right);
+                return [left, right]() { return left() * right(); };
+            }
+            case BinaryOperation::Operator::DIVIDE: {
+                CompiledInteger left = compileInteger(*binary->left);
+                CompiledInteger right = compileInteger(*binary->right);
+                return [left, right, binary]() {
+                    int a = left();
+                    int b = right();
+                    if (binary->invariantDivisor && FastDivisor::supports(b)) {
+                        return binary->divisor.divide(a, b);
+                    }
+                    if (b == 0) throw GuardFailure();
+                    return a / b;
+                };
+            }
+            default:
+                break;
+        }
+    }
+
+    CompiledExpression value = compile(expr);
+    return [value]() {
+        Value result = value();
+        if (result.type != Value::INTEGER) throw GuardFailure();
+        return std::get<int>(result.data);
+    };
+}
+
+/**
+ * Speculative: a condition, computed without Values
+ *
+ * Comparisons are done on integers and and/or/not on booleans, a value of another type throws GuardFailure
+ */
+CompiledCondition CompiledLoop::compileCondition(Expression& expr) {
+    if (auto boolean = dynamic_cast<BooleanLiteral*>(&expr)) {
+        bool value = boolean->value;
+        return [value]() { return value; };
+    }
+
+    if (auto identifier = dynamic_cast<Identifier*>(&expr)) {
+        VariableSlot* variable = slot(identifier->name);
+        return [this, variable]() {
+            Value* value = find(*variable);
+            if (!value || value->type != Value::BOOLEAN) throw GuardFailure();
+            return std::get<bool>(value->data);
+        };
+    }
+
+    if (auto unary = dynamic_cast<UnaryOperation*>(&expr)) {
+        if (unary->op == UnaryOperation::Operator::NOT) {
+            CompiledCondition operand = compileCondition(*unary->operand);
+            return [operand]() { return !operand(); };
+        }
+    }
+
+    if (auto binary = dynamic_cast<BinaryOperation*>(&expr)) {
+        BinaryOperation::Operator op = binary->op;
+
+        if (op == BinaryOperation::Operator::AND || op == BinaryOperation::Operator::OR) {
+            CompiledCondition left = compileCondition(*binary->left);
+            CompiledCondition right = compileCondition(*binary->right);
+            if (op == BinaryOperation::Operator::AND) {
+                return [left, right]() { return left() && right(); };
+            }
+            return [left, right]() { return left() || right(); };
+        }
+
+        bool integers = isIntegerExpression(*binary->left) || isIntegerExpression(*binary->right);
+        if (op == BinaryOperation::Operator::EQUAL || op == BinaryOperation::Operator::NOT_EQUAL) {
+            if (integers) {
+                CompiledInteger left = compileInteger(*binary->left);
+                CompiledInteger right = compileInteger(*binary->right);
+                if (op == BinaryOperation::Operator::EQUAL) {
+                    return [left, right]() { return left() == right(); };
+                }
+                return [left, right]() { return left() != right(); };
+            }
+        } else if (op != BinaryOperation::Operator::IN && op != BinaryOperation::Operator::NOT_IN &&
+                   op != BinaryOperation::Operator::ADD && op != BinaryOperation::Operator::SUBTRACT &&
+                   op != BinaryOperation::Operator::MULTIPLY && op != BinaryOperation::Operator::DIVIDE) {
+            CompiledInteger left = compileInteger(*binary->left);
+            CompiledInteger right = compileInteger(*binary->right);
+            switch (op) {
+                case BinaryOperation::Operator::LESS: return [left, right]() { return left() < right(); };
+                case BinaryOperation::Operator::LESS_EQUAL: return [left, right]() { return left() <= right(); };
+                case BinaryOperation::Operator::GREATER: return [left, right]() { return left() > right(); };
+                default: return [left, right]() { return left() >= right(); };
+            }
+        }
+    }
+
+    CompiledExpression value = compile(expr);
+    return [value]() {
+        Value result = value();
+        if (result.type != Value::BOOLEAN) throw GuardFailure();
+        return std::get<bool>(result.data);
+    };
+}
+
+/**
+ * The condition of the if or loop statement at path: speculative, unless its guard failed before,
+ * then with the error of the tree walker when it is not a boolean
+ */
+CompiledCondition CompiledLoop::compileTest(Expression& expr, const ResumePath& path, const char* error) {
+    if (!feedback.failedGuards.count(path)) {
+        return compileCondition(expr);
+    }
+
+    speculative = false;
+    CompiledExpression value = compile(expr);
+    speculative = true;
+
+    return [value, error]() {
+        Value result = value();
+        if (result.type != Value::BOOLEAN) {
+            throw RuntimeError(error);
+        }
+        return std::get<bool>(result.data);
+    };
+}
+
+// ================= STATEMENTS =================
+
+/**
+ * Compiles a statement, path is its position in the body of the outermost loop
+ *
+ * A simple statement whose guard failed before is compiled without speculation
+ */
+CompiledStatement CompiledLoop::compile(Statement& stmt, const ResumePath& path) {
+    bool compound = dynamic_cast<Block*>(&stmt) || dynamic_cast<IfStatement*>(&stmt) || dynamic_cast<WhileStatement*>(&stmt);
+    if (speculative && !compound && feedback.failedGuards.count(path)) {
+        speculative = false;
+        CompiledStatement statement = compile(stmt, path);
+        speculative = true;
+        return statement;
+    }
+
+    if (auto assignment = dynamic_cast<Assignment*>(&stmt)) {
+        VariableSlot* variable = slot(assignment->variableName);
+        if (speculative && variable->stable) {
+            CompiledInteger value = compileInteger(*assignment->value);
+            return guarded([variable, value]() {
+                *variable->integer = value();
+                return ExecStatus::NORMAL;
+            }, path);
+        }
+        CompiledExpression value = compile(*assignment->value);
+        return guarded([this, variable, value]() {
+            Value result = value();
+            if (!variable->value) variable->value = &interpreter.variables[variable->name];
+            *variable->value = std::move(result);
+            return ExecStatus::NORMAL;
+        }, path);
+    }
+
+    if (auto store = dynamic_cast<ListAssignment*>(&stmt)) {
+        VariableSlot* variable = slot(store->listName);
+        int offset;
+        if (hoisted(store->listName, *store->index, offset)) {
+            VariableSlot* counter = slot(counted->counter);
+            CompiledExpression value = compile(*store->value);
+            return guarded([variable, counter, offset, value]() {
+                Value result = value();
+                variable->elements[*counter->integer + offset] = std::move(result);
+                return ExecStatus::NORMAL;
+            }, path);
+        }
+        CompiledExpression index = compile(*store->index);
+        CompiledExpression value = compile(*store->value);
+        return guarded([this, variable, index, value, store]() {
+            Value* container = find(*variable);
+            if (container && container->type == Value::LIST) {
+                Value position = index();
+                if (position.type == Value::INTEGER) {
+                    int i = std::get<int>(position.data);
+                    if (i >= 0 && static_cast<size_t>(i) < container->getList().size()) {
+                        Value result = value();
+                        container->getList()[i] = std::move(result);
+                        return ExecStatus::NORMAL;
+                    }
+                }
+            }
+            return fallback(*store);
+        }, path);
+    }
+
+    if (auto store = dynamic_cast<MatrixAssignment*>(&stmt)) {
+        VariableSlot* variable = slot(store->matrixName);
+        if (speculative) {
+            CompiledInteger row = compileInteger(*store->row);
+            CompiledInteger column = compileInteger(*store->column);
+            CompiledInteger value = compileInteger(*store->value);
+            return guarded([this, variable, row, column, value]() {
+                Value* container = find(*variable);
+                if (!container || container->type != Value::MATRIX) throw GuardFailure();
+
+                auto& matrix = std::get<Matrix>(container->data);
+                int i = row();
+                int j = column();
+                if (!matrix.contains(i, j)) throw GuardFailure();
+                matrix.at(i, j) = value();
+                return ExecStatus::NORMAL;
+            }, path);
+        }
+        CompiledExpression row = compile(*store->row);
+        CompiledExpression column = compile(*store->column);
+        CompiledExpression value = compile(*store->value);
+        return [this, variable, row, column, value, store]() {
+            Value* container = find(*variable);
+            if (container && container->type == Value::MATRIX) {
+                Value i = row();
+                Value j = column();
+                if (i.type == Value::INTEGER && j.type == Value::INTEGER) {
+                    auto& matrix = std::get<Matrix>(container->data);
+                    int r = std::get<int>(i.data);
+                    int c = std::get<int>(j.data);
+                    if (matrix.contains(r, c)) {
+                        Value result = value();
+                        if (result.type == Value::INTEGER) {
+                            matrix.at(r, c) = std::get<int>(result.data);
+                            return ExecStatus::NORMAL;
+                        }
+                    }
+                }
+            }
+            return fallback(*store);
+        };
+    }
+
+    if (auto append = dynamic_cast<ListAppend*>(&stmt)) {
+        VariableSlot* variable = slot(append->listName);
+        CompiledExpression value = compile(*append->value);
+        return guarded([this, variable, value, append]() {
+            Value* container = find(*variable);
+            if (container && container->type == Value::LIST) {
+                Value result = value();
+                container->getList().push_back(std::move(result));
+                return ExecStatus::NORMAL;
+            }
+            return fallback(*append);
+        }, path);
+    }
+
+    if (auto print = dynamic_cast<PrintStatement*>(&stmt)) {
+        CompiledExpression value = compile(*print->expression);
+        return guarded([this, value]() {
+            interpreter.print(value());
+            return ExecStatus::NORMAL;
+        }, path);
+    }
+
+    if (dynamic_cast<BreakStatement*>(&stmt)) {
+        return []() { return ExecStatus::BREAK; };
+    }
+
+    if (dynamic_cast<ContinueStatement*>(&stmt)) {
+        return []() { return ExecStatus::CONTINUE; };
+    }
+
+    if (auto block = dynamic_cast<Block*>(&stmt)) {
+        std::vector<CompiledStatement> statements;
+        ResumePath inner = path;
+        inner.push_back(0);
+        for (size_t i = 0; i < block->statements.size(); i++) {
+            inner.back() = i;
+            statements.push_back(compile(*block->statements[i], inner));
+        }
+        return [statements]() {
+            for (const auto& statement : statements) {
+                ExecStatus status = statement();
+                if (status != ExecStatus::NORMAL) return status;
+            }
+            return ExecStatus::NORMAL;
+        };
+    }
+
+    if (auto ifStmt = dynamic_cast<IfStatement*>(&stmt)) {
+        std::vector<Expression*> tests;
+        std::vector<Block*> blocks;
+        tests.push_back(ifStmt->condition.get());
+        blocks.push_back(ifStmt->thenBlock.get());
+        for (auto& elif : ifStmt->elifClauses) {
+            tests.push_back(elif.condition.get());
+            blocks.push_back(elif.body.get());
+        }
+
+        std::vector<CompiledCondition> conditions;
+        std::vector<CompiledStatement> bodies;
+        ResumePath inner = path;
+        inner.push_back(0);
+        for (size_t i = 0; i < tests.size(); i++) {
+            conditions.push_back(compileTest(*tests[i], path,
+                i == 0 ? "if condition must be boolean" : "elif condition must be boolean"));
+            inner.back() = i;
+            bodies.push_back(compile(*blocks[i], inner));
+        }
+
+        CompiledStatement elseBody;
+        if (ifStmt->elseBlock) {
+            inner.back() = tests.size();
+            elseBody = compile(*ifStmt->elseBlock, inner);
+        }
+
+        const ResumePath* position = keep(path);
+        return [this, ifStmt, conditions, bodies, elseBody, position]() {
+            for (size_t i = 0; i < conditions.size(); i++) {
+                bool taken;
+                try {
+                    taken = conditions[i]();
+                } catch (const GuardFailure&) {
+                    deoptimizedAt = position;
+                    return ExecStatus::DEOPTIMIZE;
+                }
+                if (taken) {
+                    if (recording) decisions.emplace(ifStmt, i);
+                    return bodies[i]();
+                }
+            }
+            if (recording) decisions.emplace(ifStmt, conditions.size());
+            return elseBody ? elseBody() : ExecStatus::NORMAL;
+        };
+    }
+
+    if (auto loop = dynamic_cast<WhileStatement*>(&stmt)) {
+        return compileLoop(*loop, true, path);
+    }
+
+    return [this, &stmt]() { return fallback(stmt); };
+}
+
+/**
+ * The check of a counted loop on entry: the counter goes from its current value to the last one allowed
+ * by the bound, so every access v[i + k] of the fast version is in range if the two extremes are
+ *
+ * It also fails when a list is not a list (or the bound not an integer) at this moment: the body cannot
+ * change them, but the checked version reports the error of the tree walker
+ *
+ * On success the buffers of the lists are stored in their slots for the fast version
+ */
+CompiledCondition CompiledLoop::compileEntryCheck(const CountedLoop& countedLoop) {
+    struct Access {
+        VariableSlot* list;
+        long long lowest;
+        long long highest;
+    };
+
+    VariableSlot* counter = slot(countedLoop.counter);
+    VariableSlot* bound = nullptr;
+    if (!countedLoop.bound.empty()) bound = slot(countedLoop.bound);
+    if (!countedLoop.boundLength.empty()) bound = slot(countedLoop.boundLength);
+    bool length = !countedLoop.boundLength.empty();
+    long long boundConstant = countedLoop.boundConstant;
+    long long inclusive = countedLoop.inclusive ? 1 : 0;
+
+    std::vector<Access> accesses;
+    for (const auto& range : countedLoop.ranges) {
+        accesses.push_back({slot(range.list), range.lowest, range.highest});
+    }
+
+    return [this, counter, bound, length, boundConstant, inclusive, accesses]() {
+        long long limit = boundConstant;
+        if (bound) {
+            Value* value = find(*bound);
+            if (!value) return false;
+            if (length && value->type == Value::LIST) {
+                limit = static_cast<long long>(value->getList().size());
+            } else if (!length && value->type == Value::INTEGER) {
+                limit = std::get<int>(value->data);
+            } else {
+                return false;
+            }
+        }
+
+        long long first = *counter->integer;
+        long long last = limit - 1 + inclusive;
+        for (const Access& access : accesses) {
+            Value* value = find(*access.list);
+            if (!value || value->type != Value::LIST) return false;
+            List& list = std::get<List>(value->data);
+            if (first <= last &&
+                (first + access.lowest < 0 || last + access.highest >= static_cast<long long>(list.size()))) {
+                return false;
+            }
+            access.list->elements = list.data();
+        }
+        return true;
+    };
+}
+
+/**
+ * Collects the if statements of a body that belong to its iterations, those of nested loops are left out
+ */
+static void collectBranches(Statement& stmt, std::vector<const IfStatement*>& branches) {
+    if (auto block = dynamic_cast<Block*>(&stmt)) {
+        for (auto& inner : block->statements) {
+            collectBranches(*inner, branches);
+        }
+    } else if (auto ifStmt = dynamic_cast<IfStatement*>(&stmt)) {
+        branches.push_back(ifStmt);
+        collectBranches(*ifStmt->thenBlock, branches);
+        for (auto& elif : ifStmt->elifClauses) {
+            collectBranches(*elif.body, branches);
+        }
+        if (ifStmt->elseBlock) {
+            collectBranches(*ifStmt->elseBlock, branches);
+        }
+    }
+}
+
+/**
+ * Compiles a loop, a nested loop (useKernel) first lets its kernel run the iterations it can
+ *
+ * Every iteration still counts as a back-edge of the loop (and reaches its safe points), so its hotness
+ * is the same in every tier
+ *
+ * A counted loop with a stable counter also gets the fast version of its body, chosen at every entry
+ * (after the kernel, which moves the counter) when the entry check succeeds; both versions have the same
+ * paths, so a guard that fails in either one deoptimizes to the same statement
+ *
+ * A body with if statements can be traced, each version of the body gets its own trace
+ *
+ * Break and continue of the body stop here, so the loop itself ends normally or with a deoptimization;
+ * a guard of the condition that fails gives the position of the loop, which continues from its condition
+ */
+CompiledStatement CompiledLoop::compileLoop(WhileStatement& node, bool useKernel, const ResumePath& path) {
+    CompiledCondition condition = compileTest(*node.condition, path, "while condition must be boolean");
+    CompiledStatement body = compile(*node.body, path);
+
+    CompiledCondition entryCheck;
+    CompiledStatement fastBody;
+    const CountedLoop* countedLoop = interpreter.optimizer.countedLoopFor(node);
+    if (countedLoop && slot(countedLoop->counter)->stable) {
+        entryCheck = compileEntryCheck(*countedLoop);
+        counted = countedLoop;
+        fastBody = compile(*node.body, path);
+        counted = nullptr;
+    }
+
+    TracedLoop* traced = nullptr;
+    std::vector<const IfStatement*> branches;
+    collectBranches(*node.body, branches);
+    if (!branches.empty()) {
+        traced = &tracedLoops.emplace_back();
+        traced->node = &node;
+        traced->path = path;
+        traced->countedLoop = countedLoop;
+    }
+
+    const LoopKernel* kernel = useKernel ? interpreter.optimizer.kernelFor(node) : nullptr;
+    const ResumePath* position = keep(path);
+    TierStats& stats = interpreter.stats;
+    size_t& backEdges = interpreter.loopProfiles[&node].backEdges;
+    auto& variables = interpreter.variables;
+
+    return [this, &node, condition, body, entryCheck, fastBody, traced, kernel, position, &stats, &backEdges, &variables]() {
+        if (kernel) {
+            size_t done = kernel->run(variables);
+            stats.iterations[TIER2] += done;
+            backEdges += done;
+        }
+
+        bool fast = entryCheck && entryCheck();
+        if (fast) stats.hoistedChecks++;
+        const CompiledStatement& current = fast ? fastBody : body;
+
+        while (true) {
+            bool running;
+            try {
+                running = condition();
+            } catch (const GuardFailure&) {
+                deoptimizedAt = position;
+                return ExecStatus::DEOPTIMIZE;
+            }
+            if (!running) break;
+
+            stats.iterations[TIER1]++;
+            backEdges++;
+            interpreter.safePoint(node);
+            ExecStatus status = traced ? runTraced(*traced, fast, current) : current();
+            if (status == ExecStatus::BREAK) break;
+            if (status == ExecStatus::DEOPTIMIZE) return status;
+        }
+        return ExecStatus::NORMAL;
+    };
+}
+
+// ================= TRACES =================
+
+/**
+ * Runs an iteration of a traced loop: with the trace of the version once it exists, otherwise with the body,
+ * recording the iteration that reaches the threshold
+ */
+ExecStatus CompiledLoop::runTraced(TracedLoop& traced, bool fast, const CompiledStatement& body) {
+    std::unique_ptr<Trace>& trace = traced.versions[fast];
+    if (trace) return runTrace(*trace);
+
+    if (traced.iterations < interpreter.thresholds.trace) {
+        traced.iterations++;
+        return body();
+    }
+
+    ExecStatus status;
+    trace = record(*traced.node->body, traced.path, body, fast ? traced.countedLoop : nullptr, status);
+    return status;
+}
+
+/**
+ * Executes code, the compiled version of stmt, while its if statements record the branch they take,
+ * then compiles the recorded path (version is the counted loop whose fast version code is, if any)
+ *
+ * Decisions left by an earlier recording are erased first, those of other loops recording at the same
+ * time are kept; if the execution ends with a break or a deoptimization no trace is made, the next
+ * one is recorded instead
+ */
+std::unique_ptr<Trace> CompiledLoop::record(Statement& stmt, const ResumePath& path, const CompiledStatement& code,
+                                            const CountedLoop* version, ExecStatus& status) {
+    std::vector<const IfStatement*> branches;
+    collectBranches(stmt, branches);
+    for (const IfStatement* branch : branches) {
+        decisions.erase(branch);
+    }
+
+    recording++;
+    try {
+        status = code();
+    } catch (...) {
+        recording--;
+        throw;
+    }
+    recording--;
+
+    if (status != ExecStatus::NORMAL && status != ExecStatus::CONTINUE) return nullptr;
+
+    auto trace = std::make_unique<Trace>();
+    trace->version = version;
+    const CountedLoop* previous = counted;
+    counted = version;
+    compileTrace(stmt, path, *trace);
+    counted = previous;
+    interpreter.stats.traces++;
+    return trace;
+}
+
+/**
+ * Appends the steps of the recorded path through stmt; an if statement that was not reached
+ * (the iteration ended with continue before it) stays a single step with all its branches
+ */
+void CompiledLoop::compileTrace(Statement& stmt, const ResumePath& path, Trace& trace) {
+    if (auto block = dynamic_cast<Block*>(&stmt)) {
+        ResumePath inner = path;
+        inner.push_back(0);
+        for (size_t i = 0; i < block->statements.size(); i++) {
+            inner.back() = i;
+            compileTrace(*block->statements[i], inner, trace);
+        }
+        return;
+    }
+
+    auto ifStmt = dynamic_cast<IfStatement*>(&stmt);
+    auto decision = ifStmt ? decisions.find(ifStmt) : decisions.end();
+    if (decision == decisions.end()) {
+        Trace::Step step;
+        traceStep = !ifStmt && !dynamic_cast<WhileStatement*>(&stmt);
+        stepPosition = nullptr;
+        step.statement = compile(stmt, path);
+        step.position = stepPosition;
+        traceStep = false;
+        trace.steps.push_back(std::move(step));
+        return;
+    }
+
+    std::vector<Expression*> tests;
+    std::vector<Block*> blocks;
+    tests.push_back(ifStmt->condition.get());
+    blocks.push_back(ifStmt->thenBlock.get());
+    for (auto& elif : ifStmt->elifClauses) {
+        tests.push_back(elif.condition.get());
+        blocks.push_back(elif.body.get());
+    }
+    blocks.push_back(ifStmt->elseBlock.get());
+
+    auto guard = std::make_unique<Trace::Guard>();
+    guard->branch = ifStmt;
+    guard->expected = decision->second;
+    for (size_t i = 0; i < tests.size(); i++) {
+        guard->conditions.push_back(compileTest(*tests[i], path,
+            i == 0 ? "if condition must be boolean" : "elif condition must be boolean"));
+    }
+
+    ResumePath inner = path;
+    inner.push_back(0);
+    guard->exits.resize(blocks.size());
+    for (size_t i = 0; i < blocks.size(); i++) {
+        if (i == guard->expected || !blocks[i]) continue;
+        Trace::SideExit& exit = guard->exits[i];
+        inner.back() = i;
+        exit.block = blocks[i];
+        exit.path = inner;
+        exit.body = compile(*blocks[i], inner);
+        std::vector<const IfStatement*> branches;
+        collectBranches(*blocks[i], branches);
+        exit.branchy = !branches.empty();
+    }
+
+    Trace::Guard* join = guard.get();
+    Trace::Step step;
+    step.position = keep(path);
+    step.guard = std::move(guard);
+    trace.steps.push_back(std::move(step));
+    if (blocks[decision->second]) {
+        inner.back() = decision->second;
+        compileTrace(*blocks[decision->second], inner, trace);
+    }
+    join->join = trace.steps.size();
+}
+
+/**
+ * Executes the steps of a trace, at a guard whose branch is not the expected one it takes the side exit
+ * and continues from the join of the guard
+ */
+ExecStatus CompiledLoop::runTrace(Trace& trace) {
+    size_t next = 0;
+    try {
+        while (next < trace.steps.size()) {
+            Trace::Step& step = trace.steps[next];
+            if (!step.guard) {
+                ExecStatus status = step.statement();
+                if (status != ExecStatus::NORMAL) return status;
+                next++;
+                continue;
+            }
+
+            Trace::Guard& guard = *step.guard;
+            size_t taken = guard.conditions.size();
+            for (size_t i = 0; i < guard.conditions.size(); i++) {
+                if (guard.conditions[i]()) {
+                    taken = i;
+                    break;
+                }
+            }
+            if (recording) decisions.emplace(guard.branch, taken);
+
+            if (taken == guard.expected) {
+                next++;
+                continue;
+            }
+            ExecStatus status = leave(guard.exits[taken], trace.version);
+            if (status != ExecStatus::NORMAL) return status;
+            next = guard.join;
+        }
+    } catch (const GuardFailure&) {
+        deoptimizedAt = trace.steps[next].position;
+        return ExecStatus::DEOPTIMIZE;
+    }
+    return ExecStatus::NORMAL;
+}
+
+/**
+ * Runs the branch of a side exit: with its side trace, or with its block until the exit is hot enough
+ * to record one (only for a block with if statements, otherwise the trace would be the block itself)
+ */
+ExecStatus CompiledLoop::leave(Trace::SideExit& exit, const CountedLoop* version) {
+    interpreter.stats.sideExits++;
+    if (exit.side) return runTrace(*exit.side);
+    if (!exit.body) return ExecStatus::NORMAL;
+
+    if (!exit.branchy || exit.taken < interpreter.thresholds.trace) {
+        exit.taken++;
+        return exit.body();
+    }
+
+    ExecStatus status;
+    exit.side = record(*exit.block, exit.path, exit.body, version, status);
+    if (exit.side) interpreter.stats.sideTraces++;
+    return status;
+}
@@ -0,0 +1,245 @@
+/**
+ * Guard Headers
+ */
+#ifndef COMPILER_H
+#define COMPILER_H
+
+/**
+ * Include for AST definitions
+ *
+ * Include for Value produced by the compiled expressions
+ *
+ * Include for std::function used to store the closures
+ *
+ * Include for std::unordered_map and std::unordered_set used for the variable slots and the analysis
+ *
+ * Include for std::unique_ptr used to keep the slots at a fixed address and to own the traces
+ *
+ * Include for std::deque used to keep the deoptimization paths and the traced loops at a fixed address
+ *
+ * Include for std::set used for the type feedback
+ *
+ * Include for std::string and std::vector used for names and paths
+ */
+#include "ast.h"
+#include "value.h"
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include <deque>
+#include <set>
+#include <string>
+#include <vector>
+
+/**
+ * Advance Declaration, the compiled code calls back into the interpreter for the uncommon cases
+ */
+class Interpreter;
+
+/**
+ * Advance Declaration, the counted loops found by the Optimizer get a version without bounds checks
+ */
+struct CountedLoop;
+
+/**
+ * How a compiled statement ends: break and continue are returned instead of being thrown,
+ * DEOPTIMIZE means that a guard failed and the interpreter must continue from the statement that failed
+ */
+enum class ExecStatus {
+    NORMAL,
+    BREAK,
+    CONTINUE,
+    DEOPTIMIZE
+};
+
+using CompiledExpression = std::function<Value()>;
+using CompiledInteger = std::function<int()>;
+using CompiledCondition = std::function<bool()>;
+using CompiledStatement = std::function<ExecStatus()>;
+
+/**
+ * Position of a statement inside a loop body, used to resume the tree walker after a deoptimization
+ *
+ * One element for each Block (index of the statement) and IfStatement (0 for the then block,
+ * 1..n for the elif clauses, n + 1 for the else block) on the way; a WhileStatement adds nothing,
+ * a path that ends at a loop means that the loop continues from its condition
+ */
+using ResumePath = std::vector<size_t>;
+
+/**
+ * What the speculation of a loop got wrong: the statements whose guards failed (a loop or if statement
+ * for its condition) and the variables that were not integers when the compiled loop was entered
+ *
+ * The next compilation of the loop does not speculate on them, the rest of the loop still does
+ */
+struct TypeFeedback {
+    std::set<ResumePath> failedGuards;
+    std::set<std::string> unstableVariables;
+};
+
+/**
+ * Variable used by compiled code
+ *
+ * value points to the entry of the variable environment, found at the first access and then reused:
+ * variables are never removed, so the address stays valid for the whole execution
+ *
+ * stable is set for the integers that the loop can only replace with other integers, compiled code
+ * reads and writes them through integer, bound to the payload of the Value when the loop is entered
+ *
+ * elements is the buffer of a list whose accesses were checked when a counted loop was entered,
+ * the loop does not resize the list so the buffer does not move while it runs
+ */
+struct VariableSlot {
+    std::string name;
+    Value* value = nullptr;
+    bool stable = false;
+    int* integer = nullptr;
+    Value* elements = nullptr;
+};
+
+/**
+ * One path through a loop body, recorded while the loop ran (trace) and compiled as a straight sequence of steps
+ *
+ * A step is a statement of the path, or an if statement of the path turned into a Guard: it evaluates the
+ * conditions like the if statement and, when the branch is the recorded one (expected), the steps of that
+ * branch follow; any other branch leaves the trace (side exit), runs its block and joins the trace again
+ * at the step after the if statement (join), since the rest of the iteration is the same for every branch
+ *
+ * A side exit taken often enough records the path through its block as a side trace, which then runs in place
+ * of the block; side traces have their own exits and side traces
+ *
+ * position is where a step deoptimizes when one of its guards fails, version the counted loop whose fast
+ * version the trace was recorded from (nullptr for the checked version)
+ */
+struct Trace {
+    struct SideExit {
+        Block* block = nullptr;
+        ResumePath path;
+        CompiledStatement body;
+        bool branchy = false;
+        size_t taken = 0;
+        std::unique_ptr<Trace> side;
+    };
+
+    struct Guard {
+        const IfStatement* branch = nullptr;
+        std::vector<CompiledCondition> conditions;
+        size_t expected = 0;
+        size_t join = 0;
+        std::vector<SideExit> exits;
+    };
+
+    struct Step {
+        CompiledStatement statement;
+        const ResumePath* position = nullptr;
+        std::unique_ptr<Guard> guard;
+    };
+
+    std::vector<Step> steps;
+    const CountedLoop* version = nullptr;
+};
+
+/**
+ * A while loop compiled into closures (tier 1)
+ *
+ * Every node becomes a closure that executes it directly: variables are read through their slots without
+ * hashing the name, the operations on integers and booleans are done inline, break and continue are status codes
+ *
+ * Every unusual case (wrong types, errors, statements without a fast path) is handed back to the Interpreter,
+ * which repeats the node from the start: expressions have no side effects, and a statement is handed back
+ * before it changes anything, so the behavior and the error messages are exactly the ones of the tree walker
+ *
+ * The loop also speculates on the types seen when it was compiled:
+ * - the stable integers are read and written without boxing them into Values
+ * - integer and boolean expressions are computed as int and bool, guarded by type checks
+ * When a guard fails before the statement changes anything, run() stops with the ResumePath of that
+ * statement (deoptimization), records it in the TypeFeedback and the interpreter finishes the iteration
+ * and the loop with the tree walker
+ *
+ * Nested loops are compiled with the enclosing loop and still use their LoopKernel when they have one
+ *
+ * A counted loop (CountedLoop) is compiled twice: the fast version reads and writes the elements it accesses
+ * at i + k without checking the list or the index, and it runs when the check done on entry proves every
+ * such access in range; otherwise the loop runs the checked version, whose errors are those of the tree walker
+ *
+ * A loop whose body has if statements is traced once it has run TierThresholds::trace iterations here:
+ * the if statements of the next iteration record the branch they take, and the path is compiled into
+ * a Trace that runs the following iterations; a trace is made of the same compiled statements and
+ * paths as the body, so its guards deoptimize to the same positions
+ */
+class CompiledLoop {
+private:
+    struct GuardFailure {};
+
+    Interpreter& interpreter;
+    TypeFeedback& feedback;
+    bool speculative = true;
+
+    std::unordered_map<std::string, std::unique_ptr<VariableSlot>> slots;
+    std::unordered_set<std::string> unstable;
+
+    std::deque<ResumePath> paths;
+    const ResumePath* deoptimizedAt = nullptr;
+
+    struct TracedLoop {
+        WhileStatement* node = nullptr;
+        ResumePath path;
+        const CountedLoop* countedLoop = nullptr;
+        size_t iterations = 0;
+        std::unique_ptr<Trace> versions[2];
+    };
+
+    std::deque<TracedLoop> tracedLoops;
+    std::unordered_map<const IfStatement*, size_t> decisions;
+    size_t recording = 0;
+    bool traceStep = false;
+    const ResumePath* stepPosition = nullptr;
+
+    CompiledStatement loop;
+
+    const CountedLoop* counted = nullptr;
+
+    void findStableIntegers(WhileStatement& node);
+    bool isIntegerExpression(const Expression& expr) const;
+    bool isIntegerVariable(const std::string& name) const;
+
+    VariableSlot* slot(const std::string& name);
+
+    Value* find(VariableSlot& slot);
+    Value& lookup(VariableSlot& slot);
+
+    bool hoisted(const std::string& list, const Expression& index, int& offset);
+
+    Value fallback(Expression& expr);
+    ExecStatus fallback(Statement& stmt);
+
+    CompiledExpression compile(Expression& expr);
+    CompiledExpression compileBinary(BinaryOperation& node);
+    CompiledInteger compileInteger(Expression& expr);
+    CompiledCondition compileCondition(Expression& expr);
+    CompiledCondition compileTest(Expression& expr, const ResumePath& path, const char* error);
+
+    CompiledStatement compile(Statement& stmt, const ResumePath& path);
+    CompiledStatement compileLoop(WhileStatement& node, bool useKernel, const ResumePath& path);
+    CompiledCondition compileEntryCheck(const CountedLoop& countedLoop);
+    const ResumePath* keep(const ResumePath& path);
+    CompiledStatement guarded(CompiledStatement statement, const ResumePath& path);
+
+    ExecStatus runTraced(TracedLoop& traced, bool fast, const CompiledStatement& body);
+    std::unique_ptr<Trace> record(Statement& stmt, const ResumePath& path, const CompiledStatement& code,
+                                  const CountedLoop* version, ExecStatus& status);
+    void compileTrace(Statement& stmt, const ResumePath& path, Trace& trace);
+    ExecStatus runTrace(Trace& trace);
+    ExecStatus leave(Trace::SideExit& exit, const CountedLoop* version);
+
+public:
+    CompiledLoop(Interpreter& owner, WhileStatement& node, TypeFeedback& typeFeedback);
+
+    CompiledLoop(const CompiledLoop&) = delete;
+    CompiledLoop& operator=(const CompiledLoop&) = delete;
+
+    bool run(ResumePath& resumeAt);
+};
+
+#endif // COMPILER_H
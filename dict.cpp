@@ -0,0 +1,199 @@
+/**
+ * Implementation of the dictionary
+ *
+ * Include for Value and RuntimeError, Dict::Entry is defined there
+ *
+ * Include for the SSE2 intrinsics used to probe a group of control bytes at once
+ */
+#include "dict.h"
+#include "value.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static const size_t GROUP_SIZE = 16;
+static const int8_t EMPTY = -128;
+
+/**
+ * Mixes all the bits of the key (finalizer of MurmurHash3), consecutive keys end up in distant slots
+ */
+static uint64_t hashKey(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+/**
+ * Bit i of the result is set if control byte i of the group equals h2
+ */
+static unsigned matchGroup(const int8_t* group, int8_t h2) {
+#if defined(__SSE2__)
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+    return static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(h2))));
+#else
+    unsigned mask = 0;
+    for (unsigned i = 0; i < GROUP_SIZE; i++) {
+        if (group[i] == h2) mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+/**
+ * Entries in insertion order and the index over them
+ *
+ * control has capacity + GROUP_SIZE bytes, slots has capacity positions in entries
+ */
+struct Dict::Table {
+    Entries entries;
+    std::vector<int8_t, ArenaAllocator<int8_t>> control;
+    std::vector<int32_t, ArenaAllocator<int32_t>> slots;
+    size_t capacity;
+
+    Table() : control(16 + GROUP_SIZE, EMPTY), slots(16), capacity(16) {}
+
+    /**
+     * Returns the position of key in entries, or -1
+     *
+     * The groups are visited with triangular steps, which cover the whole table because the capacity is a power of two
+     */
+    int32_t findIndex(uint64_t key, uint64_t h) const {
+        const size_t mask = capacity - 1;
+        const int8_t h2 = static_cast<int8_t>(h & 0x7F);
+        size_t pos = (h >> 7) & mask;
+
+        for (size_t step = GROUP_SIZE;; step += GROUP_SIZE) {
+            const int8_t* group = control.data() + pos;
+
+            for (unsigned bits = matchGroup(group, h2); bits != 0; bits &= bits - 1) {
+                int32_t index = slots[(pos + __builtin_ctz(bits)) & mask];
+                if (entries[index].key == key) return index;
+            }
+            if (matchGroup(group, EMPTY) != 0) return -1;
+
+            pos = (pos + step) & mask;
+        }
+    }
+
+    /**
+     * Stores index in the first empty slot of the probe sequence of h
+     */
+    void insertIndex(int32_t index, uint64_t h) {
+        const size_t mask = capacity - 1;
+        const int8_t h2 = static_cast<int8_t>(h & 0x7F);
+        size_t pos = (h >> 7) & mask;
+
+        for (size_t step = GROUP_SIZE;; step += GROUP_SIZE) {
+            unsigned empty = matchGroup(control.data() + pos, EMPTY);
+            if (empty != 0) {
+                size_t slot = (pos + __builtin_ctz(empty)) & mask;
+                control[slot] = h2;
+                if (slot < GROUP_SIZE) control[capacity + slot] = h2;
+                slots[slot] = index;
+                return;
+            }
+            pos = (pos + step) & mask;
+        }
+    }
+
+    void rehash(size_t newCapacity) {
+        capacity = newCapacity;
+        control.assign(capacity + GROUP_SIZE, EMPTY);
+        slots.assign(capacity, 0);
+
+        for (size_t i = 0; i < entries.size(); i++) {
+            insertIndex(static_cast<int32_t>(i), hashKey(entries[i].key));
+        }
+    }
+};
+
+Dict::Dict() = default;
+
+Dict::Dict(const Dict& other) : table(other.table ? std::make_unique<Table>(*other.table) : nullptr) {}
+
+Dict::Dict(Dict&& other) noexcept = default;
+
+Dict& Dict::operator=(const Dict& other) {
+    if (this != &other) {
+        table = other.table ? std::make_unique<Table>(*other.table) : nullptr;
+    }
+    return *this;
+}
+
+Dict& Dict::operator=(Dict&& other) noexcept = default;
+
+Dict::~Dict() = default;
+
+uint64_t Dict::encodeKey(const Value& key) {
+    if (key.type == Value::INTEGER) {
+        return (static_cast<uint64_t>(Value::INTEGER) << 32) | static_cast<uint32_t>(key.getInt());
+    }
+    if (key.type == Value::BOOLEAN) {
+        return (static_cast<uint64_t>(Value::BOOLEAN) << 32) | (key.getBool() ? 1u : 0u);
+    }
+    throw RuntimeError("Dictionary key must be an integer or boolean");
+}
+
+Value Dict::decodeKey(uint64_t key) {
+    if ((key >> 32) == Value::BOOLEAN) return Value(static_cast<uint32_t>(key) != 0);
+    return Value(static_cast<int>(static_cast<uint32_t>(key)));
+}
+
+size_t Dict::size() const {
+    return table ? table->entries.size() : 0;
+}
+
+const Value* Dict::find(const Value& key) const {
+    uint64_t bits = encodeKey(key);
+    if (!table) return nullptr;
+    int32_t index = table->findIndex(bits, hashKey(bits));
+    return index < 0 ? nullptr : &table->entries[index].value;
+}
+
+bool Dict::contains(const Value& key) const {
+    return find(key) != nullptr;
+}
+
+/**
+ * Returns the value of key, inserting it (undefined) if missing
+ *
+ * The table grows to twice its capacity when it would become more than 7/8 full
+ */
+Value& Dict::operator[](const Value& key) {
+    uint64_t bits = encodeKey(key);
+    uint64_t h = hashKey(bits);
+
+    if (!table) table = std::make_unique<Table>();
+
+    int32_t index = table->findIndex(bits, h);
+    if (index >= 0) return table->entries[index].value;
+
+    if ((table->entries.size() + 1) * 8 > table->capacity * 7) table->rehash(table->capacity * 2);
+
+    index = static_cast<int32_t>(table->entries.size());
+    table->entries.push_back({bits, Value()});
+    table->insertIndex(index, h);
+    return table->entries.back().value;
+}
+
+const Dict::Entries& Dict::items() const {
+    static const Entries none;
+    return table ? table->entries : none;
+}
+
+std::string Dict::toString() const {
+    const auto& entries = items();
+    std::string result = "{";
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (i > 0) result += ", ";
+        result += decodeKey(entries[i].key).toString();
+        result += ": ";
+        result += entries[i].value.toString();
+    }
+    result += "}";
+    return result;
+}
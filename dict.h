@@ -0,0 +1,87 @@
+/**
+ * Guard Headers
+ */
+#ifndef DICT_H
+#define DICT_H
+
+/**
+ * Include for std::vector used for the entries and the control bytes
+ *
+ * Include for uint64_t, int8_t and int32_t used by the hash table
+ *
+ * Include for size_t used for sizes
+ *
+ * Include for std::string used by toString
+ *
+ * Include for std::unique_ptr used to own the table
+ *
+ * Include for ArenaAllocator used for the storage of the table
+ */
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <memory>
+#include "arena.h"
+
+/**
+ * Advance Declaration, Dict stores Values and Value can contain a Dict
+ */
+class Value;
+
+/**
+ * Dictionary with integer or boolean keys (d = dict(), d[k], d[k] = v, k in d, len(d))
+ *
+ * The entries are kept in insertion order in a dense vector, so printing follows the same order as Python
+ *
+ * The index is a flat open-addressing hash table in the style of SwissTable:
+ * - each slot has a control byte, EMPTY or the low 7 bits of the hash of the key (h2)
+ * - the table is probed one group of 16 control bytes at a time, comparing h2 with all of them at once
+ *   using SSE2 (or a plain loop on other processors), only the slots that match are compared with the key
+ * - the first GROUP_SIZE control bytes are mirrored after the end so a group can always be loaded with one read
+ *
+ * The language has no way to remove a key, so the table never needs tombstones
+ *
+ * Keys are encoded in 64 bits: the type in the high half and the value in the low half,
+ * so that 1 and True are different keys, consistent with == that never mixes types
+ *
+ * The table lives behind a pointer, allocated at the first insertion, so a Dict is as small as a pointer
+ * and does not make every Value (and so every list element) larger; its entries and index are stored
+ * in the arena of the execution like the buffers of the lists
+ */
+class Dict {
+public:
+    struct Entry;
+
+    using Entries = std::vector<Entry, ArenaAllocator<Entry>>;
+
+private:
+    struct Table;
+
+    std::unique_ptr<Table> table;
+
+public:
+    Dict();
+    Dict(const Dict& other);
+    Dict(Dict&& other) noexcept;
+    Dict& operator=(const Dict& other);
+    Dict& operator=(Dict&& other) noexcept;
+    ~Dict();
+
+    static uint64_t encodeKey(const Value& key);
+    static Value decodeKey(uint64_t key);
+
+    size_t size() const;
+
+    const Value* find(const Value& key) const;
+
+    bool contains(const Value& key) const;
+
+    Value& operator[](const Value& key);
+
+    const Entries& items() const;
+
+    std::string toString() const;
+};
+
+#endif // DICT_H
@@ -0,0 +1,85 @@
+/**
+ * Guard Headers
+ */
+#ifndef FASTDIV_H
+#define FASTDIV_H
+
+/**
+ * Include for int32_t, int64_t and uint32_t used by the magic numbers
+ */
+#include <cstdint>
+
+/**
+ * Integer division by a divisor that does not change, without the division instruction
+ *
+ * The quotient (truncated toward zero, like the // operator of the interpreter) is computed with
+ * a multiplication by a precomputed "magic" number and a shift (Hacker's Delight, chapter 10)
+ *
+ * The magic number is computed again only when the divisor changes, so the object can be attached to
+ * a division whose divisor is loop invariant; divisors 0, 1 and -1 are never handled here
+ */
+class FastDivisor {
+private:
+    int32_t divisor = 0;
+    int32_t magic = 0;
+    int shift = 0;
+
+    void prepare(int32_t d) {
+        const uint32_t two31 = 0x80000000u;
+        uint32_t ad = d < 0 ? 0u - static_cast<uint32_t>(d) : static_cast<uint32_t>(d);
+        uint32_t t = two31 + (static_cast<uint32_t>(d) >> 31);
+        uint32_t anc = t - 1 - t % ad;
+        int p = 31;
+        uint32_t q1 = two31 / anc;
+        uint32_t r1 = two31 - q1 * anc;
+        uint32_t q2 = two31 / ad;
+        uint32_t r2 = two31 - q2 * ad;
+        uint32_t delta;
+
+        do {
+            p++;
+            q1 = 2 * q1;
+            r1 = 2 * r1;
+            if (r1 >= anc) {
+                q1++;
+                r1 -= anc;
+            }
+            q2 = 2 * q2;
+            r2 = 2 * r2;
+            if (r2 >= ad) {
+                q2++;
+                r2 -= ad;
+            }
+            delta = ad - r2;
+        } while (q1 < delta || (q1 == delta && r1 == 0));
+
+        magic = static_cast<int32_t>(q2 + 1);
+        if (d < 0) magic = -magic;
+        shift = p - 32;
+        divisor = d;
+    }
+
+public:
+    /**
+     * True if the divisor can be handled with the magic number
+     */
+    static bool supports(int32_t d) {
+        return d != 0 && d != 1 && d != -1;
+    }
+
+    /**
+     * Returns n / d, d must satisfy supports(d)
+     */
+    int32_t divide(int32_t n, int32_t d) {
+        if (d != divisor) prepare(d);
+
+        int32_t q = static_cast<int32_t>((static_cast<int64_t>(magic) * n) >> 32);
+        if (d > 0 && magic < 0) q = static_cast<int32_t>(static_cast<uint32_t>(q) + static_cast<uint32_t>(n));
+        else if (d < 0 && magic > 0) q = static_cast<int32_t>(static_cast<uint32_t>(q) - static_cast<uint32_t>(n));
+        q >>= shift;
+        q += static_cast<uint32_t>(q) >> 31;
+        return q;
+    }
+};
+
+#endif // FASTDIV_H
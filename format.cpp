@@ -0,0 +1,228 @@
+/**
+ * Implementation of the print output formats
+ *
+ * Include for std::to_chars used to write integers without temporary strings
+ *
+ * Include for uint64_t used by the varint encoding
+ */
+#include "format.h"
+#include <charconv>
+#include <cstdint>
+
+/**
+ * Appends the decimal representation of an integer
+ */
+static void appendInt(int value, std::string& out) {
+    char digits[16];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, result.ptr - digits);
+}
+
+/**
+ * Appends an unsigned LEB128 varint: 7 bits per byte, the high bit says that more bytes follow
+ */
+static void appendVarint(uint64_t value, std::string& out) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+/**
+ * Text format, identical to Value::toString
+ */
+static void appendText(const Value& value, std::string& out) {
+    switch (value.type) {
+        case Value::INTEGER:
+            appendInt(value.getInt(), out);
+            return;
+        case Value::BOOLEAN:
+            out += value.getBool() ? "True" : "False";
+            return;
+        case Value::LIST: {
+            const auto& list = value.getList();
+            out += '[';
+            for (size_t i = 0; i < list.size(); i++) {
+                if (i > 0) out += ", ";
+                appendText(list[i], out);
+            }
+            out += ']';
+            return;
+        }
+        case Value::DICT: {
+            const auto& entries = value.getDict().items();
+            out += '{';
+            for (size_t i = 0; i < entries.size(); i++) {
+                if (i > 0) out += ", ";
+                appendText(Dict::decodeKey(entries[i].key), out);
+                out += ": ";
+                appendText(entries[i].value, out);
+            }
+            out += '}';
+            return;
+        }
+        case Value::MATRIX: {
+            const auto& matrix = value.getMatrix();
+            out += '[';
+            for (int i = 0; i < matrix.rows(); i++) {
+                if (i > 0) out += ", ";
+                const int* row = matrix.row(i);
+                out += '[';
+                for (int j = 0; j < matrix.columns(); j++) {
+                    if (j > 0) out += ", ";
+                    appendInt(row[j], out);
+                }
+                out += ']';
+            }
+            out += ']';
+            return;
+        }
+        case Value::UNDEFINED:
+            out += "undefined";
+            return;
+    }
+}
+
+/**
+ * JSON format without spaces
+ */
+static void appendJson(const Value& value, std::string& out) {
+    switch (value.type) {
+        case Value::INTEGER:
+            appendInt(value.getInt(), out);
+            return;
+        case Value::BOOLEAN:
+            out += value.getBool() ? "true" : "false";
+            return;
+        case Value::LIST: {
+            const auto& list = value.getList();
+            out += '[';
+            for (size_t i = 0; i < list.size(); i++) {
+                if (i > 0) out += ',';
+                appendJson(list[i], out);
+            }
+            out += ']';
+            return;
+        }
+        case Value::DICT: {
+            const auto& entries = value.getDict().items();
+            out += '{';
+            for (size_t i = 0; i < entries.size(); i++) {
+                if (i > 0) out += ',';
+                out += '"';
+                appendJson(Dict::decodeKey(entries[i].key), out);
+                out += "\":";
+                appendJson(entries[i].value, out);
+            }
+            out += '}';
+            return;
+        }
+        case Value::MATRIX: {
+            const auto& matrix = value.getMatrix();
+            out += '[';
+            for (int i = 0; i < matrix.rows(); i++) {
+                if (i > 0) out += ',';
+                const int* row = matrix.row(i);
+                out += '[';
+                for (int j = 0; j < matrix.columns(); j++) {
+                    if (j > 0) out += ',';
+                    appendInt(row[j], out);
+                }
+                out += ']';
+            }
+            out += ']';
+            return;
+        }
+        case Value::UNDEFINED:
+            out += "null";
+            return;
+    }
+}
+
+/**
+ * Binary format
+ *
+ * Integers use zigzag encoding so that small negative numbers also take few bytes,
+ * a matrix is written as a list of rows, each a list of integers
+ */
+static void appendBinary(const Value& value, std::string& out) {
+    switch (value.type) {
+        case Value::INTEGER: {
+            int64_t n = value.getInt();
+            out += static_cast<char>(RecordTag::INT);
+            appendVarint((static_cast<uint64_t>(n) << 1) ^ static_cast<uint64_t>(n >> 63), out);
+            return;
+        }
+        case Value::BOOLEAN:
+            out += static_cast<char>(RecordTag::BOOL);
+            out += static_cast<char>(value.getBool() ? 1 : 0);
+            return;
+        case Value::LIST: {
+            const auto& list = value.getList();
+            out += static_cast<char>(RecordTag::LIST);
+            appendVarint(list.size(), out);
+            for (const auto& element : list) {
+                appendBinary(element, out);
+            }
+            return;
+        }
+        case Value::DICT: {
+            const auto& entries = value.getDict().items();
+            out += static_cast<char>(RecordTag::DICT);
+            appendVarint(entries.size(), out);
+            for (const auto& entry : entries) {
+                appendBinary(Dict::decodeKey(entry.key), out);
+                appendBinary(entry.value, out);
+            }
+            return;
+        }
+        case Value::MATRIX: {
+            const auto& matrix = value.getMatrix();
+            out += static_cast<char>(RecordTag::LIST);
+            appendVarint(matrix.rows(), out);
+            for (int i = 0; i < matrix.rows(); i++) {
+                const int* row = matrix.row(i);
+                out += static_cast<char>(RecordTag::LIST);
+                appendVarint(matrix.columns(), out);
+                for (int j = 0; j < matrix.columns(); j++) {
+                    int64_t n = row[j];
+                    out += static_cast<char>(RecordTag::INT);
+                    appendVarint((static_cast<uint64_t>(n) << 1) ^ static_cast<uint64_t>(n >> 63), out);
+                }
+            }
+            return;
+        }
+        case Value::UNDEFINED:
+            throw RuntimeError("Cannot print an undefined value");
+    }
+}
+
+void formatValue(const Value& value, OutputFormat format, std::string& out) {
+    switch (format) {
+        case OutputFormat::TEXT:
+            appendText(value, out);
+            out += '\n';
+            return;
+        case OutputFormat::NDJSON:
+            appendJson(value, out);
+            out += '\n';
+            return;
+        case OutputFormat::BINARY:
+            appendBinary(value, out);
+            return;
+    }
+}
+
+bool parseOutputFormat(const std::string& name, OutputFormat& format) {
+    if (name == "text") {
+        format = OutputFormat::TEXT;
+    } else if (name == "ndjson") {
+        format = OutputFormat::NDJSON;
+    } else if (name == "binary") {
+        format = OutputFormat::BINARY;
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,62 @@
+/**
+ * Guard Headers
+ */
+#ifndef FORMAT_H
+#define FORMAT_H
+
+/**
+ * Include for std::string used as output buffer
+ * 
+ * Include for Value
+ */
+#include <string>
+#include "value.h"
+
+/**
+ * Formats selectable with --output-format
+ * 
+ * TEXT: the Python-like text (42, True, [1, 2, 3], {1: True}) one value per line
+ * 
+ * NDJSON: one JSON value per line (42, true, [1,2,3], {"1":true}), dictionary keys become strings
+ * 
+ * A matrix is printed in every format as the list of its rows ([[0, 0], [0, 0]])
+ * 
+ * BINARY: self-delimiting typed records, see below
+ */
+enum class OutputFormat {
+    TEXT,
+    NDJSON,
+    BINARY
+};
+
+/**
+ * Tags of the binary records
+ * 
+ * INT: zigzag varint of the value
+ * 
+ * BOOL: one byte, 0 or 1
+ * 
+ * LIST: varint with the number of elements followed by the elements as records (also a matrix and its rows)
+ * 
+ * DICT: varint with the number of entries followed by key and value of each entry as records
+ */
+enum class RecordTag : unsigned char {
+    INT = 1,
+    BOOL = 2,
+    LIST = 3,
+    DICT = 4
+};
+
+/**
+ * Appends the record of a printed value to out, followed by the newline in the textual formats
+ * 
+ * The value is written directly from Value without building its string representation
+ */
+void formatValue(const Value& value, OutputFormat format, std::string& out);
+
+/**
+ * Converts the name used on the command line (text, ndjson, binary), returns false if unknown
+ */
+bool parseOutputFormat(const std::string& name, OutputFormat& format);
+
+#endif // FORMAT_H
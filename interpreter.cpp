@@ -1,27 +1,218 @@
 /**
  * Implementation of the Interpreter class
+ * 
+ * Include for loadInts and saveInts used by the list I/O builtins
+ * 
+ * Include for std::min used to find the next promotion of a loop
+ *
+ * Include for saveCheckpoint and loadCheckpoint used by the checkpoints
  */
 #include "interpreter.h"
+#include "list_io.h"
+#include "checkpoint.h"
+#include <algorithm>
+
+/**
+ * Initializes inLoop flag to false and prints on the standard output
+ */
+Interpreter::Interpreter()
+    : inLoop(false), output(&defaultOutput), outputFormat(OutputFormat::TEXT), optimizationLevel(1),
+      safePointInterval(0), budget(0), quantum(0), yieldHook(nullptr), checkpointSeconds(0), sourceHash(0),
+      program(nullptr) {}
+
+/**
+ * Send the output of the print statements to another sink
+ */
+void Interpreter::setOutput(OutputSink& sink) {
+    output = &sink;
+}
+
+/**
+ * Print the values as text, ndjson or binary records
+ */
+void Interpreter::setOutputFormat(OutputFormat format) {
+    outputFormat = format;
+}
+
+/**
+ * Level 0 runs every statement with the tree walker, level 1 enables the vectorized loops
+ */
+void Interpreter::setOptimizationLevel(int level) {
+    optimizationLevel = level;
+}
 
 /**
- * Initializes inLoop flag to false
+ * Number of back-edges after which a loop is compiled (tier 1) or run by its kernel (tier 2)
  */
-Interpreter::Interpreter() : inLoop(false) {}
+void Interpreter::setTierThresholds(const TierThresholds& tierThresholds) {
+    thresholds = tierThresholds;
+}
+
+/**
+ * Iterations executed by each tier and number of compiled loops
+ */
+const TierStats& Interpreter::getStats() const {
+    return stats;
+}
+
+/**
+ * Cooperative preemption: after every steps back-edges of the loops the execution calls yield, which can
+ * switch to another green thread and return later (see Scheduler); 0 steps disables it
+ *
+ * The kernels of tier 2 run their iterations without yielding, they are bounded by the length of their lists
+ */
+void Interpreter::setPreemption(size_t steps, void (*yield)()) {
+    quantum = yield ? steps : 0;
+    yieldHook = quantum ? yield : nullptr;
+    scheduleSafePoints();
+}
+
+/**
+ * Every seconds (0 disables them) a loop back-edge writes the variables and the position of the loop to file,
+ * source is the hash of the source that the checkpoint belongs to
+ *
+ * The time is checked only at the safe points, every CHECKPOINT_POLL back-edges (or every quantum);
+ * the iterations of the kernels of tier 2 have no safe points
+ */
+void Interpreter::setCheckpoints(const std::string& file, size_t seconds, uint64_t source) {
+    checkpointFile = file;
+    checkpointSeconds = seconds;
+    sourceHash = source;
+    scheduleSafePoints();
+}
+
+/**
+ * The next execute() starts from the checkpoint in file instead of the beginning, source is the hash
+ * of the source of the program, which must be the one that wrote the checkpoint
+ */
+void Interpreter::setResume(const std::string& file, uint64_t source) {
+    resumeFile = file;
+    sourceHash = source;
+}
+
+/**
+ * Back-edges between two safe points: the quantum if the loops yield, otherwise CHECKPOINT_POLL if there
+ * are checkpoints, otherwise there are no safe points
+ */
+void Interpreter::scheduleSafePoints() {
+    safePointInterval = quantum ? quantum : (checkpointSeconds ? CHECKPOINT_POLL : 0);
+    budget = safePointInterval;
+}
+
+/**
+ * Gives the loops of the program the hotness and type feedback of a previous run
+ * 
+ * If the profile was saved for the same source (its hash is source) the records are the loops of the program
+ * in order, so the n-th loop gets the n-th record and no shape needs to be computed. Otherwise the loops are
+ * matched by shape, the n-th loop with a shape gets the n-th record with that shape; records without a loop
+ * are ignored
+ */
+void Interpreter::importProfile(Program& program, const ProgramProfile& profile, uint64_t source) {
+    if (profile.source == source) {
+        std::vector<LoopShape> loops = findLoops(program, false);
+        if (loops.size() == profile.loops.size()) {
+            for (size_t i = 0; i < loops.size(); i++) {
+                LoopProfile& loopProfile = loopProfiles[loops[i].loop];
+                loopProfile.backEdges = profile.loops[i].backEdges;
+                loopProfile.feedback = profile.loops[i].feedback;
+            }
+            return;
+        }
+    }
+
+    std::unordered_map<uint64_t, std::vector<const LoopRecord*>> records;
+    for (const auto& record : profile.loops) {
+        records[record.shape].push_back(&record);
+    }
+
+    std::unordered_map<uint64_t, size_t> seen;
+    for (const auto& loop : findLoops(program)) {
+        size_t occurrence = seen[loop.shape]++;
+        auto it = records.find(loop.shape);
+        if (it == records.end() || occurrence >= it->second.size()) continue;
+
+        const LoopRecord& record = *it->second[occurrence];
+        LoopProfile& loopProfile = loopProfiles[loop.loop];
+        loopProfile.backEdges = record.backEdges;
+        loopProfile.feedback = record.feedback;
+    }
+}
+
+/**
+ * Hotness and type feedback of every loop of the program, the source hash is left to the caller
+ */
+ProgramProfile Interpreter::exportProfile(Program& program) const {
+    ProgramProfile profile;
+    for (const auto& loop : findLoops(program)) {
+        LoopRecord record;
+        record.shape = loop.shape;
+
+        auto it = loopProfiles.find(loop.loop);
+        if (it != loopProfiles.end()) {
+            record.backEdges = it->second.backEdges;
+            record.feedback = it->second.feedback;
+        }
+        profile.loops.push_back(std::move(record));
+    }
+    return profile;
+}
 
 /**
  * Esecute the root program node
  * 
- * Try to use accept to traverse AST in case of errors it reports them
+ * Analyzes the program if optimizations are enabled, then
+ * try to use accept to traverse AST in case of errors it reports them
+ * 
+ * The lists and dictionaries of the execution live in the arena of the thread (the one already active,
+ * like the arena of a green thread, otherwise the local one), which is reset in one operation at the end,
+ * after the values have been released
  */
 void Interpreter::execute(Program& program) {
+    if (optimizationLevel > 0) {
+        optimizer.analyze(program);
+    }
+
+    ArenaScope scope(Arena::active() ? *Arena::active() : Arena::local());
+
+    this->program = &program;
+    loopPositions.clear();
+    outputBytes = 0;
+    nextCheckpoint = std::chrono::steady_clock::now() + std::chrono::seconds(checkpointSeconds);
+
     try {
-        program.accept(*this);
-    } catch (const RuntimeError& e) {
-        throw e;
+        if (!resumeFile.empty()) {
+            ResumePath position = loadCheckpoint(resumeFile, sourceHash, variables, outputBytes);
+            if (!isLoopPosition(program, position)) {
+                throw std::runtime_error("Invalid checkpoint file " + resumeFile);
+            }
+            resume(program, position);
+        } else {
+            program.accept(*this);
+        }
     } catch (const BreakException&) {
+        releaseValues();
         throw RuntimeError("'break' outside loop");
     } catch (const ContinueException&) {
+        releaseValues();
         throw RuntimeError("'continue' outside loop");
+    } catch (...) {
+        releaseValues();
+        throw;
+    }
+
+    releaseValues();
+}
+
+/**
+ * Destroys the values of the execution before its arena is reset
+ * 
+ * The compiled loops point to the variables, they are compiled again if the interpreter is executed again
+ */
+void Interpreter::releaseValues() {
+    variables.clear();
+    currentValue = Value();
+    for (auto& entry : loopProfiles) {
+        entry.second.compiled.reset();
     }
 }
 
@@ -33,6 +224,28 @@ Value Interpreter::evaluateExpression(Expression& expr) {
     return currentValue;
 }
 
+/**
+ * Evaluate an operand that is only read (len(x), k in d)
+ * 
+ * A variable is returned by reference, so a list or dictionary is not copied just to be inspected,
+ * any other expression is evaluated into scratch
+ */
+const Value& Interpreter::evaluateOperand(Expression& expr, Value& scratch) {
+    if (auto identifier = dynamic_cast<Identifier*>(&expr)) {
+        auto it = variables.find(identifier->name);
+        if (it == variables.end()) {
+            throw RuntimeError("Undefined variable '" + identifier->name + "'");
+        }
+        if (it->second.type == Value::UNDEFINED) {
+            throw RuntimeError("Variable '" + identifier->name + "' is undefined");
+        }
+        return it->second;
+    }
+    
+    scratch = evaluateExpression(expr);
+    return scratch;
+}
+
 /**
  * Execute a statement node
  */
@@ -40,6 +253,94 @@ void Interpreter::executeStatement(Statement& stmt) {
     stmt.accept(*this);
 }
 
+/**
+ * Evaluate the index and store an already evaluated value in an element of a list or in a dictionary,
+ * or in a cell of a matrix when the target has a column
+ * 
+ * Reports the same errors as ListAssignment and MatrixAssignment
+ */
+void Interpreter::storeElement(const std::string& name, Expression& index, Expression* column, Value&& value) {
+    if (column) {
+        int& cell = matrixCell(name, index, *column);
+        if (value.type != Value::INTEGER) {
+            throw RuntimeError("Matrix elements must be integers");
+        }
+        cell = value.getInt();
+        return;
+    }
+    
+    auto it = variables.find(name);
+    if (it == variables.end()) {
+        throw RuntimeError("Undefined variable '" + name + "'");
+    }
+    
+    if (it->second.type == Value::DICT) {
+        Value key = evaluateExpression(index);
+        it->second.getDict()[key] = std::move(value);
+        return;
+    }
+    
+    if (it->second.type != Value::LIST) {
+        throw RuntimeError("Variable '" + name + "' is not a list");
+    }
+    
+    Value indexValue = evaluateExpression(index);
+    if (indexValue.type != Value::INTEGER) {
+        throw RuntimeError("List index must be an integer");
+    }
+    
+    int position = indexValue.getInt();
+    auto& list = it->second.getList();
+    
+    if (position < 0 || position >= static_cast<int>(list.size())) {
+        throw RuntimeError("List index out of range");
+    }
+    
+    list[position] = std::move(value);
+}
+
+/**
+ * Evaluate row and column and return the cell of the matrix
+ * 
+ * Both indices are checked by one comparison each as unsigned, so a negative index is out of range too
+ */
+int& Interpreter::matrixCell(const std::string& name, Expression& row, Expression& column) {
+    auto it = variables.find(name);
+    if (it == variables.end()) {
+        throw RuntimeError("Undefined variable '" + name + "'");
+    }
+    
+    if (it->second.type != Value::MATRIX) {
+        throw RuntimeError("Variable '" + name + "' is not a matrix");
+    }
+    
+    Value rowValue = evaluateExpression(row);
+    Value columnValue = evaluateExpression(column);
+    if (rowValue.type != Value::INTEGER || columnValue.type != Value::INTEGER) {
+        throw RuntimeError("Matrix index must be an integer");
+    }
+    
+    auto& matrix = it->second.getMatrix();
+    int i = rowValue.getInt();
+    int j = columnValue.getInt();
+    
+    if (!matrix.contains(i, j)) {
+        throw RuntimeError("Matrix index out of range");
+    }
+    
+    return matrix.at(i, j);
+}
+
+/**
+ * Format a value in the selected format and send it to the output
+ */
+void Interpreter::print(const Value& value) {
+    printBuffer.clear();
+    formatValue(value, outputFormat, printBuffer);
+    output->write(printBuffer.data(), printBuffer.size());
+    outputBytes += printBuffer.size();
+}
+
 // ========== EXPRESSIONS ==========
 
 /**
@@ -74,6 +375,8 @@ void Interpreter::visit(Identifier& node) {
 
 /**
  * Visit ListAccess: evalute index, check bounds and store element value
+ * 
+ * The same syntax reads the value of a key from a dictionary
  */
 void Interpreter::visit(ListAccess& node) {
     auto it = variables.find(node.listName);
@@ -81,6 +384,16 @@ void Interpreter::visit(ListAccess& node) {
         throw RuntimeError("Undefined variable '" + node.listName + "'");
     }
     
+    if (it->second.type == Value::DICT) {
+        Value key = evaluateExpression(*node.index);
+        const Value* value = it->second.getDict().find(key);
+        if (!value) {
+            throw RuntimeError("Key not found in dictionary");
+        }
+        currentValue = *value;
+        return;
+    }
+    
     if (it->second.type != Value::LIST) {
         throw RuntimeError("Variable '" + node.listName + "' is not a list");
     }
@@ -104,6 +417,31 @@ void Interpreter::visit(ListAccess& node) {
     currentValue = list[index];
 }
 
+/**
+ * Visit MatrixAccess: store the integer in the cell
+ */
+void Interpreter::visit(MatrixAccess& node) {
+    currentValue = Value(matrixCell(node.matrixName, *node.row, *node.column));
+}
+
+/**
+ * Visit Length: store the number of elements of a list or dictionary, the rows of a matrix
+ */
+void Interpreter::visit(Length& node) {
+    Value scratch;
+    const Value& operand = evaluateOperand(*node.operand, scratch);
+    
+    if (operand.type == Value::LIST) {
+        currentValue = Value(static_cast<int>(operand.getList().size()));
+    } else if (operand.type == Value::DICT) {
+        currentValue = Value(static_cast<int>(operand.getDict().size()));
+    } else if (operand.type == Value::MATRIX) {
+        currentValue = Value(operand.getMatrix().rows());
+    } else {
+        throw RuntimeError("len() requires a list, dictionary or matrix");
+    }
+}
+
 /**
  * Visit UnaryOperation: evalute operand and perform operation
  */
@@ -115,49 +453,115 @@ void Interpreter::visit(UnaryOperation& node) {
 /**
  * Visit VinaryOperation: evalute operands and perform operation
  * 
+ * A chain of binary operators (1 + 2 + ... + n) is a left-deep tree as tall as the chain: the left operand
+ * is evaluated recursively until the chain is MAX_OPERAND_RECURSION operators deep, then evaluateChain
+ * finishes it without recursion, so a long chain cannot exhaust the stack
+ */
+void Interpreter::visit(BinaryOperation& node) {
+    if (operandDepth >= MAX_OPERAND_RECURSION) {
+        evaluateChain(node);
+        return;
+    }
+
+    OperandDepth deeper(operandDepth);
+    Value left = evaluateExpression(*node.left);
+    currentValue = applyBinaryOperation(node, left);
+}
+
+/**
+ * Evaluates a chain without recursing into the left operands: the nodes of the left spine are collected
+ * (on the stack, on the heap only beyond INLINE_SPINE nodes), the innermost left operand is evaluated and
+ * the operators are applied from the innermost outwards
+ */
+void Interpreter::evaluateChain(BinaryOperation& node) {
+    BinaryOperation* inlineSpine[INLINE_SPINE];
+    std::vector<BinaryOperation*> heapSpine;
+    size_t length = 0;
+
+    for (BinaryOperation* current = &node; current; current = dynamic_cast<BinaryOperation*>(current->left.get())) {
+        if (length < INLINE_SPINE) {
+            inlineSpine[length] = current;
+        } else {
+            if (heapSpine.empty()) {
+                heapSpine.assign(inlineSpine, inlineSpine + INLINE_SPINE);
+            }
+            heapSpine.push_back(current);
+        }
+        length++;
+    }
+    BinaryOperation** spine = length <= INLINE_SPINE ? inlineSpine : heapSpine.data();
+
+    Value value = evaluateExpression(*spine[length - 1]->left);
+    for (size_t i = length; i-- > 0;) {
+        value = applyBinaryOperation(*spine[i], value);
+    }
+    currentValue = std::move(value);
+}
+
+/**
+ * Result of the operator of node given the value of its left operand, evaluating the right one
+ * 
  * I implement short-circuit evaluation for AND/OR separately from the rest of the binary operations because:
  * - THe specification explicitly requires this semantics 
  * - I avoid unnecessary evaluation of the second operand
  * - I maintain consistency with stanrdard Python
+ * 
+ * Divisions marked by the Optimizer use the cached magic number of their divisor,
+ * division by zero and type errors still go through performBinaryOperation
+ * 
+ * The membership test reads the list or dictionary in place instead of copying it
  */
-void Interpreter::visit(BinaryOperation& node) {
+Value Interpreter::applyBinaryOperation(BinaryOperation& node, const Value& left) {
     if (node.op == BinaryOperation::Operator::AND) {
-        Value left = evaluateExpression(*node.left);
         if (left.type != Value::BOOLEAN) {
             throw RuntimeError("Logical AND requires boolean operands");
         }
         if (!left.getBool()) {
-            currentValue = Value(false);
-            return;
+            return Value(false);
         }
         Value right = evaluateExpression(*node.right);
         if (right.type != Value::BOOLEAN) {
             throw RuntimeError("Logical AND requires boolean operands");
         }
-        currentValue = Value(right.getBool());
-        return;
+        return Value(right.getBool());
     }
     
     if (node.op == BinaryOperation::Operator::OR) {
-        Value left = evaluateExpression(*node.left);
         if (left.type != Value::BOOLEAN) {
             throw RuntimeError("Logical OR requires boolean operands");
         }
         if (left.getBool()) {
-            currentValue = Value(true);
-            return;
+            return Value(true);
         }
         Value right = evaluateExpression(*node.right);
         if (right.type != Value::BOOLEAN) {
             throw RuntimeError("Logical OR requires boolean operands");
         }
-        currentValue = Value(right.getBool());
-        return;
+        return Value(right.getBool());
+    }
+
+    if (node.op == BinaryOperation::Operator::IN || node.op == BinaryOperation::Operator::NOT_IN) {
+        Value scratch;
+        const Value& container = evaluateOperand(*node.right, scratch);
+        bool found;
+        if (container.type == Value::DICT) {
+            found = container.getDict().contains(left);
+        } else if (container.type == Value::LIST) {
+            found = listContains(container.getList(), left);
+        } else {
+            throw RuntimeError("Membership test requires a list or dictionary");
+        }
+        return Value(node.op == BinaryOperation::Operator::IN ? found : !found);
     }
 
-    Value left = evaluateExpression(*node.left);
     Value right = evaluateExpression(*node.right);
-    currentValue = performBinaryOperation(left, node.op, right);
+
+    if (node.invariantDivisor && optimizationLevel > 0 && left.type == Value::INTEGER &&
+        right.type == Value::INTEGER && FastDivisor::supports(right.getInt())) {
+        return Value(node.divisor.divide(left.getInt(), right.getInt()));
+    }
+
+    return performBinaryOperation(left, node.op, right);
 }
 
 // ========== INSTRUCTIONS ==========
@@ -172,6 +576,8 @@ void Interpreter::visit(Assignment& node) {
 
 /**
  * Visit ListAssigment: set element ad index to evaluted value
+ * 
+ * The same syntax inserts or replaces a key of a dictionary
  */
 void Interpreter::visit(ListAssignment& node) {
     auto it = variables.find(node.listName);
@@ -179,6 +585,14 @@ void Interpreter::visit(ListAssignment& node) {
         throw RuntimeError("Undefined variable '" + node.listName + "'");
     }
     
+    if (it->second.type == Value::DICT) {
+        Value key = evaluateExpression(*node.index);
+        Dict::encodeKey(key); // rejects invalid keys before evaluating the value, as lists do with the index
+        Value value = evaluateExpression(*node.value);
+        it->second.getDict()[key] = value;
+        return;
+    }
+    
     if (it->second.type != Value::LIST) {
         throw RuntimeError("Variable '" + node.listName + "' is not a list");
     }
@@ -199,11 +613,88 @@ void Interpreter::visit(ListAssignment& node) {
     list[index] = value;
 }
 
+/**
+ * Visit MatrixAssignment: set the cell to the evaluated value, which must be an integer
+ * 
+ * The indices are checked before the value is evaluated, as for lists
+ */
+void Interpreter::visit(MatrixAssignment& node) {
+    int& cell = matrixCell(node.matrixName, *node.row, *node.column);
+    Value value = evaluateExpression(*node.value);
+    if (value.type != Value::INTEGER) {
+        throw RuntimeError("Matrix elements must be integers");
+    }
+    cell = value.getInt();
+}
+
+/**
+ * Visit MultipleAssignment: evaluate all the values, then assign the targets from left to right
+ * 
+ * The values are kept in a buffer on the stack (on the heap only beyond INLINE_TARGETS targets) and moved
+ * into the targets, so a, b = b, a + b needs no tuple object and v[i], v[j] = v[j], v[i] no temporary variable
+ */
+void Interpreter::visit(MultipleAssignment& node) {
+    const size_t count = node.values.size();
+    Value inlineValues[INLINE_TARGETS];
+    List heapValues;
+    Value* values = inlineValues;
+    if (count > INLINE_TARGETS) {
+        heapValues.resize(count);
+        values = heapValues.data();
+    }
+    
+    for (size_t i = 0; i < count; i++) {
+        values[i] = evaluateExpression(*node.values[i]);
+    }
+    
+    for (size_t i = 0; i < count; i++) {
+        auto& target = node.targets[i];
+        if (target.index) {
+            storeElement(target.name, *target.index, target.column.get(), std::move(values[i]));
+        } else {
+            variables[target.name] = std::move(values[i]);
+        }
+    }
+}
+
 /**
  * Visit ListCreation: create an empty list and assing to variable
+ *
+ * A creation marked by the Optimizer empties the list already in the variable instead, so that the
+ * appends of the next iteration fill the same buffer; every other list only holds copies of its
+ * elements, so nothing else can see the old ones
  */
 void Interpreter::visit(ListCreation& node) {
-    variables[node.variableName] = Value(std::vector<Value>());
+    if (node.recycleBuffer) {
+        auto it = variables.find(node.variableName);
+        if (it != variables.end() && it->second.type == Value::LIST) {
+            it->second.getList().clear();
+            return;
+        }
+    }
+    variables[node.variableName] = Value(List());
+}
+
+/**
+ * Visit DictCreation: create an empty dictionary and assing to variable
+ */
+void Interpreter::visit(DictCreation& node) {
+    variables[node.variableName] = Value(Dict());
+}
+
+/**
+ * Visit MatrixCreation: create a matrix of zeros and assign to variable
+ */
+void Interpreter::visit(MatrixCreation& node) {
+    Value rows = evaluateExpression(*node.rows);
+    Value columns = evaluateExpression(*node.columns);
+    if (rows.type != Value::INTEGER || columns.type != Value::INTEGER) {
+        throw RuntimeError("Matrix dimensions must be integers");
+    }
+    if (rows.getInt() < 0 || columns.getInt() < 0) {
+        throw RuntimeError("Matrix dimensions cannot be negative");
+    }
+    variables[node.variableName] = Value(Matrix(rows.getInt(), columns.getInt()));
 }
 
 /**
@@ -224,11 +715,59 @@ void Interpreter::visit(ListAppend& node) {
 }
 
 /**
- * Visit PrintStatement: evalute expression and print result
+ * Visit ListBulkAppend: append all the literals with a single reserve
+ */
+void Interpreter::visit(ListBulkAppend& node) {
+    auto it = variables.find(node.listName);
+    if (it == variables.end()) {
+        throw RuntimeError("Undefined variable '" + node.listName + "'");
+    }
+    
+    if (it->second.type != Value::LIST) {
+        throw RuntimeError("Variable '" + node.listName + "' is not a list");
+    }
+    
+    auto& list = it->second.getList();
+    list.reserve(list.size() + node.values.size());
+    if (node.elementType == DataType::BOOLEAN) {
+        for (int value : node.values) {
+            list.push_back(Value(value != 0));
+        }
+    } else {
+        for (int value : node.values) {
+            list.push_back(Value(value));
+        }
+    }
+}
+
+/**
+ * Visit ListLoad: read the integers of the file into a new list
+ */
+void Interpreter::visit(ListLoad& node) {
+    variables[node.variableName] = Value(loadInts(node.path));
+}
+
+/**
+ * Visit ListSave: write the integers of the list to the file
+ */
+void Interpreter::visit(ListSave& node) {
+    auto it = variables.find(node.listName);
+    if (it == variables.end()) {
+        throw RuntimeError("Undefined variable '" + node.listName + "'");
+    }
+    
+    if (it->second.type != Value::LIST) {
+        throw RuntimeError("Variable '" + node.listName + "' is not a list");
+    }
+    
+    saveInts(it->second.getList(), node.path);
+}
+
+/**
+ * Visit PrintStatement: evalute expression and print result in the selected format
  */
 void Interpreter::visit(PrintStatement& node) {
-    Value value = evaluateExpression(*node.expression);
-    std::cout << value.toString() << std::endl;
+    print(evaluateExpression(*node.expression));
 }
 
 /**
@@ -290,7 +829,38 @@ void Interpreter::visit(WhileStatement& node) {
     inLoop = true;
     
     try {
-        while (true) {
+        runLoop(node);
+    } catch (...) {
+        inLoop = wasInLoop;
+        throw;
+    }
+    
+    inLoop = wasInLoop;
+}
+
+/**
+ * Every loop starts in the tree walker (tier 0) and counts its back-edges; when the loop is entered with
+ * enough of them, or when a back-edge reaches a threshold while it runs here, it is promoted from that point
+ * (see promoteLoop)
+ * 
+ * A loop that comes back from a deoptimization first finishes here the iteration that was interrupted
+ */
+void Interpreter::runLoop(WhileStatement& node) {
+    LoopProfile& profile = loopProfiles[&node];
+    ResumePath resumeAt;
+
+    if (optimizationLevel > 0 && promoteLoop(node, profile, resumeAt)) {
+        return;
+    }
+
+    while (true) {
+        if (!resumeAt.empty()) {
+            bool more = resumeIteration(node, resumeAt, 0);
+            resumeAt.clear();
+            if (!more) {
+                break;
+            }
+        } else {
             Value condition = evaluateExpression(*node.condition);
             
             if (condition.type != Value::BOOLEAN) {
@@ -301,20 +871,157 @@ void Interpreter::visit(WhileStatement& node) {
                 break;
             }
             
+            profile.backEdges++;
+            stats.iterations[TIER0]++;
+            safePoint(node);
+            
             try {
                 executeStatement(*node.body);
             } catch (const ContinueException&) {
-                continue;
             } catch (const BreakException&) {
                 break;
             }
         }
-    } catch (...) {
+
+        if (optimizationLevel > 0 && profile.backEdges >= profile.nextPromotion) {
+            stats.replacements++;
+            if (promoteLoop(node, profile, resumeAt)) {
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * Moves the loop to the highest tier its hotness allows, continuing from the current state of the variables
+ * (the next thing to do is checking the condition):
+ * - tier 2: if the loop matches a vectorized kernel, the kernel first runs all the iterations it can prove safe
+ * - tier 1: the remaining iterations (if any) are executed by the loop compiled into closures, which speculates
+ *   on the types of the variables; after a deoptimization it is compiled again, without speculating where it failed
+ * 
+ * Returns true if the loop has ended; otherwise it continues in the tree walker, from resumeAt if it was deoptimized
+ */
+bool Interpreter::promoteLoop(WhileStatement& node, LoopProfile& profile, ResumePath& resumeAt) {
+    if (profile.backEdges >= thresholds.tier2) {
+        if (const LoopKernel* kernel = optimizer.kernelFor(node)) {
+            size_t done = kernel->run(variables);
+            profile.backEdges += done;
+            stats.iterations[TIER2] += done;
+        }
+    }
+
+    if (profile.backEdges < thresholds.tier1) {
+        profile.nextPromotion = profile.backEdges < thresholds.tier2 ? std::min(thresholds.tier1, thresholds.tier2)
+                                                                     : thresholds.tier1;
+        return false;
+    }
+
+    if (!profile.compiled) {
+        profile.compiled = std::make_unique<CompiledLoop>(*this, node, profile.feedback);
+        stats.compiledLoops++;
+    }
+    if (profile.compiled->run(resumeAt)) {
+        return true;
+    }
+
+    stats.deoptimizations++;
+    profile.compiled.reset();
+    profile.nextPromotion = profile.backEdges + 1;
+    return false;
+}
+
+/**
+ * Finishes with the tree walker an iteration interrupted at path, returns false if the loop breaks
+ */
+bool Interpreter::resumeIteration(WhileStatement& node, const ResumePath& path, size_t depth) {
+    try {
+        resume(*node.body, path, depth);
+    } catch (const ContinueException&) {
+    } catch (const BreakException&) {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Executes stmt from the position path[depth..], then the statements that follow it in its blocks
+ * 
+ * A nested loop finishes its interrupted iteration and then continues normally
+ */
+void Interpreter::resume(Statement& stmt, const ResumePath& path, size_t depth) {
+    if (depth == path.size()) {
+        executeStatement(stmt);
+        return;
+    }
+
+    if (auto block = dynamic_cast<Block*>(&stmt)) {
+        size_t index = path[depth];
+        resume(*block->statements[index], path, depth + 1);
+        for (size_t i = index + 1; i < block->statements.size(); i++) {
+            executeStatement(*block->statements[i]);
+        }
+    } else if (auto ifStmt = dynamic_cast<IfStatement*>(&stmt)) {
+        size_t branch = path[depth];
+        if (branch == 0) {
+            resume(*ifStmt->thenBlock, path, depth + 1);
+        } else if (branch <= ifStmt->elifClauses.size()) {
+            resume(*ifStmt->elifClauses[branch - 1].body, path, depth + 1);
+        } else {
+            resume(*ifStmt->elseBlock, path, depth + 1);
+        }
+    } else if (auto loop = dynamic_cast<WhileStatement*>(&stmt)) {
+        bool wasInLoop = inLoop;
+        inLoop = true;
+        try {
+            if (resumeIteration(*loop, path, depth)) {
+                runLoop(*loop);
+            }
+        } catch (...) {
+            inLoop = wasInLoop;
+            throw;
+        }
         inLoop = wasInLoop;
-        throw;
     }
-    
-    inLoop = wasInLoop;
+}
+
+/**
+ * Continues the program from the position of a checkpoint (see checkpoint.h): the loop there starts again
+ * from its condition, then the enclosing loops finish their iterations and the rest of the program runs
+ */
+void Interpreter::resume(Program& node, const ResumePath& position) {
+    size_t index = position[0];
+    resume(*node.statements[index], position, 1);
+    for (size_t i = index + 1; i < node.statements.size(); i++) {
+        executeStatement(*node.statements[i]);
+    }
+}
+
+/**
+ * Safe point at a back-edge of node: writes the checkpoint if it is due, then yields if the loops are preemptible
+ */
+void Interpreter::reachSafePoint(WhileStatement& node) {
+    budget = safePointInterval;
+
+    if (checkpointSeconds != 0 && std::chrono::steady_clock::now() >= nextCheckpoint) {
+        writeCheckpoint(node);
+        nextCheckpoint = std::chrono::steady_clock::now() + std::chrono::seconds(checkpointSeconds);
+    }
+
+    if (yieldHook) {
+        yieldHook();
+    }
+}
+
+/**
+ * Writes the variables and the position of node, the output printed so far is flushed first
+ * so that it is complete up to the checkpoint
+ */
+void Interpreter::writeCheckpoint(WhileStatement& node) {
+    if (loopPositions.empty()) {
+        loopPositions = findLoopPositions(*program);
+    }
+    output->flush();
+    saveCheckpoint(checkpointFile, sourceHash, outputBytes, loopPositions.at(&node), variables);
 }
 
 /**
@@ -337,6 +1044,35 @@ void Interpreter::visit(Program& node) {
 
 // ========== HELPER METHODS ==========
 
+/**
+ * Linear search of x in a list, elements of a different type are simply not equal
+ * 
+ * The type of x is checked once, then the loop only compares the tag and the payload of each element
+ * without building temporary Values
+ */
+bool Interpreter::listContains(const List& list, const Value& x) {
+    if (x.type == Value::INTEGER) {
+        const int n = std::get<int>(x.data);
+        for (const Value& element : list) {
+            if (element.type == Value::INTEGER && *std::get_if<int>(&element.data) == n) return true;
+        }
+        return false;
+    }
+    
+    if (x.type == Value::BOOLEAN) {
+        const bool b = std::get<bool>(x.data);
+        for (const Value& element : list) {
+            if (element.type == Value::BOOLEAN && *std::get_if<bool>(&element.data) == b) return true;
+        }
+        return false;
+    }
+    
+    if (x.type == Value::MATRIX) {
+        throw RuntimeError("Cannot compare matrices");
+    }
+    throw RuntimeError(x.type == Value::DICT ? "Cannot compare dictionaries" : "Cannot compare lists");
+}
+
 /**
  * Perform a unary operation (- or not) and return the resulting Value
  */
@@ -421,6 +1157,10 @@ Value Interpreter::performBinaryOperation(const Value& left, BinaryOperation::Op
                 return Value(left.getInt() == right.getInt());
             } else if (left.type == Value::BOOLEAN) {
                 return Value(left.getBool() == right.getBool());
+            } else if (left.type == Value::DICT) {
+                throw RuntimeError("Cannot compare dictionaries");
+            } else if (left.type == Value::MATRIX) {
+                throw RuntimeError("Cannot compare matrices");
             }
             throw RuntimeError("Cannot compare lists");
             
@@ -432,12 +1172,20 @@ Value Interpreter::performBinaryOperation(const Value& left, BinaryOperation::Op
                 return Value(left.getInt() != right.getInt());
             } else if (left.type == Value::BOOLEAN) {
                 return Value(left.getBool() != right.getBool());
+            } else if (left.type == Value::DICT) {
+                throw RuntimeError("Cannot compare dictionaries");
+            } else if (left.type == Value::MATRIX) {
+                throw RuntimeError("Cannot compare matrices");
             }
             throw RuntimeError("Cannot compare lists");
             
         case BinaryOperation::Operator::AND:
         case BinaryOperation::Operator::OR:
             throw RuntimeError("Logical operators should be handled in visit(BinaryOperation)");
+
+        case BinaryOperation::Operator::IN:
+        case BinaryOperation::Operator::NOT_IN:
+            throw RuntimeError("Membership test should be handled in visit(BinaryOperation)");
     }
     throw RuntimeError("Unknown binary operator");
 }
\ No newline at end of file
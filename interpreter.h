@@ -7,87 +7,37 @@
 /**
  * Include for AST definitions
  * 
- * Include for std::unordered_map used as variable envitoment 
+ * Include for Value and RuntimeError
  * 
- * Include std::vector used inside Balue to represent list
+ * Include for OutputSink used in PrintStatement visitor
+ * 
+ * Include for OutputFormat used to format the printed values
  * 
- * Include for std::variant used in Value to store int, bool or list in one 
+ * Include for Optimizer used to find the loops executed by native kernels
  * 
- * Include fot std::runtime_error used as base for RuntimeError
+ * Include for the tiers, their thresholds and statistics
  * 
- * Include for std::count and std::endl used in PrintStatement visitor
+ * Include for ProgramProfile used to save and restore the profiles of the loops
+ * 
+ * Include for std::unordered_map used as variable envitoment 
+ * 
+ * Include std::vector used inside Balue to represent list
+ * 
+ * Include for std::exception used as base for the control flow exceptions
+ *
+ * Include for std::chrono::steady_clock used to time the checkpoints
  */
 #include "ast.h"
+#include "value.h"
+#include "output.h"
+#include "format.h"
+#include "optimizer.h"
+#include "tiering.h"
+#include "profile.h"
 #include <unordered_map>
 #include <vector>
-#include <variant>
 #include <stdexcept>
-#include <iostream>
-
-/**
- * Expetion for runtime errors
- * 
- * Inherits from std::runtime_error and prefixes the message with "Error:"
- */
-class RuntimeError : public std::runtime_error {
-public:
-    RuntimeError(const std::string& message) : std::runtime_error("Error: " + message) {}
-};
-
-/**
- * Rapresents a value in the Interpreter (interger, boolean or list)
- */
-class Value {
-public:
-    enum Type { INTEGER, BOOLEAN, LIST, UNDEFINED };
-    
-    Type type;
-    std::variant<int, bool, std::vector<Value>> data;
-    
-    Value() : type(UNDEFINED) {}
-    Value(int i) : type(INTEGER), data(i) {}
-    Value(bool b) : type(BOOLEAN), data(b) {}
-    Value(const std::vector<Value>& l) : type(LIST), data(l) {}
-
-    int getInt() const {
-        if (type != INTEGER) throw RuntimeError("Expected integer value");
-        return std::get<int>(data);
-    }
-    
-    bool getBool() const {
-        if (type != BOOLEAN) throw RuntimeError("Expected boolean value");
-        return std::get<bool>(data);
-    }
-    
-    std::vector<Value>& getList() {
-        if (type != LIST) throw RuntimeError("Expected list value");
-        return std::get<std::vector<Value>>(data);
-    }
-    
-    const std::vector<Value>& getList() const {
-        if (type != LIST) throw RuntimeError("Expected list value");
-        return std::get<std::vector<Value>>(data);
-    }
-    
-    std::string toString() const {
-        switch (type) {
-            case INTEGER: return std::to_string(getInt());
-            case BOOLEAN: return getBool() ? "True" : "False";
-            case LIST: {
-                const auto& list = getList();
-                std::string result = "[";
-                for (size_t i = 0; i < list.size(); i++) {
-                    if (i > 0) result += ", ";
-                    result += list[i].toString();
-                }
-                result += "]";
-                return result;
-            }
-            case UNDEFINED: return "undefined";
-        }
-        return "unknown";
-    }
-};
+#include <chrono>
 
 /**
  * Exceptions used to implement break/continue control flow
@@ -105,16 +55,41 @@ class ContinueException : public std::exception {};
  * Symbol table for variables
  * Current value being computed
  * Flag to indicate if we are inside a loop
+ * Destination of the print statements
+ * Format of the printed values and buffer reused to format them
+ * Optimization level and results of the static analysis
+ * Number of tuple assignment values kept on the stack
+ * Promotion thresholds, execution counters and profile of every loop
+ * Back-edges between two safe points, back-edges left before the next one, step quantum and the function that yields
+ * File, interval and time of the next checkpoint, checkpoint to resume from, hash of the source,
+ * running program and position of its loops
  * 
  * Public:
  * Exeutes the entire program
+ * Redirects the output of the print statements
+ * Selects the format of the printed values
+ * Selects the optimization level (0 disables every optimization)
+ * Selects the promotion thresholds of the tiers and returns the counters
+ * Makes the loops give up the thread after a number of back-edges
+ * Writes checkpoints periodically and resumes from one
+ * Restores and collects the profiles of the loops of a program
  * Visitor implementations for expressions
  * Visitor impelemntations for statements
  * 
  * Private:
+ * Destroys the values of an execution
+ * Counts a back-edge, yields and writes the checkpoints at the safe points
+ * Continues a program from the position of a checkpoint
+ * Runs a loop from its condition, moving it between the tiers
+ * Resumes the tree walker where a deoptimized loop stopped
  * Consider an expression and returns its value
+ * Returns the value of an operand without copying it when it is a variable
  * Executes a single statement
+ * Assigns an element of a list or dictionary
+ * Finds the cell of a matrix, with the single bounds check of the access
+ * Prints a value in the selected format
  * Helper functions for unary and binary operations
+ * Membership test on lists
  */
 class Interpreter : public ASTVisitor {
 private:
@@ -123,23 +98,98 @@ private:
     Value currentValue;
 
     bool inLoop;
+
+    StdoutSink defaultOutput;
+    OutputSink* output;
+
+    OutputFormat outputFormat;
+    std::string printBuffer;
+
+    int optimizationLevel;
+    Optimizer optimizer;
+
+    static const size_t INLINE_TARGETS = 8;
+    static const size_t INLINE_SPINE = 16;
+    static const size_t MAX_OPERAND_RECURSION = 256;
+
+    size_t operandDepth = 0;
+
+    /**
+     * Counts a left operand being evaluated recursively, until it has been evaluated or has thrown
+     */
+    struct OperandDepth {
+        size_t& depth;
+        explicit OperandDepth(size_t& counter) : depth(counter) { depth++; }
+        ~OperandDepth() { depth--; }
+    };
+
+    TierThresholds thresholds;
+    TierStats stats;
+    std::unordered_map<const WhileStatement*, LoopProfile> loopProfiles;
+
+    static const size_t CHECKPOINT_POLL = 4096;
+
+    size_t safePointInterval;
+    size_t budget;
+    size_t quantum;
+    void (*yieldHook)();
+
+    std::string checkpointFile;
+    size_t checkpointSeconds;
+    std::chrono::steady_clock::time_point nextCheckpoint;
+    std::string resumeFile;
+    uint64_t sourceHash;
+    uint64_t outputBytes;
+    Program* program;
+    std::unordered_map<const WhileStatement*, ResumePath> loopPositions;
+
+    friend class CompiledLoop;
     
 public:
     Interpreter();
 
     void execute(Program& program);
 
+    void setOutput(OutputSink& sink);
+
+    void setOutputFormat(OutputFormat format);
+
+    void setOptimizationLevel(int level);
+
+    void setTierThresholds(const TierThresholds& tierThresholds);
+
+    const TierStats& getStats() const;
+
+    void setPreemption(size_t steps, void (*yield)());
+
+    void setCheckpoints(const std::string& file, size_t seconds, uint64_t source);
+
+    void setResume(const std::string& file, uint64_t source);
+
+    void importProfile(Program& program, const ProgramProfile& profile, uint64_t source);
+
+    ProgramProfile exportProfile(Program& program) const;
+
     void visit(NumberLiteral& node) override;
     void visit(BooleanLiteral& node) override;
     void visit(Identifier& node) override;
     void visit(ListAccess& node) override;
+    void visit(MatrixAccess& node) override;
+    void visit(Length& node) override;
     void visit(UnaryOperation& node) override;
     void visit(BinaryOperation& node) override;
     
     void visit(Assignment& node) override;
     void visit(ListAssignment& node) override;
+    void visit(MatrixAssignment& node) override;
+    void visit(MultipleAssignment& node) override;
     void visit(ListCreation& node) override;
+    void visit(DictCreation& node) override;
+    void visit(MatrixCreation& node) override;
     void visit(ListAppend& node) override;
+    void visit(ListBulkAppend& node) override;
+    void visit(ListLoad& node) override;
+    void visit(ListSave& node) override;
     void visit(PrintStatement& node) override;
     void visit(BreakStatement& node) override;
     void visit(ContinueStatement& node) override;
@@ -149,12 +199,48 @@ public:
     void visit(Program& node) override;
     
 private:
+    void releaseValues();
+
+    /**
+     * Called at every back-edge of node in tier 0 and tier 1, the state of the program is then only its variables
+     * and the position of node; every safePointInterval back-edges (never if it is 0) it is a safe point
+     */
+    void safePoint(WhileStatement& node) {
+        if (budget != 0 && --budget == 0) {
+            reachSafePoint(node);
+        }
+    }
+
+    void reachSafePoint(WhileStatement& node);
+    void scheduleSafePoints();
+    void writeCheckpoint(WhileStatement& node);
+
+    void resume(Program& node, const ResumePath& position);
+
+    void runLoop(WhileStatement& node);
+    bool promoteLoop(WhileStatement& node, LoopProfile& profile, ResumePath& resumeAt);
+
+    bool resumeIteration(WhileStatement& node, const ResumePath& path, size_t depth);
+    void resume(Statement& stmt, const ResumePath& path, size_t depth);
+
     Value evaluateExpression(Expression& expr);
 
+    const Value& evaluateOperand(Expression& expr, Value& scratch);
+
     void executeStatement(Statement& stmt);
 
+    void storeElement(const std::string& name, Expression& index, Expression* column, Value&& value);
+
+    int& matrixCell(const std::string& name, Expression& row, Expression& column);
+
+    void print(const Value& value);
+
+    void evaluateChain(BinaryOperation& node);
+    Value applyBinaryOperation(BinaryOperation& node, const Value& left);
     Value performBinaryOperation(const Value& left, BinaryOperation::Operator op, const Value& right);
     Value performUnaryOperation(UnaryOperation::Operator op, const Value& operand);
+
+    static bool listContains(const List& list, const Value& x);
 };
 
 #endif // INTERPRETER_H
\ No newline at end of file
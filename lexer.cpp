@@ -20,11 +20,17 @@ static std::unordered_map<std::string, TokenType> keywords = {
     {"break", TokenType::BREAK},
     {"continue", TokenType::CONTINUE},
     {"list", TokenType::LIST},
+    {"dict", TokenType::DICT},
+    {"matrix", TokenType::MATRIX},
+    {"len", TokenType::LEN},
     {"print", TokenType::PRINT},
     {"append", TokenType::APPEND},
+    {"load_ints", TokenType::LOADINTS},
+    {"save_ints", TokenType::SAVEINTS},
     {"and", TokenType::AND},
     {"or", TokenType::OR},
     {"not", TokenType::NOT},
+    {"in", TokenType::IN},
     {"True", TokenType::TRUE},
     {"False", TokenType::FALSE}
 };
@@ -158,6 +164,9 @@ Token Lexer::makeNumber() {
  * - can contain subsequent letters and numbers
  * - if the name matches a keyword, generates the keyword token
  * - else generates an identifier token
+ * 
+ * Underscores are not allowed in identifiers, they are only accepted when they complete
+ * the name of a builtin (load_ints, save_ints)
  */
 Token Lexer::makeIdentifier() {
     std::string idStr;
@@ -176,6 +185,21 @@ Token Lexer::makeIdentifier() {
         advance();
     }
 
+    if (currentChar() == '_') {
+        std::string builtin = idStr;
+        int length = 0;
+        while (isAlphaNum(peekChar(length)) || peekChar(length) == '_') {
+            builtin += peekChar(length);
+            length++;
+        }
+        if (keywords.find(builtin) != keywords.end()) {
+            for (int i = 0; i < length; i++) {
+                advance();
+            }
+            idStr = builtin;
+        }
+    }
+
     auto it = keywords.find(idStr);
     if (it != keywords.end()) {
         return Token(it->second, idStr, startLine, startColumn);
@@ -184,6 +208,29 @@ Token Lexer::makeIdentifier() {
     return Token(TokenType::ID, idStr, startLine, startColumn);
 }
 
+/**
+ * Recognizes a string literal between double quotes
+ * 
+ * Strings have no escape sequences and must end on the same line
+ */
+Token Lexer::makeString() {
+    int startLine = line;
+    int startColumn = column;
+    std::string str;
+
+    advance();
+    while (currentChar() != '"') {
+        if (currentChar() == '\n' || currentChar() == '\0') {
+            return Token(TokenType::ERROR, "Unterminated string literal", startLine, startColumn);
+        }
+        str += currentChar();
+        advance();
+    }
+    advance();
+
+    return Token(TokenType::STRING, str, startLine, startColumn);
+}
+
 /**
  * Supports two character operators (==, !=, <=, >=, //) or single-character operators (=, <, >)
  * 
@@ -365,6 +412,15 @@ std::vector<Token> Lexer::tokenize() {
             continue;
         }
 
+        if (c == '"') {
+            Token strToken = makeString();
+            tokens.push_back(strToken);
+            if (strToken.type == TokenType::ERROR) {
+                return tokens;
+            }
+            continue;
+        }
+
         if (c == '=' || c == '!' || c == '<' || c == '>' || c == '/') {
             Token opToken = makeTwoCharOperator();
             tokens.push_back(opToken);
@@ -31,6 +31,7 @@ enum class TokenType {
     ID,            // identifier [a-zA-Z][0-9a-zA-Z]*
     TRUE,          // True
     FALSE,         // False
+    STRING,        // "file name", only used as argument of load_ints/save_ints
     
     PLUS,          // +
     MINUS,         // -
@@ -47,6 +48,7 @@ enum class TokenType {
     AND,           // and
     OR,            // or
     NOT,           // not
+    IN,            // in
     
     IF,            // if
     ELIF,          // elif
@@ -55,8 +57,13 @@ enum class TokenType {
     BREAK,         // break
     CONTINUE,      // continue
     LIST,          // list
+    DICT,          // dict
+    MATRIX,        // matrix
+    LEN,           // len
     PRINT,         // print
     APPEND,        // append
+    LOADINTS,      // load_ints
+    SAVEINTS,      // save_ints
     
     ASSIGN,        // =
     LPAREN,        // (
@@ -118,6 +125,8 @@ private:
     Token makeNumber();
 
     Token makeIdentifier();
+
+    Token makeString();
     
     Token makeTwoCharOperator();
 
@@ -0,0 +1,175 @@
+/**
+ * Implementation of the buffers of the lists
+ *
+ * Include for Value, the elements of the list
+ *
+ * Include for ArenaAllocator used for the small buffers
+ *
+ * Include for std::memcpy used to relocate the elements
+ *
+ * Include for std::max used to size the buffers
+ *
+ * Include for the memory mapping primitives used for the large buffers (mmap, mremap, madvise, munmap)
+ */
+#include "list.h"
+#include "value.h"
+#include "arena.h"
+#include <cstring>
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+/**
+ * Large buffers are whole huge pages, so that the kernel can back all of them with huge pages
+ */
+static const size_t HUGE_PAGE = 2 * 1024 * 1024;
+
+static bool isLarge(size_t capacity) {
+    return capacity * sizeof(Value) >= List::LARGE_BYTES;
+}
+
+/**
+ * Allocates a buffer for at least capacity elements, capacity is updated with the elements that really fit:
+ * - a buffer from the arena is a whole block of its size class, so lists of nearby sizes share the same
+ *   free list and a recycled block is filled completely before the list has to grow again
+ * - a large buffer is rounded up to whole huge pages
+ */
+static Value* allocateBuffer(size_t& capacity) {
+    if (!isLarge(capacity)) {
+        if (Arena::active()) capacity = Arena::blockSize(capacity * sizeof(Value)) / sizeof(Value);
+        return ArenaAllocator<Value>().allocate(capacity);
+    }
+#ifdef __linux__
+    size_t bytes = (capacity * sizeof(Value) + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+    void* buffer = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffer == MAP_FAILED) throw std::bad_alloc();
+    madvise(buffer, bytes, MADV_HUGEPAGE);
+    capacity = bytes / sizeof(Value);
+    return static_cast<Value*>(buffer);
+#else
+    return static_cast<Value*>(::operator new(capacity * sizeof(Value)));
+#endif
+}
+
+static void freeBuffer(Value* buffer, size_t capacity) {
+    if (!buffer) return;
+    if (!isLarge(capacity)) {
+        ArenaAllocator<Value>().deallocate(buffer, capacity);
+        return;
+    }
+#ifdef __linux__
+    munmap(buffer, capacity * sizeof(Value));
+#else
+    ::operator delete(buffer);
+#endif
+}
+
+/**
+ * Moves the elements to a buffer of newCapacity elements (at least count)
+ *
+ * The elements are relocated with a copy of their bytes; between two large buffers on Linux
+ * mremap moves the pages themselves, the elements are not copied at all
+ */
+void List::relocate(size_t newCapacity) {
+#ifdef __linux__
+    if (isLarge(capacity) && isLarge(newCapacity)) {
+        size_t oldBytes = capacity * sizeof(Value);
+        size_t bytes = (newCapacity * sizeof(Value) + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+        void* buffer = mremap(elements, oldBytes, bytes, MREMAP_MAYMOVE);
+        if (buffer == MAP_FAILED) throw std::bad_alloc();
+        madvise(buffer, bytes, MADV_HUGEPAGE);
+        elements = static_cast<Value*>(buffer);
+        capacity = bytes / sizeof(Value);
+        return;
+    }
+#endif
+    Value* buffer = allocateBuffer(newCapacity);
+    if (count > 0) {
+        std::memcpy(static_cast<void*>(buffer), static_cast<const void*>(elements), count * sizeof(Value));
+    }
+    freeBuffer(elements, capacity);
+    elements = buffer;
+    capacity = newCapacity;
+}
+
+void List::appendSlow(Value&& value) {
+    Value pending(std::move(value));
+    relocate(std::max(capacity * 2, MIN_CAPACITY));
+    new (elements + count) Value(std::move(pending));
+    count++;
+}
+
+List::List(const List& other) {
+    if (other.count == 0) return;
+    size_t newCapacity = other.count;
+    elements = allocateBuffer(newCapacity);
+    capacity = newCapacity;
+    try {
+        for (; count < other.count; count++) {
+            new (elements + count) Value(other.elements[count]);
+        }
+    } catch (...) {
+        clear();
+        freeBuffer(elements, capacity);
+        throw;
+    }
+}
+
+List::List(List&& other) noexcept
+    : elements(other.elements), count(other.count), capacity(other.capacity) {
+    other.elements = nullptr;
+    other.count = 0;
+    other.capacity = 0;
+}
+
+List& List::operator=(const List& other) {
+    if (this != &other) {
+        List copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+List& List::operator=(List&& other) noexcept {
+    if (this != &other) {
+        clear();
+        freeBuffer(elements, capacity);
+        elements = other.elements;
+        count = other.count;
+        capacity = other.capacity;
+        other.elements = nullptr;
+        other.count = 0;
+        other.capacity = 0;
+    }
+    return *this;
+}
+
+List::~List() {
+    clear();
+    freeBuffer(elements, capacity);
+}
+
+void List::reserve(size_t minimum) {
+    if (minimum > capacity) relocate(minimum);
+}
+
+void List::resize(size_t newCount) {
+    if (newCount > capacity) relocate(std::max(newCount, capacity * 2));
+    while (count < newCount) {
+        new (elements + count) Value();
+        count++;
+    }
+    while (count > newCount) {
+        count--;
+        elements[count].~Value();
+    }
+}
+
+void List::clear() {
+    for (size_t i = 0; i < count; i++) {
+        elements[i].~Value();
+    }
+    count = 0;
+}
@@ -0,0 +1,75 @@
+/**
+ * Guard Headers
+ */
+#ifndef LIST_H
+#define LIST_H
+
+/**
+ * Include for size_t used for sizes
+ */
+#include <cstddef>
+
+/**
+ * Advance Declaration, List stores Values and Value can contain a List
+ */
+class Value;
+
+/**
+ * Elements of a list
+ *
+ * A vector of Values that manages its buffer itself instead of using std::vector, so that the buffer can be
+ * moved with the memory primitives: a Value holds an int, a bool, a List, a Dict or a Matrix (pointers) and none of them
+ * points inside itself, so moving a Value to another address is a copy of its bytes (relocation)
+ *
+ * Buffers up to LARGE_BYTES come from the arena of the execution (or the heap). Beyond that, on Linux,
+ * the buffer becomes an anonymous memory mapping:
+ * - transparent huge pages are requested with madvise(MADV_HUGEPAGE), so a scan uses fewer TLB entries
+ * - growing uses mremap, which moves the pages in the page table instead of copying the elements
+ * On other systems large buffers stay in the heap and grow with a copy of the bytes
+ *
+ * The capacity doubles when the buffer is full; the members that need the complete Value are defined in value.h
+ */
+class List {
+private:
+    Value* elements = nullptr;
+    size_t count = 0;
+    size_t capacity = 0;
+
+    void relocate(size_t newCapacity);
+
+    void appendSlow(Value&& value);
+
+public:
+    static constexpr size_t LARGE_BYTES = 4 * 1024 * 1024;
+    static constexpr size_t MIN_CAPACITY = 4;
+
+    List() = default;
+    List(const List& other);
+    List(List&& other) noexcept;
+    List& operator=(const List& other);
+    List& operator=(List&& other) noexcept;
+    ~List();
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    Value* data() { return elements; }
+    const Value* data() const { return elements; }
+
+    Value* begin() { return elements; }
+    const Value* begin() const { return elements; }
+    inline Value* end();
+    inline const Value* end() const;
+
+    inline Value& operator[](size_t index);
+    inline const Value& operator[](size_t index) const;
+
+    void reserve(size_t minimum);
+    void resize(size_t newCount);
+    void clear();
+
+    inline void push_back(const Value& value);
+    inline void push_back(Value&& value);
+};
+
+#endif // LIST_H
@@ -0,0 +1,123 @@
+/**
+ * Implementation of the bulk list I/O
+ * 
+ * Include for FileSink used to write the file in large blocks
+ * 
+ * Include for int64_t and std::memcpy used to decode the integers
+ * 
+ * Include for std::numeric_limits used to check the range of the values
+ * 
+ * Include for the POSIX primitives used to map the file (open, fstat, mmap)
+ */
+#include "list_io.h"
+#include "output.h"
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <fcntl.h>
+
+#ifdef _WIN32
+#include <fstream>
+#include <iterator>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Converts a little-endian 64-bit integer to the byte order of the host
+ */
+static int64_t fromLittleEndian(int64_t raw) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return static_cast<int64_t>(__builtin_bswap64(static_cast<uint64_t>(raw)));
+#else
+    return raw;
+#endif
+}
+
+/**
+ * Converts the mapped bytes into the list, checking every value
+ */
+static void decodeInts(const char* bytes, size_t count, const std::string& path, List& list) {
+    list.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        int64_t raw;
+        std::memcpy(&raw, bytes + i * sizeof(int64_t), sizeof(int64_t));
+        int64_t n = fromLittleEndian(raw);
+        if (n < std::numeric_limits<int>::min() || n > std::numeric_limits<int>::max()) {
+            throw RuntimeError("Integer out of range in '" + path + "'");
+        }
+        list.push_back(Value(static_cast<int>(n)));
+    }
+}
+
+List loadInts(const std::string& path) {
+    List list;
+
+#ifdef _WIN32
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw RuntimeError("Cannot open file '" + path + "'");
+    }
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (content.size() % sizeof(int64_t) != 0) {
+        throw RuntimeError("File '" + path + "' does not contain 64-bit integers");
+    }
+    decodeInts(content.data(), content.size() / sizeof(int64_t), path, list);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw RuntimeError("Cannot open file '" + path + "'");
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw RuntimeError("Cannot open file '" + path + "'");
+    }
+
+    size_t size = static_cast<size_t>(info.st_size);
+    if (size % sizeof(int64_t) != 0) {
+        ::close(fd);
+        throw RuntimeError("File '" + path + "' does not contain 64-bit integers");
+    }
+
+    if (size == 0) {
+        ::close(fd);
+        return list;
+    }
+
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        throw RuntimeError("Cannot map file '" + path + "'");
+    }
+    madvise(mapped, size, MADV_SEQUENTIAL);
+
+    try {
+        decodeInts(static_cast<const char*>(mapped), size / sizeof(int64_t), path, list);
+    } catch (...) {
+        munmap(mapped, size);
+        throw;
+    }
+    munmap(mapped, size);
+#endif
+
+    return list;
+}
+
+void saveInts(const List& list, const std::string& path) {
+    std::vector<int64_t> packed(list.size());
+    for (size_t i = 0; i < list.size(); i++) {
+        if (list[i].type != Value::INTEGER) {
+            throw RuntimeError("save_ints requires a list of integers");
+        }
+        packed[i] = fromLittleEndian(list[i].getInt());
+    }
+
+    size_t bytes = packed.size() * sizeof(int64_t);
+    FileSink file(path, static_cast<long long>(bytes));
+    file.write(reinterpret_cast<const char*>(packed.data()), bytes);
+    file.close();
+}
@@ -0,0 +1,37 @@
+/**
+ * Guard Headers
+ */
+#ifndef LIST_IO_H
+#define LIST_IO_H
+
+/**
+ * Include for std::string used for file names
+ * 
+ * Include for std::vector used for the lists
+ * 
+ * Include for Value
+ */
+#include <string>
+#include <vector>
+#include "value.h"
+
+/**
+ * Bulk I/O of integer lists used by the load_ints and save_ints builtins
+ * 
+ * The file format is a plain array of little-endian 64-bit integers without header
+ */
+
+/**
+ * Reads the whole file into a list of integers
+ * 
+ * The file is mapped in memory and converted in a single pass,
+ * values that do not fit in an int are reported as errors
+ */
+List loadInts(const std::string& path);
+
+/**
+ * Writes a list of integers to the file, replacing its content
+ */
+void saveInts(const List& list, const std::string& path);
+
+#endif // LIST_IO_H
@@ -4,10 +4,20 @@
  * Include for std::ifstream to read source file from disk
  * 
  * Include for std::stringstream to easily read entire file content
+ *
+ * Include for std::unique_ptr used to own the optional output file
+ *
+ * Include for std::snprintf used to format the digest of the output
+ *
+ * Include for std::thread::hardware_concurrency and std::max used for the default number of workers of a batch
  */
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <memory>
+#include <cstdio>
+#include <thread>
+#include <algorithm>
 
 /**
  * Include project headers for lexer, parser and interpreter
@@ -15,6 +25,10 @@
 #include "lexer.h"
 #include "parser.h"
 #include "interpreter.h"
+#include "output.h"
+#include "scheduler.h"
+#include "program_cache.h"
+#include "checkpoint.h"
 
 /**
  * Reads the entire content of a file into a string
@@ -47,44 +61,474 @@ std::string readFile(const std::string& filename) {
 }
 
 /**
- * Expects exactly one argument: the path to the source file to execute
+ * Command line options
+ *
+ * sourceFiles: paths of the programs to execute, with more than one they run as a batch
+ *
+ * outputFile: if not empty the print statements are written to this file (--output=FILE),
+ * the name hash replaces the output with its digest (--output=hash)
+ *
+ * preallocate: bytes reserved in the output file before writing (--preallocate=BYTES)
+ *
+ * asyncOutput: the output is written by a separate thread (--async-output)
+ *
+ * outputFormat: format of the printed values (--output-format=text|ndjson|binary)
+ *
+ * optimizationLevel: 0 runs only the tree walker, 1 (default) enables the optimizations (--opt-level=N)
+ *
+ * thresholds: back-edges after which a loop is promoted to tier 1 and tier 2 (--tier1-threshold=N, --tier2-threshold=N),
+ * iterations of a compiled loop before its path is recorded as a trace (--trace-threshold=N)
+ *
+ * stats: prints the execution counters of the tiers on the standard error at the end (--stats)
+ *
+ * profileFile: if not empty the profile of the loops is loaded from this file and saved there at the end (--profile=FILE)
+ *
+ * threads: workers of a batch, 0 (default) uses one per core; given, it runs even a single file as a batch (--threads=N)
+ *
+ * quantum: back-edges a script of a batch executes before giving its worker to another one (--quantum=N)
+ *
+ * checkpointSeconds: if not zero the state of the program is saved every that many seconds (--checkpoint-every=SECONDS),
+ * to the resume file if there is one, otherwise to the source file followed by .checkpoint
+ *
+ * resumeFile: if not empty the program continues from this checkpoint instead of starting (--resume=FILE)
+ *
+ * programCache: if not empty the parsed programs are looked up in and added to the shared memory cache
+ * with this name (--program-cache=NAME)
+ */
+struct Options {
+    std::vector<std::string> sourceFiles;
+    std::string outputFile;
+    long long preallocate = 0;
+    bool asyncOutput = false;
+    OutputFormat outputFormat = OutputFormat::TEXT;
+    int optimizationLevel = 1;
+    TierThresholds thresholds;
+    bool stats = false;
+    std::string profileFile;
+    size_t threads = 0;
+    bool batch = false;
+    size_t quantum = 10000;
+    size_t checkpointSeconds = 0;
+    std::string resumeFile;
+    std::string programCache;
+};
+
+/**
+ * Prints how to call the program
+ */
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [--output=FILE|hash] [--preallocate=BYTES] [--async-output]"
+              << " [--output-format=text|ndjson|binary]"
+              << " [--opt-level=0|1] [--tier1-threshold=N] [--tier2-threshold=N]"
+              << " [--trace-threshold=N] [--stats]"
+              << " [--profile=FILE] [--checkpoint-every=SECONDS] [--resume=FILE] [--program-cache=NAME]"
+              << " <source_file>" << std::endl;
+    std::cerr << "       " << program << " [--threads=N] [--quantum=N] [--output-format=text|ndjson|binary]"
+              << " [--opt-level=0|1] [--tier1-threshold=N] [--tier2-threshold=N] [--trace-threshold=N] [--stats]"
+              << " [--program-cache=NAME] <source_file>..." << std::endl;
+}
+
+/**
+ * Reads a non negative number of the form --name=N, returns false if it is not valid
+ */
+bool parseCount(const std::string& text, size_t& count) {
+    if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos) return false;
+    try {
+        count = std::stoull(text);
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Reads the options of the form --name=value and the source files
+ *
+ * Returns false if the command line is not valid; a batch does not accept the options
+ * that write the output somewhere else or that use a profile or a checkpoint
+ */
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg.rfind("--output=", 0) == 0) {
+            options.outputFile = arg.substr(9);
+            if (options.outputFile.empty()) return false;
+        } else if (arg.rfind("--preallocate=", 0) == 0) {
+            try {
+                options.preallocate = std::stoll(arg.substr(14));
+            } catch (const std::exception&) {
+                return false;
+            }
+        } else if (arg.rfind("--output-format=", 0) == 0) {
+            if (!parseOutputFormat(arg.substr(16), options.outputFormat)) return false;
+        } else if (arg.rfind("--opt-level=", 0) == 0) {
+            std::string level = arg.substr(12);
+            if (level != "0" && level != "1") return false;
+            options.optimizationLevel = std::stoi(level);
+        } else if (arg.rfind("--tier1-threshold=", 0) == 0) {
+            if (!parseCount(arg.substr(18), options.thresholds.tier1)) return false;
+        } else if (arg.rfind("--tier2-threshold=", 0) == 0) {
+            if (!parseCount(arg.substr(18), options.thresholds.tier2)) return false;
+        } else if (arg.rfind("--trace-threshold=", 0) == 0) {
+            if (!parseCount(arg.substr(18), options.thresholds.trace)) return false;
+        } else if (arg.rfind("--profile=", 0) == 0) {
+            options.profileFile = arg.substr(10);
+            if (options.profileFile.empty()) return false;
+        } else if (arg.rfind("--threads=", 0) == 0) {
+            if (!parseCount(arg.substr(10), options.threads)) return false;
+            options.batch = true;
+        } else if (arg.rfind("--quantum=", 0) == 0) {
+            if (!parseCount(arg.substr(10), options.quantum)) return false;
+        } else if (arg.rfind("--checkpoint-every=", 0) == 0) {
+            if (!parseCount(arg.substr(19), options.checkpointSeconds) || options.checkpointSeconds == 0) return false;
+        } else if (arg.rfind("--resume=", 0) == 0) {
+            options.resumeFile = arg.substr(9);
+            if (options.resumeFile.empty()) return false;
+        } else if (arg.rfind("--program-cache=", 0) == 0) {
+            options.programCache = arg.substr(16);
+            if (options.programCache.empty()) return false;
+        } else if (arg == "--stats") {
+            options.stats = true;
+        } else if (arg == "--async-output") {
+            options.asyncOutput = true;
+        } else if (arg.rfind("--", 0) == 0) {
+            return false;
+        } else {
+            options.sourceFiles.push_back(arg);
+        }
+    }
+
+    if (options.sourceFiles.size() > 1) {
+        options.batch = true;
+    }
+    if (options.batch && (!options.outputFile.empty() || options.asyncOutput || !options.profileFile.empty() ||
+                          options.checkpointSeconds != 0 || !options.resumeFile.empty())) {
+        return false;
+    }
+    return !options.sourceFiles.empty();
+}
+
+/**
+ * Writes out the pending output before an error message is printed
+ *
+ * A failure here is ignored because the error being reported is more important
+ */
+void drainOutput(OutputSink* output) {
+    try {
+        output->flush();
+    } catch (const std::exception&) {
+    }
+}
+
+/**
+ * Prints the digest and the size of the output that went into the hash (--output=hash)
+ */
+void printDigest(const HashSink& hash) {
+    char digest[17];
+    std::snprintf(digest, sizeof(digest), "%016llx", static_cast<unsigned long long>(hash.digest()));
+    std::cout << "output hash: " << digest << ", " << hash.bytes() << " bytes" << std::endl;
+}
+
+/**
+ * Prints how many loop iterations each tier executed and how often loops changed tier while running
+ */
+void printStats(const TierStats& stats) {
+    std::cerr << "tier 0 (interpreter): " << stats.iterations[TIER0] << " iterations" << std::endl;
+    std::cerr << "tier 1 (closures): " << stats.iterations[TIER1] << " iterations, "
+              << stats.compiledLoops << " loops compiled" << std::endl;
+    std::cerr << "tier 2 (kernels): " << stats.iterations[TIER2] << " iterations" << std::endl;
+    std::cerr << "on-stack replacements: " << stats.replacements
+              << ", deoptimizations: " << stats.deoptimizations << std::endl;
+    std::cerr << "bounds checks hoisted: " << stats.hoistedChecks << " loop entries" << std::endl;
+    std::cerr << "traces: " << stats.traces << " recorded (" << stats.sideTraces << " side traces), "
+              << stats.sideExits << " side exits" << std::endl;
+}
+
+/**
+ * Prints how many programs were found in the shared cache and how many had to be parsed
+ */
+void printCacheStats(const ProgramCache& cache) {
+    std::cerr << "program cache: " << cache.hitCount() << " hits, " << cache.missCount() << " misses" << std::endl;
+}
+
+/**
+ * Lexes and parses the source, or decodes its program from the cache when another process
+ * (or an earlier script of the batch) has already parsed the same source
+ *
+ * Returns nullptr with the message in error if the source has a lexical error;
+ * a program parsed here is added to the cache
+ */
+std::unique_ptr<Program> parseSource(const std::string& sourceCode, ProgramCache* cache, std::string& error) {
+    uint64_t sourceHash = cache ? hashText(sourceCode) : 0;
+    if (cache) {
+        if (auto program = cache->find(sourceHash, sourceCode.size())) {
+            return program;
+        }
+    }
+
+    Lexer lexer(sourceCode);
+    std::vector<Token> tokens = lexer.tokenize();
+
+    for (const auto& token : tokens) {
+        if (token.type == TokenType::ERROR) {
+            error = "Error: " + token.value;
+            return nullptr;
+        }
+    }
+
+    Parser parser(std::move(tokens));
+    auto program = parser.parseProgram();
+
+    if (cache) {
+        cache->insert(sourceHash, sourceCode.size(), encodeProgram(*program));
+    }
+    return program;
+}
+
+/**
+ * Adds the counters of a script of a batch to the total
+ */
+void addStats(TierStats& total, const TierStats& stats) {
+    for (size_t tier = 0; tier < TIER_COUNT; tier++) {
+        total.iterations[tier] += stats.iterations[tier];
+    }
+    total.compiledLoops += stats.compiledLoops;
+    total.replacements += stats.replacements;
+    total.deoptimizations += stats.deoptimizations;
+    total.hoistedChecks += stats.hoistedChecks;
+    total.traces += stats.traces;
+    total.sideTraces += stats.sideTraces;
+    total.sideExits += stats.sideExits;
+}
+
+/**
+ * A script of a batch: its file, its output and the error message it ended with (empty if none)
+ */
+struct BatchScript {
+    std::string file;
+    BufferSink output;
+    std::string error;
+    TierStats stats;
+};
+
+/**
+ * Runs a script of a batch on its green thread, with the same phases and error messages as a single program
+ *
+ * Its loops yield every quantum back-edges, so a long script does not keep the others waiting
+ */
+void runBatchScript(BatchScript& script, const Options& options, ProgramCache* cache) {
+    try {
+        std::string sourceCode = readFile(script.file);
+
+        auto program = parseSource(sourceCode, cache, script.error);
+        if (!program) {
+            return;
+        }
+
+        Interpreter interpreter;
+        interpreter.setOutput(script.output);
+        interpreter.setOutputFormat(options.outputFormat);
+        interpreter.setOptimizationLevel(options.optimizationLevel);
+        interpreter.setTierThresholds(options.thresholds);
+        interpreter.setPreemption(options.quantum, &Scheduler::yield);
+
+        interpreter.execute(*program);
+
+        script.stats = interpreter.getStats();
+    } catch (const ParseError& e) {
+        script.error = e.what();
+    } catch (const RuntimeError& e) {
+        script.error = e.what();
+    } catch (const std::exception& e) {
+        script.error = std::string("Error: ") + e.what();
+    }
+}
+
+/**
+ * Runs the source files as green threads on the workers of a Scheduler, then writes the output
+ * and the error of each one in the order of the files
+ *
+ * A script whose green thread cannot start (no memory for its stack) fails with its own error,
+ * the others still run
+ *
+ * Returns 1 if any script failed
+ */
+int runBatch(const Options& options) {
+    std::vector<BatchScript> scripts(options.sourceFiles.size());
+
+    size_t workers = options.threads;
+    if (workers == 0) {
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    Scheduler scheduler(workers);
+
+    std::unique_ptr<ProgramCache> cache;
+    if (!options.programCache.empty()) {
+        try {
+            cache = std::make_unique<ProgramCache>(options.programCache);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    for (size_t i = 0; i < scripts.size(); i++) {
+        BatchScript& script = scripts[i];
+        script.file = options.sourceFiles[i];
+        scheduler.spawn([&script, &options, &cache]() {
+            runBatchScript(script, options, cache.get());
+        });
+    }
+
+    scheduler.run();
+
+    int status = 0;
+    TierStats total;
+    for (size_t i = 0; i < scripts.size(); i++) {
+        BatchScript& script = scripts[i];
+        if (auto error = scheduler.error(i)) {
+            try {
+                std::rethrow_exception(error);
+            } catch (const std::exception& e) {
+                script.error = std::string("Error: ") + e.what();
+            }
+        }
+        const std::string& text = script.output.contents();
+        std::cout.write(text.data(), text.size());
+        std::cout.flush();
+        if (!script.error.empty()) {
+            std::cerr << script.error << std::endl;
+            status = 1;
+        }
+        addStats(total, script.stats);
+    }
+
+    if (options.stats) {
+        printStats(total);
+        Scheduler::Stats schedulerStats = scheduler.getStats();
+        std::cerr << "green threads: " << schedulerStats.tasks << " scripts on " << workers << " workers, "
+                  << schedulerStats.switches << " switches, " << schedulerStats.steals << " steals" << std::endl;
+        if (cache) {
+            printCacheStats(*cache);
+        }
+    }
+    return status;
+}
+
+/**
+ * Expects the path to the source file to execute, optionally preceded by options
+ * (several paths run as a batch, see runBatch)
  * 
  * Performs lexical analysis, parsing an interpretation
  * 
  * Reports errors
  */
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <source_file>" << std::endl;
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
         return 1;
     }
+
+    if (options.batch) {
+        return runBatch(options);
+    }
+    
+    StdoutSink stdoutOutput;
+    std::unique_ptr<FileSink> fileOutput;
+    std::unique_ptr<HashSink> hashOutput;
+    std::unique_ptr<AsyncSink> asyncOutput;
+    std::unique_ptr<ProgramCache> cache;
+    OutputSink* output = &stdoutOutput;
     
     try {
-        std::string sourceCode = readFile(argv[1]);
+        std::string sourceCode = readFile(options.sourceFiles[0]);
 
-        Lexer lexer(sourceCode);
-        std::vector<Token> tokens = lexer.tokenize();
+        if (!options.programCache.empty()) {
+            cache = std::make_unique<ProgramCache>(options.programCache);
+        }
 
-        for (const auto& token : tokens) {
-            if (token.type == TokenType::ERROR) {
-                std::cerr << "Error: " << token.value << std::endl;
-                return 1; 
-            }
+        std::string lexicalError;
+        auto program = parseSource(sourceCode, cache.get(), lexicalError);
+        if (!program) {
+            std::cerr << lexicalError << std::endl;
+            return 1;
         }
 
-        Parser parser(tokens);
-        auto program = parser.parseProgram();
+        uint64_t sourceHash = hashText(sourceCode);
+
+        if (options.outputFile == "hash") {
+            hashOutput = std::make_unique<HashSink>();
+            output = hashOutput.get();
+        } else if (!options.outputFile.empty()) {
+            long long keep = options.resumeFile.empty()
+                ? 0 : static_cast<long long>(checkpointOutputBytes(options.resumeFile, sourceHash));
+            fileOutput = std::make_unique<FileSink>(options.outputFile, options.preallocate, keep);
+            output = fileOutput.get();
+        }
+        if (options.asyncOutput) {
+            asyncOutput = std::make_unique<AsyncSink>(*output);
+            output = asyncOutput.get();
+        }
  
         Interpreter interpreter;
+        interpreter.setOutput(*output);
+        interpreter.setOutputFormat(options.outputFormat);
+        interpreter.setOptimizationLevel(options.optimizationLevel);
+        interpreter.setTierThresholds(options.thresholds);
+
+        ProgramProfile profile;
+        if (!options.profileFile.empty() && loadProfile(options.profileFile, profile)) {
+            interpreter.importProfile(*program, profile, sourceHash);
+        }
+
+        if (options.checkpointSeconds != 0) {
+            std::string checkpointFile = options.resumeFile.empty() ? options.sourceFiles[0] + ".checkpoint"
+                                                                    : options.resumeFile;
+            interpreter.setCheckpoints(checkpointFile, options.checkpointSeconds, sourceHash);
+        }
+        if (!options.resumeFile.empty()) {
+            interpreter.setResume(options.resumeFile, sourceHash);
+        }
+
         interpreter.execute(*program);
+
+        if (asyncOutput) {
+            asyncOutput->close();
+        }
+        if (fileOutput) {
+            fileOutput->close();
+        }
+        if (hashOutput) {
+            printDigest(*hashOutput);
+        }
+
+        if (options.stats) {
+            printStats(interpreter.getStats());
+            if (cache) {
+                printCacheStats(*cache);
+            }
+        }
+
+        if (!options.profileFile.empty()) {
+            profile = interpreter.exportProfile(*program);
+            profile.source = sourceHash;
+            saveProfile(options.profileFile, profile);
+        }
         
     } catch (const ParseError& e) {
+        drainOutput(output);
         std::cerr << e.what() << std::endl;
         return 1;
     } catch (const RuntimeError& e) {
+        drainOutput(output);
+        if (hashOutput) printDigest(*hashOutput);
         std::cerr << e.what() << std::endl;
         return 1;
     } catch (const std::exception& e) {
+        drainOutput(output);
+        if (hashOutput) printDigest(*hashOutput);
         std::cerr << "Error: " << e.what() << std::endl;
         return 1;
     }
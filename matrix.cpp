@@ -0,0 +1,60 @@
+/**
+ * Implementation of the matrices
+ *
+ * Include for ArenaAllocator used for the buffer of the cells
+ *
+ * Include for std::memset and std::memcpy used to fill and copy the cells
+ *
+ * Include for std::move used by the copy assignment
+ */
+#include "matrix.h"
+#include "arena.h"
+#include <cstring>
+#include <utility>
+
+/**
+ * Creates a matrix with every cell set to 0, the dimensions have already been checked by the Interpreter
+ */
+Matrix::Matrix(int rows, int columns) : rowCount(rows), columnCount(columns) {
+    if (cellCount() == 0) return;
+    cells = ArenaAllocator<int>().allocate(cellCount());
+    std::memset(cells, 0, cellCount() * sizeof(int));
+}
+
+Matrix::Matrix(const Matrix& other) : rowCount(other.rowCount), columnCount(other.columnCount) {
+    if (cellCount() == 0) return;
+    cells = ArenaAllocator<int>().allocate(cellCount());
+    std::memcpy(cells, other.cells, cellCount() * sizeof(int));
+}
+
+Matrix::Matrix(Matrix&& other) noexcept
+    : cells(other.cells), rowCount(other.rowCount), columnCount(other.columnCount) {
+    other.cells = nullptr;
+    other.rowCount = 0;
+    other.columnCount = 0;
+}
+
+Matrix& Matrix::operator=(const Matrix& other) {
+    if (this != &other) {
+        Matrix copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+Matrix& Matrix::operator=(Matrix&& other) noexcept {
+    if (this != &other) {
+        if (cells) ArenaAllocator<int>().deallocate(cells, cellCount());
+        cells = other.cells;
+        rowCount = other.rowCount;
+        columnCount = other.columnCount;
+        other.cells = nullptr;
+        other.rowCount = 0;
+        other.columnCount = 0;
+    }
+    return *this;
+}
+
+Matrix::~Matrix() {
+    if (cells) ArenaAllocator<int>().deallocate(cells, cellCount());
+}
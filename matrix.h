@@ -0,0 +1,69 @@
+/**
+ * Guard Headers
+ */
+#ifndef MATRIX_H
+#define MATRIX_H
+
+/**
+ * Include for size_t used for sizes
+ */
+#include <cstddef>
+
+/**
+ * Two-dimensional grid of integers (m = matrix(rows, cols), m[i][j], m[i][j] = v, len(m))
+ *
+ * The cells are one contiguous buffer in row-major order holding plain ints instead of Values,
+ * so a row is a run of consecutive ints and a dynamic programming table or a grid is walked
+ * without following a pointer per row and without the tag of every element
+ *
+ * contains() is the only bounds check of an access: row and column are compared as unsigned,
+ * so a negative index becomes a large number and fails the same comparison as one past the end,
+ * and the two comparisons are joined without a branch between them
+ *
+ * Like the lists, the buffer comes from the arena of the execution (or the heap) and a Matrix is
+ * copied by value; it is as small as a pointer and two ints so it does not make Value larger
+ */
+class Matrix {
+private:
+    int* cells = nullptr;
+    int rowCount = 0;
+    int columnCount = 0;
+
+    size_t cellCount() const {
+        return static_cast<size_t>(rowCount) * static_cast<size_t>(columnCount);
+    }
+
+public:
+    Matrix() = default;
+    Matrix(int rows, int columns);
+    Matrix(const Matrix& other);
+    Matrix(Matrix&& other) noexcept;
+    Matrix& operator=(const Matrix& other);
+    Matrix& operator=(Matrix&& other) noexcept;
+    ~Matrix();
+
+    int rows() const { return rowCount; }
+    int columns() const { return columnCount; }
+
+    bool contains(int row, int column) const {
+        return (static_cast<unsigned>(row) < static_cast<unsigned>(rowCount)) &
+               (static_cast<unsigned>(column) < static_cast<unsigned>(columnCount));
+    }
+
+    /**
+     * Cell at row and column, which must have passed contains()
+     */
+    int& at(int row, int column) {
+        return cells[static_cast<size_t>(row) * static_cast<size_t>(columnCount) + static_cast<size_t>(column)];
+    }
+
+    int at(int row, int column) const {
+        return cells[static_cast<size_t>(row) * static_cast<size_t>(columnCount) + static_cast<size_t>(column)];
+    }
+
+    const int* row(int index) const {
+        return cells + static_cast<size_t>(index) * static_cast<size_t>(columnCount);
+    }
+};
+
+#endif // MATRIX_H
@@ -0,0 +1,676 @@
+/**
+ * Implementation of the Optimizer and of the vectorized loops
+ *
+ * Include for the SIMD column operations
+ *
+ * Include for std::min, std::max, std::find and std::remove_if
+ *
+ * Include for std::numeric_limits used to detect int overflows
+ */
+#include "optimizer.h"
+#include "simd.h"
+#include <algorithm>
+#include <limits>
+
+// ================= PATTERN MATCHING =================
+
+/**
+ * Returns the name if the expression is an identifier, otherwise nullptr
+ */
+static const std::string* identifierName(const Expression& expr) {
+    auto id = dynamic_cast<const Identifier*>(&expr);
+    return id ? &id->name : nullptr;
+}
+
+/**
+ * Checks that the statement is "name = name + 1" (or "name = 1 + name")
+ */
+static bool isIncrement(const Statement& stmt, const std::string& name) {
+    auto assignment = dynamic_cast<const Assignment*>(&stmt);
+    if (!assignment || assignment->variableName != name) return false;
+
+    auto add = dynamic_cast<const BinaryOperation*>(assignment->value.get());
+    if (!add || add->op != BinaryOperation::Operator::ADD) return false;
+
+    auto one = dynamic_cast<const NumberLiteral*>(add->right.get());
+    const std::string* id = identifierName(*add->left);
+    if (!one) {
+        one = dynamic_cast<const NumberLiteral*>(add->left.get());
+        id = identifierName(*add->right);
+    }
+    return one && one->value == 1 && id && *id == name;
+}
+
+/**
+ * Translates the element-wise expression into postfix instructions
+ *
+ * Returns false if the expression uses something that is not allowed in a kernel
+ */
+bool LoopKernel::compile(const Expression& expr) {
+    if (auto number = dynamic_cast<const NumberLiteral*>(&expr)) {
+        KernelOp op(KernelOp::Kind::CONSTANT);
+        op.constant = number->value;
+        ops.push_back(op);
+        return true;
+    }
+
+    if (auto id = dynamic_cast<const Identifier*>(&expr)) {
+        if (id->name == target) return false;
+        KernelOp op(id->name == counter ? KernelOp::Kind::COUNTER : KernelOp::Kind::VARIABLE);
+        op.name = id->name;
+        ops.push_back(op);
+        return true;
+    }
+
+    if (auto access = dynamic_cast<const ListAccess*>(&expr)) {
+        const std::string* index = identifierName(*access->index);
+        if (!index || *index != counter || access->listName == counter) return false;
+        if (kind == Kind::REDUCE && access->listName == target) return false;
+
+        KernelOp op(KernelOp::Kind::ELEMENT);
+        op.name = access->listName;
+        op.list = std::find(lists.begin(), lists.end(), access->listName) - lists.begin();
+        if (op.list == lists.size()) lists.push_back(access->listName);
+        ops.push_back(op);
+        return true;
+    }
+
+    if (auto unary = dynamic_cast<const UnaryOperation*>(&expr)) {
+        if (unary->op != UnaryOperation::Operator::MINUS || !compile(*unary->operand)) return false;
+        ops.push_back(KernelOp(KernelOp::Kind::NEGATE));
+        return true;
+    }
+
+    if (auto binary = dynamic_cast<const BinaryOperation*>(&expr)) {
+        KernelOp op;
+        switch (binary->op) {
+            case BinaryOperation::Operator::ADD: op.kind = KernelOp::Kind::ADD; break;
+            case BinaryOperation::Operator::SUBTRACT: op.kind = KernelOp::Kind::SUBTRACT; break;
+            case BinaryOperation::Operator::MULTIPLY: op.kind = KernelOp::Kind::MULTIPLY; break;
+            default: return false;
+        }
+        if (!compile(*binary->left) || !compile(*binary->right)) return false;
+        ops.push_back(op);
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Translates the right operands of a chain "s + a - b + ..." into the instructions computing "a - b + ..."
+ *
+ * empty stays true while only the accumulator has been found
+ */
+bool LoopKernel::compileSum(const Expression& expr, bool& empty) {
+    const std::string* id = identifierName(expr);
+    if (id && *id == target) {
+        empty = true;
+        return true;
+    }
+
+    auto binary = dynamic_cast<const BinaryOperation*>(&expr);
+    if (!binary || (binary->op != BinaryOperation::Operator::ADD && binary->op != BinaryOperation::Operator::SUBTRACT)) {
+        return false;
+    }
+    if (!compileSum(*binary->left, empty) || !compile(*binary->right)) return false;
+
+    if (empty) {
+        if (binary->op == BinaryOperation::Operator::SUBTRACT) ops.push_back(KernelOp(KernelOp::Kind::NEGATE));
+        empty = false;
+    } else {
+        ops.push_back(KernelOp(binary->op == BinaryOperation::Operator::ADD ? KernelOp::Kind::ADD : KernelOp::Kind::SUBTRACT));
+    }
+    return true;
+}
+
+/**
+ * Recognizes the MAP and REDUCE shapes described in optimizer.h
+ */
+std::unique_ptr<LoopKernel> LoopKernel::match(const WhileStatement& loop) {
+    auto condition = dynamic_cast<const BinaryOperation*>(loop.condition.get());
+    if (!condition || condition->op != BinaryOperation::Operator::LESS) return nullptr;
+
+    const std::string* counterName = identifierName(*condition->left);
+    if (!counterName) return nullptr;
+
+    auto kernel = std::make_unique<LoopKernel>();
+    kernel->counter = *counterName;
+
+    if (auto boundName = identifierName(*condition->right)) {
+        if (*boundName == kernel->counter) return nullptr;
+        kernel->bound = *boundName;
+    } else if (auto boundNumber = dynamic_cast<const NumberLiteral*>(condition->right.get())) {
+        kernel->boundConstant = boundNumber->value;
+    } else {
+        return nullptr;
+    }
+
+    const auto& body = loop.body->statements;
+    if (body.size() != 2 || !isIncrement(*body[1], kernel->counter)) return nullptr;
+
+    const Expression* element = nullptr;
+
+    if (auto store = dynamic_cast<const ListAssignment*>(body[0].get())) {
+        const std::string* index = identifierName(*store->index);
+        if (!index || *index != kernel->counter || store->listName == kernel->counter) return nullptr;
+        kernel->kind = Kind::MAP;
+        kernel->target = store->listName;
+        element = store->value.get();
+    } else if (auto sum = dynamic_cast<const Assignment*>(body[0].get())) {
+        if (sum->variableName == kernel->counter || sum->variableName == kernel->bound) return nullptr;
+        kernel->kind = Kind::REDUCE;
+        kernel->target = sum->variableName;
+
+        auto add = dynamic_cast<const BinaryOperation*>(sum->value.get());
+        const std::string* right = add ? identifierName(*add->right) : nullptr;
+        if (add && add->op == BinaryOperation::Operator::ADD && right && *right == kernel->target) {
+            element = add->left.get();
+        } else {
+            bool empty = true;
+            if (!kernel->compileSum(*sum->value, empty) || empty) return nullptr;
+            return kernel;
+        }
+    } else {
+        return nullptr;
+    }
+
+    if (!kernel->compile(*element)) return nullptr;
+    return kernel;
+}
+
+// ================= EXECUTION =================
+
+/**
+ * Executes the iterations of the loop in blocks:
+ * - gathers v[i] of every list read into packed int64 columns, stopping at the first element that is not an integer
+ * - evaluates the postfix instructions one column at a time with the SIMD operations,
+ *   stopping at the first element whose partial result does not fit in an int
+ * - stores the results (MAP) or adds them to the accumulator (REDUCE)
+ *
+ * Returns the number of iterations executed
+ */
+size_t LoopKernel::run(std::unordered_map<std::string, Value>& variables) const {
+    auto lookup = [&variables](const std::string& name, Value::Type type) -> Value* {
+        auto it = variables.find(name);
+        if (it == variables.end() || it->second.type != type) return nullptr;
+        return &it->second;
+    };
+
+    Value* counterValue = lookup(counter, Value::INTEGER);
+    if (!counterValue) return 0;
+
+    long long first = counterValue->getInt();
+    long long end = boundConstant;
+    if (!bound.empty()) {
+        Value* boundValue = lookup(bound, Value::INTEGER);
+        if (!boundValue) return 0;
+        end = boundValue->getInt();
+    }
+    if (first < 0 || first >= end) return 0;
+
+    Value* targetValue = lookup(target, kind == Kind::MAP ? Value::LIST : Value::INTEGER);
+    if (!targetValue) return 0;
+    if (kind == Kind::MAP) {
+        end = std::min<long long>(end, targetValue->getList().size());
+    }
+
+    std::vector<List*> sources;
+    for (const auto& name : lists) {
+        Value* list = lookup(name, Value::LIST);
+        if (!list) return 0;
+        sources.push_back(&list->getList());
+        end = std::min<long long>(end, sources.back()->size());
+    }
+
+    std::vector<int64_t> invariants(ops.size());
+    for (size_t k = 0; k < ops.size(); k++) {
+        if (ops[k].kind == KernelOp::Kind::VARIABLE) {
+            Value* variable = lookup(ops[k].name, Value::INTEGER);
+            if (!variable) return 0;
+            invariants[k] = variable->getInt();
+        }
+    }
+
+    std::vector<std::vector<int64_t>> gathered(sources.size(), std::vector<int64_t>(BLOCK));
+    std::vector<std::vector<int64_t>> columns(ops.size(), std::vector<int64_t>(BLOCK));
+    std::vector<const int64_t*> results(ops.size());
+    std::vector<size_t> stack;
+
+    long long accumulator = kind == Kind::REDUCE ? targetValue->getInt() : 0;
+    long long position = first;
+
+    while (position < end) {
+        size_t length = static_cast<size_t>(std::min<long long>(BLOCK, end - position));
+        size_t full = length;
+
+        for (size_t s = 0; s < sources.size(); s++) {
+            const auto& list = *sources[s];
+            for (size_t j = 0; j < length; j++) {
+                const Value& element = list[position + j];
+                if (element.type != Value::INTEGER) {
+                    length = j;
+                    break;
+                }
+                gathered[s][j] = std::get<int>(element.data);
+            }
+        }
+
+        stack.clear();
+        for (size_t k = 0; k < ops.size() && length > 0; k++) {
+            int64_t* out = columns[k].data();
+            switch (ops[k].kind) {
+                case KernelOp::Kind::CONSTANT:
+                    std::fill(out, out + length, ops[k].constant);
+                    results[k] = out;
+                    break;
+                case KernelOp::Kind::VARIABLE:
+                    std::fill(out, out + length, invariants[k]);
+                    results[k] = out;
+                    break;
+                case KernelOp::Kind::COUNTER:
+                    for (size_t j = 0; j < length; j++) out[j] = position + j;
+                    results[k] = out;
+                    break;
+                case KernelOp::Kind::ELEMENT:
+                    results[k] = gathered[ops[k].list].data();
+                    break;
+                case KernelOp::Kind::NEGATE: {
+                    size_t a = stack.back(); stack.pop_back();
+                    simd::negate(results[a], out, length);
+                    results[k] = out;
+                    length = simd::firstOutOfIntRange(out, length);
+                    break;
+                }
+                default: {
+                    size_t b = stack.back(); stack.pop_back();
+                    size_t a = stack.back(); stack.pop_back();
+                    if (ops[k].kind == KernelOp::Kind::ADD) simd::add(results[a], results[b], out, length);
+                    else if (ops[k].kind == KernelOp::Kind::SUBTRACT) simd::subtract(results[a], results[b], out, length);
+                    else simd::multiply(results[a], results[b], out, length);
+                    results[k] = out;
+                    length = simd::firstOutOfIntRange(out, length);
+                    break;
+                }
+            }
+            stack.push_back(k);
+        }
+
+        const int64_t* result = results[ops.size() - 1];
+
+        if (kind == Kind::MAP) {
+            auto& list = targetValue->getList();
+            for (size_t j = 0; j < length; j++) {
+                list[position + j] = Value(static_cast<int>(result[j]));
+            }
+        } else {
+            for (size_t j = 0; j < length; j++) {
+                long long next = accumulator + result[j];
+                if (next < std::numeric_limits<int>::min() || next > std::numeric_limits<int>::max()) {
+                    length = j;
+                    break;
+                }
+                accumulator = next;
+            }
+        }
+
+        position += length;
+        if (length < full) break;
+    }
+
+    if (kind == Kind::REDUCE) {
+        *targetValue = Value(static_cast<int>(accumulator));
+    }
+    *counterValue = Value(static_cast<int>(position));
+
+    return static_cast<size_t>(position - first);
+}
+
+/**
+ * Describes the kernel, useful for debugging
+ */
+std::string LoopKernel::toString() const {
+    std::string result = kind == Kind::MAP ? "map " : "reduce ";
+    result += target + " over " + counter + " <";
+    result += bound.empty() ? std::to_string(boundConstant) : bound;
+    return result + " (" + std::to_string(ops.size()) + " ops, " + simd::instructionSet() + ")";
+}
+
+// ================= COUNTED LOOPS =================
+
+/**
+ * Finds k if the index is counter, counter + k, k + counter or counter - k
+ */
+static bool counterOffset(const Expression& index, const std::string& counter, int& offset) {
+    const std::string* id = identifierName(index);
+    if (id) {
+        offset = 0;
+        return *id == counter;
+    }
+
+    auto binary = dynamic_cast<const BinaryOperation*>(&index);
+    if (!binary) return false;
+
+    if (binary->op == BinaryOperation::Operator::ADD) {
+        auto number = dynamic_cast<const NumberLiteral*>(binary->right.get());
+        id = identifierName(*binary->left);
+        if (!number) {
+            number = dynamic_cast<const NumberLiteral*>(binary->left.get());
+            id = identifierName(*binary->right);
+        }
+        if (!number || !id || *id != counter) return false;
+        offset = number->value;
+        return true;
+    }
+
+    if (binary->op == BinaryOperation::Operator::SUBTRACT) {
+        auto number = dynamic_cast<const NumberLiteral*>(binary->right.get());
+        id = identifierName(*binary->left);
+        if (!number || !id || *id != counter || number->value == std::numeric_limits<int>::min()) return false;
+        offset = -number->value;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Widens the range of the list to include the offset of an access
+ */
+static void addAccess(CountedLoop& loop, const std::string& list, const Expression& index) {
+    int offset;
+    if (!counterOffset(index, loop.counter, offset)) return;
+
+    for (auto& range : loop.ranges) {
+        if (range.list == list) {
+            range.lowest = std::min(range.lowest, offset);
+            range.highest = std::max(range.highest, offset);
+            return;
+        }
+    }
+    loop.ranges.push_back({list, offset, offset});
+}
+
+static void scanExpression(const Expression& expr, CountedLoop& loop) {
+    if (auto access = dynamic_cast<const ListAccess*>(&expr)) {
+        addAccess(loop, access->listName, *access->index);
+        scanExpression(*access->index, loop);
+    } else if (auto access = dynamic_cast<const MatrixAccess*>(&expr)) {
+        scanExpression(*access->row, loop);
+        scanExpression(*access->column, loop);
+    } else if (auto length = dynamic_cast<const Length*>(&expr)) {
+        scanExpression(*length->operand, loop);
+    } else if (auto unary = dynamic_cast<const UnaryOperation*>(&expr)) {
+        scanExpression(*unary->operand, loop);
+    } else if (auto binary = dynamic_cast<const BinaryOperation*>(&expr)) {
+        scanExpression(*binary->left, loop);
+        scanExpression(*binary->right, loop);
+    }
+}
+
+/**
+ * Collects the list accesses of a statement and the variables it writes, resizing a list counts as a write
+ *
+ * Returns false if the statement contains a loop: only innermost loops are versioned,
+ * so the body is compiled at most twice
+ */
+static bool scanStatement(const Statement& stmt, CountedLoop& loop, std::vector<std::string>& written) {
+    if (auto assignment = dynamic_cast<const Assignment*>(&stmt)) {
+        written.push_back(assignment->variableName);
+        scanExpression(*assignment->value, loop);
+    } else if (auto store = dynamic_cast<const ListAssignment*>(&stmt)) {
+        addAccess(loop, store->listName, *store->index);
+        scanExpression(*store->index, loop);
+        scanExpression(*store->value, loop);
+    } else if (auto store = dynamic_cast<const MatrixAssignment*>(&stmt)) {
+        scanExpression(*store->row, loop);
+        scanExpression(*store->column, loop);
+        scanExpression(*store->value, loop);
+    } else if (auto multiple = dynamic_cast<const MultipleAssignment*>(&stmt)) {
+        for (const auto& target : multiple->targets) {
+            if (!target.index) written.push_back(target.name);
+        }
+    } else if (auto creation = dynamic_cast<const ListCreation*>(&stmt)) {
+        written.push_back(creation->variableName);
+    } else if (auto creation = dynamic_cast<const DictCreation*>(&stmt)) {
+        written.push_back(creation->variableName);
+    } else if (auto creation = dynamic_cast<const MatrixCreation*>(&stmt)) {
+        written.push_back(creation->variableName);
+    } else if (auto load = dynamic_cast<const ListLoad*>(&stmt)) {
+        written.push_back(load->variableName);
+    } else if (auto append = dynamic_cast<const ListAppend*>(&stmt)) {
+        written.push_back(append->listName);
+        scanExpression(*append->value, loop);
+    } else if (auto append = dynamic_cast<const ListBulkAppend*>(&stmt)) {
+        written.push_back(append->listName);
+    } else if (auto print = dynamic_cast<const PrintStatement*>(&stmt)) {
+        scanExpression(*print->expression, loop);
+    } else if (auto block = dynamic_cast<const Block*>(&stmt)) {
+        for (const auto& inner : block->statements) {
+            if (!scanStatement(*inner, loop, written)) return false;
+        }
+    } else if (auto ifStmt = dynamic_cast<const IfStatement*>(&stmt)) {
+        scanExpression(*ifStmt->condition, loop);
+        if (!scanStatement(*ifStmt->thenBlock, loop, written)) return false;
+        for (const auto& elif : ifStmt->elifClauses) {
+            scanExpression(*elif.condition, loop);
+            if (!scanStatement(*elif.body, loop, written)) return false;
+        }
+        if (ifStmt->elseBlock && !scanStatement(*ifStmt->elseBlock, loop, written)) return false;
+    } else if (dynamic_cast<const WhileStatement*>(&stmt)) {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Recognizes the counted loop described in optimizer.h, with at least one access to check on entry
+ */
+std::unique_ptr<CountedLoop> CountedLoop::match(const WhileStatement& loop) {
+    auto condition = dynamic_cast<const BinaryOperation*>(loop.condition.get());
+    if (!condition || (condition->op != BinaryOperation::Operator::LESS &&
+                       condition->op != BinaryOperation::Operator::LESS_EQUAL)) {
+        return nullptr;
+    }
+
+    const std::string* counterName = identifierName(*condition->left);
+    if (!counterName) return nullptr;
+
+    auto counted = std::make_unique<CountedLoop>();
+    counted->counter = *counterName;
+    counted->inclusive = condition->op == BinaryOperation::Operator::LESS_EQUAL;
+
+    if (auto boundName = identifierName(*condition->right)) {
+        counted->bound = *boundName;
+    } else if (auto boundNumber = dynamic_cast<const NumberLiteral*>(condition->right.get())) {
+        counted->boundConstant = boundNumber->value;
+    } else if (auto length = dynamic_cast<const Length*>(condition->right.get())) {
+        const std::string* list = identifierName(*length->operand);
+        if (!list) return nullptr;
+        counted->boundLength = *list;
+    } else {
+        return nullptr;
+    }
+
+    const auto& body = loop.body->statements;
+    if (body.empty() || !isIncrement(*body.back(), counted->counter)) return nullptr;
+
+    std::vector<std::string> written;
+    for (size_t i = 0; i + 1 < body.size(); i++) {
+        if (!scanStatement(*body[i], *counted, written)) return nullptr;
+    }
+
+    auto isWritten = [&written](const std::string& name) {
+        return std::find(written.begin(), written.end(), name) != written.end();
+    };
+    if (isWritten(counted->counter) || counted->bound == counted->counter || counted->boundLength == counted->counter ||
+        (!counted->bound.empty() && isWritten(counted->bound)) ||
+        (!counted->boundLength.empty() && isWritten(counted->boundLength))) {
+        return nullptr;
+    }
+
+    auto& ranges = counted->ranges;
+    ranges.erase(std::remove_if(ranges.begin(), ranges.end(), [&](const Range& range) {
+        return range.list == counted->counter || isWritten(range.list);
+    }), ranges.end());
+    if (ranges.empty()) return nullptr;
+
+    return counted;
+}
+
+/**
+ * True if the access list[index] was checked on entry, with k of the index in offset
+ */
+bool CountedLoop::covers(const std::string& list, const Expression& index, int& offset) const {
+    for (const auto& range : ranges) {
+        if (range.list == list) return counterOffset(index, counter, offset);
+    }
+    return false;
+}
+
+// ================= ANALYSIS =================
+
+/**
+ * Collects the names of the variables written by a statement and by the statements it contains
+ */
+void Optimizer::collectAssignments(const Statement& stmt, std::vector<std::string>& names) {
+    if (auto assignment = dynamic_cast<const Assignment*>(&stmt)) {
+        names.push_back(assignment->variableName);
+    } else if (auto multiple = dynamic_cast<const MultipleAssignment*>(&stmt)) {
+        for (const auto& target : multiple->targets) {
+            if (!target.index) names.push_back(target.name);
+        }
+    } else if (auto creation = dynamic_cast<const ListCreation*>(&stmt)) {
+        names.push_back(creation->variableName);
+    } else if (auto creation = dynamic_cast<const DictCreation*>(&stmt)) {
+        names.push_back(creation->variableName);
+    } else if (auto creation = dynamic_cast<const MatrixCreation*>(&stmt)) {
+        names.push_back(creation->variableName);
+    } else if (auto load = dynamic_cast<const ListLoad*>(&stmt)) {
+        names.push_back(load->variableName);
+    } else if (auto block = dynamic_cast<const Block*>(&stmt)) {
+        for (const auto& inner : block->statements) {
+            collectAssignments(*inner, names);
+        }
+    } else if (auto ifStmt = dynamic_cast<const IfStatement*>(&stmt)) {
+        collectAssignments(*ifStmt->thenBlock, names);
+        for (const auto& elif : ifStmt->elifClauses) {
+            collectAssignments(*elif.body, names);
+        }
+        if (ifStmt->elseBlock) {
+            collectAssignments(*ifStmt->elseBlock, names);
+        }
+    } else if (auto loop = dynamic_cast<const WhileStatement*>(&stmt)) {
+        collectAssignments(*loop->body, names);
+    }
+}
+
+/**
+ * Visits an expression looking for divisions by an invariant divisor
+ *
+ * Outside loops a division is executed at most once, so only divisions inside loops are marked
+ */
+void Optimizer::analyzeExpression(Expression& expr) {
+    if (auto binary = dynamic_cast<BinaryOperation*>(&expr)) {
+        analyzeExpression(*binary->left);
+        analyzeExpression(*binary->right);
+
+        if (binary->op != BinaryOperation::Operator::DIVIDE || loopAssignments.empty()) return;
+
+        const Expression* divisor = binary->right.get();
+        if (auto unary = dynamic_cast<const UnaryOperation*>(divisor)) {
+            if (unary->op == UnaryOperation::Operator::MINUS) divisor = unary->operand.get();
+        }
+
+        if (dynamic_cast<const NumberLiteral*>(divisor)) {
+            binary->invariantDivisor = true;
+        } else if (auto id = dynamic_cast<const Identifier*>(divisor)) {
+            const auto& assigned = loopAssignments.back();
+            binary->invariantDivisor = std::find(assigned.begin(), assigned.end(), id->name) == assigned.end();
+        }
+    } else if (auto unary = dynamic_cast<UnaryOperation*>(&expr)) {
+        analyzeExpression(*unary->operand);
+    } else if (auto access = dynamic_cast<ListAccess*>(&expr)) {
+        analyzeExpression(*access->index);
+    } else if (auto access = dynamic_cast<MatrixAccess*>(&expr)) {
+        analyzeExpression(*access->row);
+        analyzeExpression(*access->column);
+    } else if (auto length = dynamic_cast<Length*>(&expr)) {
+        analyzeExpression(*length->operand);
+    }
+}
+
+/**
+ * Visits the statements recursively looking for loops that match a kernel, for divisions and for list creations
+ */
+void Optimizer::analyzeStatement(Statement& stmt) {
+    if (auto block = dynamic_cast<Block*>(&stmt)) {
+        for (auto& inner : block->statements) {
+            analyzeStatement(*inner);
+        }
+    } else if (auto ifStmt = dynamic_cast<IfStatement*>(&stmt)) {
+        analyzeExpression(*ifStmt->condition);
+        analyzeStatement(*ifStmt->thenBlock);
+        for (auto& elif : ifStmt->elifClauses) {
+            analyzeExpression(*elif.condition);
+            analyzeStatement(*elif.body);
+        }
+        if (ifStmt->elseBlock) {
+            analyzeStatement(*ifStmt->elseBlock);
+        }
+    } else if (auto loop = dynamic_cast<WhileStatement*>(&stmt)) {
+        if (auto kernel = LoopKernel::match(*loop)) {
+            kernels[loop] = std::move(kernel);
+        }
+        if (auto counted = CountedLoop::match(*loop)) {
+            countedLoops[loop] = std::move(counted);
+        }
+        loopAssignments.emplace_back();
+        collectAssignments(*loop->body, loopAssignments.back());
+        analyzeExpression(*loop->condition);
+        analyzeStatement(*loop->body);
+        loopAssignments.pop_back();
+    } else if (auto assignment = dynamic_cast<Assignment*>(&stmt)) {
+        analyzeExpression(*assignment->value);
+    } else if (auto store = dynamic_cast<ListAssignment*>(&stmt)) {
+        analyzeExpression(*store->index);
+        analyzeExpression(*store->value);
+    } else if (auto store = dynamic_cast<MatrixAssignment*>(&stmt)) {
+        analyzeExpression(*store->row);
+        analyzeExpression(*store->column);
+        analyzeExpression(*store->value);
+    } else if (auto multiple = dynamic_cast<MultipleAssignment*>(&stmt)) {
+        for (auto& target : multiple->targets) {
+            if (target.index) analyzeExpression(*target.index);
+            if (target.column) analyzeExpression(*target.column);
+        }
+        for (auto& value : multiple->values) {
+            analyzeExpression(*value);
+        }
+    } else if (auto append = dynamic_cast<ListAppend*>(&stmt)) {
+        analyzeExpression(*append->value);
+    } else if (auto creation = dynamic_cast<ListCreation*>(&stmt)) {
+        creation->recycleBuffer = !loopAssignments.empty();
+    } else if (auto print = dynamic_cast<PrintStatement*>(&stmt)) {
+        analyzeExpression(*print->expression);
+    }
+}
+
+void Optimizer::analyze(Program& program) {
+    kernels.clear();
+    countedLoops.clear();
+    loopAssignments.clear();
+    for (auto& stmt : program.statements) {
+        analyzeStatement(*stmt);
+    }
+}
+
+const LoopKernel* Optimizer::kernelFor(const WhileStatement& loop) const {
+    auto it = kernels.find(&loop);
+    return it == kernels.end() ? nullptr : it->second.get();
+}
+
+const CountedLoop* Optimizer::countedLoopFor(const WhileStatement& loop) const {
+    auto it = countedLoops.find(&loop);
+    return it == countedLoops.end() ? nullptr : it->second.get();
+}
@@ -0,0 +1,168 @@
+/**
+ * Guard Headers
+ */
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+/**
+ * Include for AST definitions
+ *
+ * Include for Value stored in the variables
+ *
+ * Include for std::unordered_map used for the variables and the analysis results
+ *
+ * Include for std::unique_ptr used to own the kernels and the counted loops
+ *
+ * Include for std::string and std::vector used to describe the kernels
+ */
+#include "ast.h"
+#include "value.h"
+#include <unordered_map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * One instruction of the expression of a vectorized loop, in postfix order
+ *
+ * CONSTANT: a number literal
+ *
+ * VARIABLE: an integer variable that the loop does not modify
+ *
+ * COUNTER: the loop counter i
+ *
+ * ELEMENT: the element v[i] of a list, list is the position of v in LoopKernel::lists
+ */
+struct KernelOp {
+    enum class Kind {
+        CONSTANT,
+        VARIABLE,
+        COUNTER,
+        ELEMENT,
+        ADD,
+        SUBTRACT,
+        MULTIPLY,
+        NEGATE
+    };
+
+    Kind kind;
+    int constant = 0;
+    std::string name;
+    size_t list = 0;
+
+    KernelOp(Kind k = Kind::CONSTANT) : kind(k) {}
+};
+
+/**
+ * Element-wise loop over integer lists executed as native SIMD code
+ *
+ * Recognized shapes, where f only uses + - * on v[i], i, literals and variables that the loop does not modify:
+ *
+ * MAP:    while i < n:            REDUCE: while i < n:
+ *             w[i] = f(...)                   s = s + f(...)
+ *             i = i + 1                       i = i + 1
+ *
+ * Every list is read only at index i, so there is no dependency between iterations
+ *
+ * REDUCE also accepts chains like s = s + v[i] - w[i]: since the int arithmetic wraps, the terms
+ * can be summed first whenever the result does not overflow
+ *
+ * run() executes only the iterations that the tree walker would complete without errors and without
+ * int overflow, and leaves the variables exactly as the tree walker would; it stops at the first
+ * iteration it cannot prove safe and the interpreter continues from there, reporting the same errors
+ */
+class LoopKernel {
+public:
+    enum class Kind {
+        MAP,
+        REDUCE
+    };
+
+    static std::unique_ptr<LoopKernel> match(const WhileStatement& loop);
+
+    size_t run(std::unordered_map<std::string, Value>& variables) const;
+
+    std::string toString() const;
+
+private:
+    static const size_t BLOCK = 256;
+
+    Kind kind;
+    std::string counter;
+    std::string bound;
+    int boundConstant = 0;
+    std::string target;
+    std::vector<KernelOp> ops;
+    std::vector<std::string> lists;
+
+    bool compile(const Expression& expr);
+    bool compileSum(const Expression& expr, bool& empty);
+};
+
+/**
+ * Counted loop whose list accesses can be checked once when the loop is entered (loop versioning)
+ *
+ * Recognized shape: an innermost loop
+ *
+ *     while i < n:          (or i <= n, n is a literal, a variable or len(v) that the loop does not change)
+ *         ...
+ *         i = i + 1         (the only statement that writes i, the last one of the body)
+ *
+ * While the body runs, i goes from its value at the entry of the loop to n - 1 (n for <=), so an access
+ * v[i + k] (also v[i], v[i - k], v[k + i]) to a list that the body never resizes or reassigns stays inside
+ * the list for every iteration if it does for the first and the last one
+ *
+ * ranges holds, for each such list, the smallest and the largest k used by the body;
+ * the compiled loop (CompiledLoop) checks them on entry and then runs a version of the body without
+ * the bounds and list type checks of those accesses, otherwise the original checked version
+ */
+struct CountedLoop {
+    struct Range {
+        std::string list;
+        int lowest;
+        int highest;
+    };
+
+    std::string counter;
+    bool inclusive = false;
+    std::string bound;
+    std::string boundLength;
+    int boundConstant = 0;
+    std::vector<Range> ranges;
+
+    static std::unique_ptr<CountedLoop> match(const WhileStatement& loop);
+
+    bool covers(const std::string& list, const Expression& index, int& offset) const;
+};
+
+/**
+ * Static analysis of the program done before the execution
+ *
+ * Finds the loops that can be executed by a LoopKernel and the counted loops whose bounds checks can be hoisted
+ *
+ * Marks the divisions whose divisor is a literal or a variable not assigned in the innermost
+ * enclosing loop, so that they are executed with a FastDivisor
+ *
+ * Marks the list creations inside a loop, so that they reuse the buffer of the list of the previous iteration
+ */
+class Optimizer {
+private:
+    std::unordered_map<const WhileStatement*, std::unique_ptr<LoopKernel>> kernels;
+    std::unordered_map<const WhileStatement*, std::unique_ptr<CountedLoop>> countedLoops;
+
+    std::vector<std::vector<std::string>> loopAssignments;
+
+    void analyzeStatement(Statement& stmt);
+    void analyzeExpression(Expression& expr);
+
+    static void collectAssignments(const Statement& stmt, std::vector<std::string>& names);
+
+public:
+    void analyze(Program& program);
+
+    const LoopKernel* kernelFor(const WhileStatement& loop) const;
+
+    const CountedLoop* countedLoopFor(const WhileStatement& loop) const;
+};
+
+#endif // OPTIMIZER_H
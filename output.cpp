@@ -0,0 +1,394 @@
+/**
+ * Implementation of the output sinks
+ *
+ * Include for std::cout used by the default sink
+ *
+ * Include for std::runtime_error used to report I/O failures
+ *
+ * Include for std::memcpy used to fill the block buffer
+ *
+ * Include for std::align_val_t used to allocate the aligned block
+ *
+ * Include for errno used to retry interrupted writes
+ *
+ * Include for the POSIX file primitives (open, lseek, pwrite, fallocate, ftruncate)
+ */
+#include "output.h"
+#include <iostream>
+#include <stdexcept>
+#include <cstring>
+#include <new>
+#include <cerrno>
+#include <fcntl.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// ================= STDOUT =================
+
+/**
+ * Write the bytes on std::cout and flush them as soon as possible
+ */
+void StdoutSink::write(const char* data, size_t size) {
+    std::cout.write(data, size);
+    std::cout.flush();
+}
+
+void StdoutSink::flush() {
+    std::cout.flush();
+}
+
+// ================= FILE =================
+
+/**
+ * Open (or truncate) the output file and allocate the block buffer
+ *
+ * The preallocation is only a hint, if the filesystem does not support it the file simply grows as it is written
+ */
+FileSink::FileSink(const std::string& filename, long long preallocate, long long keep)
+    : path(filename), fd(-1), buffer(nullptr), used(0), offset(keep) {
+#ifdef _WIN32
+    fd = _open(filename.c_str(), _O_WRONLY | _O_CREAT | (keep > 0 ? 0 : _O_TRUNC) | _O_BINARY, 0644);
+#else
+    fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | (keep > 0 ? 0 : O_TRUNC), 0644);
+#endif
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open output file " + filename);
+    }
+
+    if (keep > 0) {
+#ifdef _WIN32
+        bool kept = _lseeki64(fd, 0, SEEK_END) >= keep && _chsize_s(fd, keep) == 0;
+#else
+        bool kept = ::lseek(fd, 0, SEEK_END) >= keep && ::ftruncate(fd, keep) == 0;
+#endif
+        if (!kept) {
+#ifdef _WIN32
+            _close(fd);
+#else
+            ::close(fd);
+#endif
+            fd = -1;
+            throw std::runtime_error("Output file " + filename + " does not hold the output before the checkpoint");
+        }
+    }
+
+#if defined(__linux__)
+    if (preallocate > 0) {
+        fallocate(fd, 0, 0, preallocate);
+    }
+#else
+    (void)preallocate;
+#endif
+
+    buffer = static_cast<char*>(::operator new(BLOCK_SIZE, std::align_val_t(BLOCK_ALIGNMENT)));
+}
+
+/**
+ * Flush the remaining bytes, no exception can leave the destructor
+ */
+FileSink::~FileSink() {
+    try {
+        close();
+    } catch (...) {
+    }
+    ::operator delete(buffer, std::align_val_t(BLOCK_ALIGNMENT));
+}
+
+/**
+ * Write a chunk of data at the current file offset
+ *
+ * pwrite may write less than requested, so it is repeated until everything has been written
+ */
+void FileSink::writeBlock(const char* data, size_t size) {
+    while (size > 0) {
+#ifdef _WIN32
+        _lseeki64(fd, offset, SEEK_SET);
+        long long written = _write(fd, data, static_cast<unsigned int>(size));
+#else
+        long long written = ::pwrite(fd, data, size, offset);
+#endif
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("Cannot write output file " + path);
+        }
+        data += written;
+        size -= written;
+        offset += written;
+    }
+}
+
+/**
+ * Append bytes to the block buffer and write out every block that gets full
+ *
+ * Chunks larger than a block skip the buffer when it is empty
+ */
+void FileSink::write(const char* data, size_t size) {
+    if (fd < 0) {
+        throw std::runtime_error("Output file " + path + " is closed");
+    }
+
+    while (size > 0) {
+        if (used == 0 && size >= BLOCK_SIZE) {
+            size_t whole = size - size % BLOCK_SIZE;
+            writeBlock(data, whole);
+            data += whole;
+            size -= whole;
+            continue;
+        }
+
+        size_t chunk = BLOCK_SIZE - used;
+        if (chunk > size) chunk = size;
+        std::memcpy(buffer + used, data, chunk);
+        used += chunk;
+        data += chunk;
+        size -= chunk;
+
+        if (used == BLOCK_SIZE) {
+            writeBlock(buffer, used);
+            used = 0;
+        }
+    }
+}
+
+/**
+ * Write the partially filled block
+ */
+void FileSink::flush() {
+    if (fd < 0 || used == 0) return;
+    writeBlock(buffer, used);
+    used = 0;
+}
+
+/**
+ * Flush, drop the preallocated space past the written data and close the file
+ */
+void FileSink::close() {
+    if (fd < 0) return;
+    flush();
+#ifdef _WIN32
+    _chsize_s(fd, offset);
+    _close(fd);
+#else
+    if (ftruncate(fd, offset) != 0) {
+        ::close(fd);
+        fd = -1;
+        throw std::runtime_error("Cannot write output file " + path);
+    }
+    ::close(fd);
+#endif
+    fd = -1;
+}
+
+// ================= HASH =================
+
+/**
+ * Multipliers of the hash (odd 64-bit constants with well mixed bits)
+ */
+static const uint64_t HASH_SEED = 0x9e3779b97f4a7c15ULL;
+static const uint64_t HASH_MULTIPLIER = 0xbf58476d1ce4e5b9ULL;
+
+HashSink::HashSink() : state(HASH_SEED), pending(0), pendingSize(0), total(0) {}
+
+/**
+ * Mixes one little-endian word into the state, each word depends on all the previous ones
+ */
+void HashSink::absorb(uint64_t word) {
+    state ^= word;
+    state *= HASH_MULTIPLIER;
+    state ^= state >> 31;
+}
+
+/**
+ * Bytes that do not fill a word wait in pending until the next write completes it
+ */
+void HashSink::write(const char* data, size_t size) {
+    total += size;
+
+    while (size > 0 && pendingSize != 0) {
+        pending |= static_cast<uint64_t>(static_cast<unsigned char>(*data)) << (8 * pendingSize);
+        data++;
+        size--;
+        if (++pendingSize == 8) {
+            absorb(pending);
+            pending = 0;
+            pendingSize = 0;
+        }
+    }
+
+    while (size >= 8) {
+        uint64_t word = 0;
+        for (int i = 0; i < 8; i++) {
+            word |= static_cast<uint64_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+        }
+        absorb(word);
+        data += 8;
+        size -= 8;
+    }
+
+    for (size_t i = 0; i < size; i++) {
+        pending |= static_cast<uint64_t>(static_cast<unsigned char>(data[i])) << (8 * pendingSize);
+        pendingSize++;
+    }
+}
+
+void HashSink::flush() {}
+
+/**
+ * Final mix of the state with the incomplete word and the length, without changing the running state
+ */
+uint64_t HashSink::digest() const {
+    uint64_t hash = state ^ pending;
+    hash *= HASH_MULTIPLIER;
+    hash ^= total;
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+// ================= BUFFER =================
+
+void BufferSink::write(const char* data, size_t size) {
+    buffer.append(data, size);
+}
+
+void BufferSink::flush() {}
+
+// ================= ASYNC =================
+
+/**
+ * Allocate the ring and start the writer thread
+ */
+AsyncSink::AsyncSink(OutputSink& sink)
+    : target(sink), ring(new char[RING_SIZE]), head(0), tail(0), events(0), stopping(false), failed(false) {
+    writer = std::thread(&AsyncSink::drain, this);
+}
+
+/**
+ * Stop the writer after it has written everything
+ */
+AsyncSink::~AsyncSink() {
+    try {
+        close();
+    } catch (...) {
+    }
+    delete[] ring;
+}
+
+/**
+ * Wake up the writer thread
+ */
+void AsyncSink::signal() {
+    events.fetch_add(1, std::memory_order_release);
+    events.notify_one();
+}
+
+/**
+ * Report on the interpreter thread an error raised by the writer thread
+ */
+void AsyncSink::checkError() {
+    if (failed.load(std::memory_order_acquire)) {
+        std::exception_ptr e = error;
+        error = nullptr;
+        if (e) std::rethrow_exception(e);
+    }
+}
+
+/**
+ * Producer side: copy the bytes in the ring, waiting for free space when it is full
+ */
+void AsyncSink::write(const char* data, size_t size) {
+    checkError();
+
+    size_t h = head.load(std::memory_order_relaxed);
+    while (size > 0) {
+        size_t t = tail.load(std::memory_order_acquire);
+        size_t space = RING_SIZE - (h - t);
+        if (space == 0) {
+            tail.wait(t, std::memory_order_acquire);
+            checkError();
+            continue;
+        }
+
+        size_t chunk = size < space ? size : space;
+        size_t start = h & (RING_SIZE - 1);
+        size_t first = RING_SIZE - start;
+        if (first > chunk) first = chunk;
+        std::memcpy(ring + start, data, first);
+        std::memcpy(ring, data + first, chunk - first);
+
+        h += chunk;
+        data += chunk;
+        size -= chunk;
+        head.store(h, std::memory_order_release);
+        signal();
+    }
+}
+
+/**
+ * Wait until the writer has consumed the whole ring, then flush the wrapped sink
+ */
+void AsyncSink::flush() {
+    size_t h = head.load(std::memory_order_relaxed);
+    while (true) {
+        size_t t = tail.load(std::memory_order_acquire);
+        if (t == h) break;
+        tail.wait(t, std::memory_order_acquire);
+    }
+    checkError();
+    target.flush();
+}
+
+/**
+ * Drain the ring and join the writer thread
+ */
+void AsyncSink::close() {
+    if (!writer.joinable()) return;
+    flush();
+    stopping.store(true, std::memory_order_release);
+    signal();
+    writer.join();
+}
+
+/**
+ * Consumer side, runs on the writer thread
+ *
+ * Writes the readable part of the ring (at most up to its end) and then releases it,
+ * after an error the bytes are discarded so the interpreter never blocks
+ */
+void AsyncSink::drain() {
+    size_t t = tail.load(std::memory_order_relaxed);
+    while (true) {
+        unsigned seen = events.load(std::memory_order_acquire);
+        size_t h = head.load(std::memory_order_acquire);
+
+        if (h == t) {
+            if (stopping.load(std::memory_order_acquire)) break;
+            events.wait(seen, std::memory_order_acquire);
+            continue;
+        }
+
+        size_t start = t & (RING_SIZE - 1);
+        size_t chunk = h - t;
+        if (chunk > RING_SIZE - start) chunk = RING_SIZE - start;
+
+        if (!failed.load(std::memory_order_relaxed)) {
+            try {
+                target.write(ring + start, chunk);
+            } catch (...) {
+                error = std::current_exception();
+                failed.store(true, std::memory_order_release);
+            }
+        }
+
+        t += chunk;
+        tail.store(t, std::memory_order_release);
+        tail.notify_one();
+    }
+}
@@ -0,0 +1,178 @@
+/**
+ * Guard Headers
+ */
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+/**
+ * Include for std::string used for file names
+ *
+ * Include for size_t used for buffer sizes
+ *
+ * Include for uint64_t used by the hash of the output
+ *
+ * Include for std::atomic, std::thread and std::exception_ptr used by the asynchronous sink
+ */
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <exception>
+
+/**
+ * Destination for the bytes produced by print statements
+ *
+ * The Interpreter only knows this interface, so the output can go to the terminal or to a file
+ */
+class OutputSink {
+public:
+    virtual ~OutputSink() = default;
+    virtual void write(const char* data, size_t size) = 0;
+    virtual void flush() = 0;
+};
+
+/**
+ * Default sink: writes on std::cout and flushes after each print like std::endl did
+ */
+class StdoutSink : public OutputSink {
+public:
+    void write(const char* data, size_t size) override;
+    void flush() override;
+};
+
+/**
+ * Sink used by --output=FILE
+ *
+ * Collects the output in a large page aligned buffer and writes it with pwrite one full block at a time,
+ * bypassing iostream formatting and the flush after every line
+ *
+ * If preallocate is not zero the file space is reserved up front with fallocate, the file is then
+ * truncated to the real size when closed
+ *
+ * If keep is not zero the file is not emptied: it is cut to its first keep bytes and the output continues
+ * after them (used by --resume to drop only what was printed after the checkpoint)
+ */
+class FileSink : public OutputSink {
+private:
+    static const size_t BLOCK_SIZE = 1 << 20;
+    static const size_t BLOCK_ALIGNMENT = 4096;
+
+    std::string path;
+    int fd;
+    char* buffer;
+    size_t used;
+    long long offset;
+
+    void writeBlock(const char* data, size_t size);
+
+public:
+    FileSink(const std::string& filename, long long preallocate = 0, long long keep = 0);
+
+    ~FileSink();
+
+    FileSink(const FileSink&) = delete;
+    FileSink& operator=(const FileSink&) = delete;
+
+    void write(const char* data, size_t size) override;
+    void flush() override;
+
+    void close();
+};
+
+/**
+ * Sink used by --async-output
+ *
+ * print only copies the bytes in a lock-free single-producer/single-consumer ring buffer,
+ * a dedicated writer thread drains it into the wrapped sink
+ *
+ * When the ring is full the interpreter waits for the writer (back-pressure)
+ *
+ * flush() returns only when every byte has reached the wrapped sink, so it must be called
+ * before printing an error message to keep the order of the output
+ */
+class AsyncSink : public OutputSink {
+private:
+    static const size_t RING_SIZE = 1 << 22;
+
+    OutputSink& target;
+    char* ring;
+
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+    std::atomic<unsigned> events;
+    std::atomic<bool> stopping;
+
+    std::exception_ptr error;
+    std::atomic<bool> failed;
+
+    std::thread writer;
+
+    void drain();
+    void signal();
+    void checkError();
+
+public:
+    AsyncSink(OutputSink& sink);
+
+    ~AsyncSink();
+
+    AsyncSink(const AsyncSink&) = delete;
+    AsyncSink& operator=(const AsyncSink&) = delete;
+
+    void write(const char* data, size_t size) override;
+    void flush() override;
+
+    void close();
+};
+
+/**
+ * Sink used by --output=hash
+ *
+ * The bytes are not written anywhere, they go into a streaming 64-bit hash that consumes eight bytes at a time:
+ * a benchmark measures only the execution (no system calls) and the digest still tells if the output is correct
+ *
+ * The digest depends only on the sequence of bytes, not on how it is split between the calls to write
+ */
+class HashSink : public OutputSink {
+private:
+    uint64_t state;
+    uint64_t pending;
+    size_t pendingSize;
+    uint64_t total;
+
+    void absorb(uint64_t word);
+
+public:
+    HashSink();
+
+    void write(const char* data, size_t size) override;
+    void flush() override;
+
+    uint64_t digest() const;
+
+    uint64_t bytes() const {
+        return total;
+    }
+};
+
+/**
+ * Sink of a script of a batch (several source files)
+ *
+ * The scripts run at the same time, so each one keeps its output in memory and the output
+ * of all of them is written in the order of the files when the batch ends
+ */
+class BufferSink : public OutputSink {
+private:
+    std::string buffer;
+
+public:
+    void write(const char* data, size_t size) override;
+    void flush() override;
+
+    const std::string& contents() const {
+        return buffer;
+    }
+};
+
+#endif // OUTPUT_H
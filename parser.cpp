@@ -17,6 +17,15 @@ Parser::Parser(const std::vector<Token>& tokenStream) : tokens(tokenStream), cur
     }
 }
 
+/**
+ * Takes ownership of the token stream to avoid copying it
+ */
+Parser::Parser(std::vector<Token>&& tokenStream) : tokens(std::move(tokenStream)), currentPos(0) {
+    if (tokens.empty() || tokens.back().type != TokenType::ENDMARKER) {
+        tokens.push_back(Token(TokenType::ENDMARKER, "EOF", 0, 0));
+    }
+}
+
 /**
  * Returns the current
  * 
@@ -142,12 +151,125 @@ void Parser::parseStmts(std::vector<std::unique_ptr<Statement>>& statements) {
         if (isAtEnd() || check(TokenType::ENDMARKER) || check(TokenType::DEDENT)) {
             break;
         }
+
+        if (extendBulkAppend(statements)) {
+            continue;
+        }
         
         auto stmt = parseStmt();
         if (stmt) {
-            statements.push_back(std::move(stmt));
+            addStatement(statements, std::move(stmt));
+        }
+    }
+}
+
+/**
+ * Returns true if the expression is a literal (42, -42, True, False) and extracts its type and value
+ */
+static bool literalValue(const Expression& expr, DataType& type, int& value) {
+    if (auto number = dynamic_cast<const NumberLiteral*>(&expr)) {
+        type = DataType::INTEGER;
+        value = number->value;
+        return true;
+    }
+    if (auto boolean = dynamic_cast<const BooleanLiteral*>(&expr)) {
+        type = DataType::BOOLEAN;
+        value = boolean->value ? 1 : 0;
+        return true;
+    }
+    if (auto unary = dynamic_cast<const UnaryOperation*>(&expr)) {
+        auto number = dynamic_cast<const NumberLiteral*>(unary->operand.get());
+        if (unary->op == UnaryOperation::Operator::MINUS && number) {
+            type = DataType::INTEGER;
+            value = -number->value;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Add a parsed statement to the block
+ * 
+ * Consecutive appends of literals of the same type to the same list are collapsed into a ListBulkAppend
+ */
+void Parser::addStatement(std::vector<std::unique_ptr<Statement>>& statements, std::unique_ptr<Statement> stmt) {
+    auto append = dynamic_cast<ListAppend*>(stmt.get());
+    DataType type;
+    int value;
+
+    if (!append || statements.empty() || !literalValue(*append->value, type, value)) {
+        statements.push_back(std::move(stmt));
+        return;
+    }
+
+    Statement* previous = statements.back().get();
+
+    if (auto bulk = dynamic_cast<ListBulkAppend*>(previous)) {
+        if (bulk->listName == append->listName && bulk->elementType == type) {
+            bulk->values.push_back(value);
+            return;
+        }
+    } else if (auto single = dynamic_cast<ListAppend*>(previous)) {
+        DataType previousType;
+        int previousValue;
+        if (single->listName == append->listName && literalValue(*single->value, previousType, previousValue) &&
+            previousType == type) {
+            auto merged = std::make_unique<ListBulkAppend>(append->listName, type);
+            merged->values.push_back(previousValue);
+            merged->values.push_back(value);
+            statements.back() = std::move(merged);
+            return;
         }
     }
+
+    statements.push_back(std::move(stmt));
+}
+
+/**
+ * Fast path for long runs of v.append(<literal>) lines
+ * 
+ * If the last statement is a ListBulkAppend and the next tokens are an append of a literal of the same type
+ * to the same list, the value is added directly without building the AST nodes of the statement
+ */
+bool Parser::extendBulkAppend(std::vector<std::unique_ptr<Statement>>& statements) {
+    if (statements.empty()) return false;
+
+    auto bulk = dynamic_cast<ListBulkAppend*>(statements.back().get());
+    if (!bulk) return false;
+
+    if (!check(TokenType::ID) || currentToken().value != bulk->listName ||
+        peekToken(1).type != TokenType::DOT || peekToken(2).type != TokenType::APPEND ||
+        peekToken(3).type != TokenType::LPAREN) {
+        return false;
+    }
+
+    int offset = 4;
+    bool negative = false;
+    if (peekToken(offset).type == TokenType::MINUS) {
+        negative = true;
+        offset++;
+    }
+
+    const Token& literal = peekToken(offset);
+    if (peekToken(offset + 1).type != TokenType::RPAREN || peekToken(offset + 2).type != TokenType::NEWLINE) {
+        return false;
+    }
+
+    int value;
+    if (literal.type == TokenType::NUM && bulk->elementType == DataType::INTEGER) {
+        value = std::stoi(literal.value);
+        if (negative) value = -value;
+    } else if ((literal.type == TokenType::TRUE || literal.type == TokenType::FALSE) &&
+               !negative && bulk->elementType == DataType::BOOLEAN) {
+        value = literal.type == TokenType::TRUE ? 1 : 0;
+    } else {
+        return false;
+    }
+
+    bulk->values.push_back(value);
+    currentPos += offset + 3;
+    return true;
 }
 
 /**
@@ -166,7 +288,7 @@ std::unique_ptr<Statement> Parser::parseStmt() {
 /**
  * Parse a single statement
  * 
- * Gandles assignment, list creation, list append, print, brake, continue
+ * Gandles assignment, list, dictionary and matrix creation, list append, list load/save, print, brake, continue
  */
 std::unique_ptr<Statement> Parser::parseSimpleStmt() {
     if (check(TokenType::BREAK)) {
@@ -175,6 +297,8 @@ std::unique_ptr<Statement> Parser::parseSimpleStmt() {
         return parseContinueStatement();
     } else if (check(TokenType::PRINT)) {
         return parsePrintStatement();
+    } else if (check(TokenType::SAVEINTS)) {
+        return parseListSave();
     } else if (check(TokenType::ID)) {
 
         if (currentPos + 1 < tokens.size()) {
@@ -187,11 +311,20 @@ std::unique_ptr<Statement> Parser::parseSimpleStmt() {
                     if (thirdToken == TokenType::LIST) {
                         return parseListCreation();
                     }
+                    if (thirdToken == TokenType::DICT) {
+                        return parseDictCreation();
+                    }
+                    if (thirdToken == TokenType::MATRIX) {
+                        return parseMatrixCreation();
+                    }
+                    if (thirdToken == TokenType::LOADINTS) {
+                        return parseListLoad();
+                    }
                 }
                 
                 return parseAssignment();
                 
-            } else if (secondToken == TokenType::LBRACKET) {
+            } else if (secondToken == TokenType::LBRACKET || secondToken == TokenType::COMMA) {
                 return parseAssignment();
             } else if (secondToken == TokenType::DOT) {
                 return parseListAppend();
@@ -203,17 +336,36 @@ std::unique_ptr<Statement> Parser::parseSimpleStmt() {
 }
 
 /**
- * Parse a regular or list assignment statement
+ * Parse a regular, list or matrix assignment statement
+ * 
+ * A comma after the first target starts a tuple assignment
  */
 std::unique_ptr<Statement> Parser::parseAssignment() {
     if (check(TokenType::ID)) {
         std::string varName = currentToken().value;
         advance();
         
+        if (check(TokenType::COMMA) ||
+            (check(TokenType::LBRACKET) && isTupleTarget())) {
+            return parseMultipleAssignment(varName);
+        }
+        
         if (check(TokenType::LBRACKET)) {
             advance();
             auto index = parseExpr();
             consume(TokenType::RBRACKET, "Expected ']'");
+            
+            if (match(TokenType::LBRACKET)) {
+                auto column = parseExpr();
+                consume(TokenType::RBRACKET, "Expected ']'");
+                consume(TokenType::ASSIGN, "Expected '='");
+                auto value = parseExpr();
+                consume(TokenType::NEWLINE, "Expected newline");
+                
+                return std::make_unique<MatrixAssignment>(varName, std::move(index), std::move(column),
+                                                          std::move(value));
+            }
+            
             consume(TokenType::ASSIGN, "Expected '='");
             auto value = parseExpr();
             consume(TokenType::NEWLINE, "Expected newline");
@@ -231,6 +383,73 @@ std::unique_ptr<Statement> Parser::parseAssignment() {
     throw ParseError("Expected identifier in assignment");
 }
 
+/**
+ * True if the element target starting at the current '[' is followed by a comma
+ * 
+ * The target of a matrix cell has a second index, which is skipped as well
+ */
+bool Parser::isTupleTarget() {
+    int depth = 0;
+    for (size_t i = currentPos; i < tokens.size(); i++) {
+        TokenType type = tokens[i].type;
+        if (type == TokenType::LBRACKET) {
+            depth++;
+        } else if (type == TokenType::RBRACKET) {
+            if (--depth == 0) {
+                if (i + 1 < tokens.size() && tokens[i + 1].type == TokenType::LBRACKET) continue;
+                return i + 1 < tokens.size() && tokens[i + 1].type == TokenType::COMMA;
+            }
+        } else if (type == TokenType::NEWLINE || type == TokenType::ENDMARKER) {
+            return false;
+        }
+    }
+    return false;
+}
+
+/**
+ * Parse a tuple assignment, the name of the first target has already been consumed
+ * 
+ * The number of values must match the number of targets
+ */
+std::unique_ptr<Statement> Parser::parseMultipleAssignment(const std::string& firstName) {
+    auto assignment = std::make_unique<MultipleAssignment>();
+    std::string name = firstName;
+    
+    while (true) {
+        std::unique_ptr<Expression> index;
+        std::unique_ptr<Expression> column;
+        if (match(TokenType::LBRACKET)) {
+            index = parseExpr();
+            consume(TokenType::RBRACKET, "Expected ']'");
+            if (match(TokenType::LBRACKET)) {
+                column = parseExpr();
+                consume(TokenType::RBRACKET, "Expected ']'");
+            }
+        }
+        assignment->targets.emplace_back(name, std::move(index), std::move(column));
+        
+        if (!match(TokenType::COMMA)) {
+            break;
+        }
+        name = consume(TokenType::ID, "Expected identifier after ','").value;
+    }
+    
+    consume(TokenType::ASSIGN, "Expected '='");
+    
+    do {
+        assignment->values.push_back(parseExpr());
+    } while (match(TokenType::COMMA));
+    
+    consume(TokenType::NEWLINE, "Expected newline");
+    
+    if (assignment->values.size() != assignment->targets.size()) {
+        throw ParseError("Expected " + std::to_string(assignment->targets.size()) +
+                         " values in assignment, got " + std::to_string(assignment->values.size()));
+    }
+    
+    return assignment;
+}
+
 /**
  * Parse list creation
  */
@@ -245,6 +464,37 @@ std::unique_ptr<Statement> Parser::parseListCreation() {
     return std::make_unique<ListCreation>(varName);
 }
 
+/**
+ * Parse dictionary creation
+ */
+std::unique_ptr<Statement> Parser::parseDictCreation() {
+    std::string varName = consume(TokenType::ID, "Expected identifier").value;
+    consume(TokenType::ASSIGN, "Expected '='");
+    consume(TokenType::DICT, "Expected 'dict'");
+    consume(TokenType::LPAREN, "Expected '('");
+    consume(TokenType::RPAREN, "Expected ')'");
+    consume(TokenType::NEWLINE, "Expected newline");
+    
+    return std::make_unique<DictCreation>(varName);
+}
+
+/**
+ * Parse matrix creation, the dimensions are expressions evaluated at run time
+ */
+std::unique_ptr<Statement> Parser::parseMatrixCreation() {
+    std::string varName = consume(TokenType::ID, "Expected identifier").value;
+    consume(TokenType::ASSIGN, "Expected '='");
+    consume(TokenType::MATRIX, "Expected 'matrix'");
+    consume(TokenType::LPAREN, "Expected '('");
+    auto rows = parseExpr();
+    consume(TokenType::COMMA, "Expected ','");
+    auto columns = parseExpr();
+    consume(TokenType::RPAREN, "Expected ')'");
+    consume(TokenType::NEWLINE, "Expected newline");
+    
+    return std::make_unique<MatrixCreation>(varName, std::move(rows), std::move(columns));
+}
+
 /**
  * Parse list append
  */
@@ -260,6 +510,36 @@ std::unique_ptr<Statement> Parser::parseListAppend() {
     return std::make_unique<ListAppend>(listName, std::move(value));
 }
 
+/**
+ * Parse list load
+ */
+std::unique_ptr<Statement> Parser::parseListLoad() {
+    std::string varName = consume(TokenType::ID, "Expected identifier").value;
+    consume(TokenType::ASSIGN, "Expected '='");
+    consume(TokenType::LOADINTS, "Expected 'load_ints'");
+    consume(TokenType::LPAREN, "Expected '('");
+    std::string path = consume(TokenType::STRING, "Expected file name").value;
+    consume(TokenType::RPAREN, "Expected ')'");
+    consume(TokenType::NEWLINE, "Expected newline");
+    
+    return std::make_unique<ListLoad>(varName, path);
+}
+
+/**
+ * Parse list save
+ */
+std::unique_ptr<Statement> Parser::parseListSave() {
+    consume(TokenType::SAVEINTS, "Expected 'save_ints'");
+    consume(TokenType::LPAREN, "Expected '('");
+    std::string listName = consume(TokenType::ID, "Expected identifier").value;
+    consume(TokenType::COMMA, "Expected ','");
+    std::string path = consume(TokenType::STRING, "Expected file name").value;
+    consume(TokenType::RPAREN, "Expected ')'");
+    consume(TokenType::NEWLINE, "Expected newline");
+    
+    return std::make_unique<ListSave>(listName, path);
+}
+
 /**
  * Parse print statement
  */
@@ -349,6 +629,8 @@ std::unique_ptr<Statement> Parser::parseWhileStatement() {
  * Parse a block: newline + IDENT + statement + DEDENT
  */
 std::unique_ptr<Block> Parser::parseBlock() {
+    Nesting nested(*this);
+    nested.deeper();
     consume(TokenType::NEWLINE, "Expected newline before block");
     consume(TokenType::INDENT, "Expected indentation");
     
@@ -360,10 +642,23 @@ std::unique_ptr<Block> Parser::parseBlock() {
     return block;
 }
 
+/**
+ * Adds a level of nesting, reports the program as an error beyond MAX_NESTING
+ */
+void Parser::Nesting::deeper() {
+    if (parser.nesting >= MAX_NESTING) {
+        throw ParseError("Too many nested blocks or expressions");
+    }
+    parser.nesting++;
+    levels++;
+}
+
 /**
  * Parse logical OR operations
  */
 std::unique_ptr<Expression> Parser::parseExpr() {
+    Nesting nested(*this);
+    nested.deeper();
     auto expr = parseJoin();
     
     while (match(TokenType::OR)) {
@@ -427,6 +722,14 @@ std::unique_ptr<Expression> Parser::parseRel() {
     } else if (match(TokenType::GREATER_EQUAL)) {
         auto right = parseNumExpr();
         return std::make_unique<BinaryOperation>(std::move(expr), BinaryOperation::Operator::GREATER_EQUAL, std::move(right));
+    } else if (match(TokenType::IN)) {
+        auto right = parseNumExpr();
+        return std::make_unique<BinaryOperation>(std::move(expr), BinaryOperation::Operator::IN, std::move(right));
+    } else if (check(TokenType::NOT) && peekToken().type == TokenType::IN) {
+        advance();
+        advance();
+        auto right = parseNumExpr();
+        return std::make_unique<BinaryOperation>(std::move(expr), BinaryOperation::Operator::NOT_IN, std::move(right));
     }
     
     return expr;
@@ -478,6 +781,11 @@ std::unique_ptr<Expression> Parser::parseTerm() {
  * Parse unary expressions
  */
 std::unique_ptr<Expression> Parser::parseUnary() {
+    Nesting nested(*this);
+    if (check(TokenType::NOT) || check(TokenType::MINUS)) {
+        nested.deeper();
+    }
+
     if (match(TokenType::NOT)) {
         auto operand = parseUnary();
         return std::make_unique<UnaryOperation>(UnaryOperation::Operator::NOT, std::move(operand));
@@ -515,6 +823,13 @@ std::unique_ptr<Expression> Parser::parseFactor() {
         return std::make_unique<BooleanLiteral>(false);
     }
     
+    if (match(TokenType::LEN)) {
+        consume(TokenType::LPAREN, "Expected '(' after 'len'");
+        auto operand = parseExpr();
+        consume(TokenType::RPAREN, "Expected ')'");
+        return std::make_unique<Length>(std::move(operand));
+    }
+    
     if (check(TokenType::ID)) {
         return parseLoc();
     }
@@ -523,7 +838,7 @@ std::unique_ptr<Expression> Parser::parseFactor() {
 }
 
 /**
- * Parse location expressions (variables and list access)
+ * Parse location expressions (variables, list access and matrix access)
  */
 std::unique_ptr<Expression> Parser::parseLoc() {
     std::string name = consume(TokenType::ID, "Expected identifier").value;
@@ -531,6 +846,11 @@ std::unique_ptr<Expression> Parser::parseLoc() {
     if (match(TokenType::LBRACKET)) {
         auto index = parseExpr();
         consume(TokenType::RBRACKET, "Expected ']'");
+        if (match(TokenType::LBRACKET)) {
+            auto column = parseExpr();
+            consume(TokenType::RBRACKET, "Expected ']'");
+            return std::make_unique<MatrixAccess>(name, std::move(index), std::move(column));
+        }
         return std::make_unique<ListAccess>(name, std::move(index));
     }
     
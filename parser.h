@@ -29,11 +29,34 @@ public:
 
 /**
  * Implements a parser following the BNF grammar specification
+ *
+ * The nesting of blocks and expressions (parentheses, unary operators) is limited to MAX_NESTING levels:
+ * the parser recurses once per level, so a deeper program would exhaust the stack instead of being reported
+ * as an error. A chain of binary operators (1 + 1 + ... + 1) is parsed by a loop and is not nesting,
+ * however long it is
  */
 class Parser {
 private:
+    static constexpr size_t MAX_NESTING = 1000;
+
+    /**
+     * Levels of nesting added by one parse function, removed when it returns
+     */
+    class Nesting {
+    private:
+        Parser& parser;
+        size_t levels = 0;
+
+    public:
+        explicit Nesting(Parser& owner) : parser(owner) {}
+        ~Nesting() { parser.nesting -= levels; }
+
+        void deeper();
+    };
+
     std::vector<Token> tokens;
     size_t currentPos;
+    size_t nesting = 0;
 
     const Token& currentToken();
     const Token& peekToken(int offset = 1);
@@ -45,6 +68,7 @@ private:
     
 public:
     Parser(const std::vector<Token>& tokenStream);
+    Parser(std::vector<Token>&& tokenStream);
 
     std::unique_ptr<Program> parseProgram();
     
@@ -53,12 +77,22 @@ private:
 
     void parseStmts(std::vector<std::unique_ptr<Statement>>& statements);
 
+    void addStatement(std::vector<std::unique_ptr<Statement>>& statements, std::unique_ptr<Statement> stmt);
+
+    bool extendBulkAppend(std::vector<std::unique_ptr<Statement>>& statements);
+
     std::unique_ptr<Statement> parseStmt();
 
     std::unique_ptr<Statement> parseSimpleStmt();
     std::unique_ptr<Statement> parseAssignment();
+    std::unique_ptr<Statement> parseMultipleAssignment(const std::string& firstName);
+    bool isTupleTarget();
     std::unique_ptr<Statement> parseListCreation();
+    std::unique_ptr<Statement> parseDictCreation();
+    std::unique_ptr<Statement> parseMatrixCreation();
     std::unique_ptr<Statement> parseListAppend();
+    std::unique_ptr<Statement> parseListLoad();
+    std::unique_ptr<Statement> parseListSave();
     std::unique_ptr<Statement> parsePrintStatement();
     std::unique_ptr<Statement> parseBreakStatement();
     std::unique_ptr<Statement> parseContinueStatement();
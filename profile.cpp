@@ -0,0 +1,148 @@
+/**
+ * Implementation of the saved profiles
+ *
+ * Include for std::ifstream and std::ofstream used to read and write the file
+ *
+ * Include for std::istringstream used to parse the lines
+ *
+ * Include for std::runtime_error used when the file cannot be written
+ */
+#include "profile.h"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+uint64_t hashText(const std::string& text) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/**
+ * Text of the statement including every nested block, the text of a block or loop alone does not contain its body
+ */
+static void describe(const Statement& stmt, std::string& text) {
+    if (auto block = dynamic_cast<const Block*>(&stmt)) {
+        text += "{";
+        for (const auto& inner : block->statements) {
+            describe(*inner, text);
+            text += ";";
+        }
+        text += "}";
+    } else if (auto ifStmt = dynamic_cast<const IfStatement*>(&stmt)) {
+        text += ifStmt->toString();
+        describe(*ifStmt->thenBlock, text);
+        for (const auto& elif : ifStmt->elifClauses) {
+            describe(*elif.body, text);
+        }
+        if (ifStmt->elseBlock) {
+            describe(*ifStmt->elseBlock, text);
+        }
+    } else if (auto loop = dynamic_cast<const WhileStatement*>(&stmt)) {
+        text += loop->toString();
+        describe(*loop->body, text);
+    } else {
+        text += stmt.toString();
+    }
+}
+
+static void findLoops(Statement& stmt, std::vector<LoopShape>& loops, bool shapes) {
+    if (auto block = dynamic_cast<Block*>(&stmt)) {
+        for (auto& inner : block->statements) {
+            findLoops(*inner, loops, shapes);
+        }
+    } else if (auto ifStmt = dynamic_cast<IfStatement*>(&stmt)) {
+        findLoops(*ifStmt->thenBlock, loops, shapes);
+        for (auto& elif : ifStmt->elifClauses) {
+            findLoops(*elif.body, loops, shapes);
+        }
+        if (ifStmt->elseBlock) {
+            findLoops(*ifStmt->elseBlock, loops, shapes);
+        }
+    } else if (auto loop = dynamic_cast<WhileStatement*>(&stmt)) {
+        uint64_t shape = 0;
+        if (shapes) {
+            std::string text;
+            describe(*loop, text);
+            shape = hashText(text);
+        }
+        loops.push_back({loop, shape});
+        findLoops(*loop->body, loops, shapes);
+    }
+}
+
+std::vector<LoopShape> findLoops(Program& program, bool shapes) {
+    std::vector<LoopShape> loops;
+    for (auto& stmt : program.statements) {
+        findLoops(*stmt, loops, shapes);
+    }
+    return loops;
+}
+
+bool loadProfile(const std::string& path, ProgramProfile& profile) {
+    std::ifstream file(path);
+    if (!file.is_open()) return false;
+
+    ProgramProfile loaded;
+    std::string line;
+    if (!std::getline(file, line)) return false;
+    {
+        std::istringstream fields(line);
+        std::string keyword;
+        if (!(fields >> keyword >> std::hex >> loaded.source) || keyword != "profile") return false;
+    }
+
+    while (std::getline(file, line)) {
+        std::istringstream fields(line);
+        std::string keyword;
+        if (!(fields >> keyword)) continue;
+
+        if (keyword == "loop") {
+            LoopRecord record;
+            if (!(fields >> std::hex >> record.shape >> std::dec >> record.backEdges)) return false;
+            loaded.loops.push_back(record);
+        } else if (keyword == "guard" && !loaded.loops.empty()) {
+            ResumePath position;
+            size_t index;
+            while (fields >> index) position.push_back(index);
+            if (!fields.eof()) return false;
+            loaded.loops.back().feedback.failedGuards.insert(position);
+        } else if (keyword == "unstable" && !loaded.loops.empty()) {
+            std::string name;
+            if (!(fields >> name)) return false;
+            loaded.loops.back().feedback.unstableVariables.insert(name);
+        } else {
+            return false;
+        }
+    }
+
+    profile = std::move(loaded);
+    return true;
+}
+
+void saveProfile(const std::string& path, const ProgramProfile& profile) {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot write profile file " + path);
+    }
+
+    file << "profile " << std::hex << profile.source << std::dec << "\n";
+    for (const auto& record : profile.loops) {
+        file << "loop " << std::hex << record.shape << std::dec << " " << record.backEdges << "\n";
+        for (const auto& position : record.feedback.failedGuards) {
+            file << "guard";
+            for (size_t index : position) file << " " << index;
+            file << "\n";
+        }
+        for (const auto& name : record.feedback.unstableVariables) {
+            file << "unstable " << name << "\n";
+        }
+    }
+
+    if (!file.flush()) {
+        throw std::runtime_error("Cannot write profile file " + path);
+    }
+}
@@ -0,0 +1,88 @@
+/**
+ * Guard Headers
+ */
+#ifndef PROFILE_H
+#define PROFILE_H
+
+/**
+ * Include for AST definitions, the loops are found in the Program
+ *
+ * Include for TypeFeedback saved with every loop
+ *
+ * Include for std::string and std::vector used for file names and the loops
+ *
+ * Include for uint64_t used for the hashes
+ */
+#include "ast.h"
+#include "compiler.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/**
+ * Profiles saved between runs of the same program (--profile=FILE)
+ *
+ * At the end of a run the hotness and the type feedback of every loop are written to the file,
+ * the next run loads them before starting: hot loops are compiled the first time they are entered,
+ * without warm-up in the tree walker, and do not speculate again where they already failed
+ *
+ * The file is a text file:
+ *
+ *     profile <hash of the source>
+ *     loop <shape> <back-edges>
+ *     guard <resume path>          (failed guard of the previous loop)
+ *     unstable <name>              (variable of the previous loop that was not an integer)
+ *
+ * When the hash of the source is the same the records belong to the loops in order; when it differs,
+ * a loop is identified by its shape, a hash of its source, together with the number of loops with the same
+ * shape before it, so the loops whose shape has not changed still use their profile and the others are ignored
+ */
+
+/**
+ * Profile of one loop
+ */
+struct LoopRecord {
+    uint64_t shape = 0;
+    size_t backEdges = 0;
+    TypeFeedback feedback;
+};
+
+/**
+ * Profile of a program, its loops are in the order in which they appear in the source
+ */
+struct ProgramProfile {
+    uint64_t source = 0;
+    std::vector<LoopRecord> loops;
+};
+
+/**
+ * A loop of the program and its shape
+ */
+struct LoopShape {
+    WhileStatement* loop;
+    uint64_t shape;
+};
+
+/**
+ * 64-bit FNV-1a hash of a text
+ */
+uint64_t hashText(const std::string& text);
+
+/**
+ * All the loops of the program, nested ones included, in source order
+ *
+ * With shapes false their shapes are not computed and stay 0
+ */
+std::vector<LoopShape> findLoops(Program& program, bool shapes = true);
+
+/**
+ * Reads the profile, returns false if the file does not exist or is not a valid profile
+ */
+bool loadProfile(const std::string& path, ProgramProfile& profile);
+
+/**
+ * Writes the profile, replacing the content of the file
+ */
+void saveProfile(const std::string& path, const ProgramProfile& profile);
+
+#endif // PROFILE_H
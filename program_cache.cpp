@@ -0,0 +1,700 @@
+/**
+ * Implementation of the encoding of the programs and of the shared program cache
+ *
+ * Include for std::memcpy used to copy the fields
+ *
+ * Include for std::vector used for the left spine of a chain of binary operators
+ *
+ * Include for std::runtime_error used for invalid encodings and for a cache that cannot be opened
+ *
+ * Include for std::this_thread::sleep_for used while another process initializes the cache
+ *
+ * Include for the POSIX shared memory primitives (shm_open, ftruncate, mmap)
+ */
+#include "program_cache.h"
+#include <cstring>
+#include <vector>
+#include <stdexcept>
+#include <thread>
+#include <chrono>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+/**
+ * Tag of every kind of node, NONE stands for a missing optional child
+ */
+enum class NodeTag : uint8_t {
+    NUMBER,
+    BOOLEAN,
+    IDENTIFIER,
+    LIST_ACCESS,
+    MATRIX_ACCESS,
+    LENGTH,
+    UNARY,
+    BINARY,
+    BLOCK,
+    ASSIGNMENT,
+    LIST_ASSIGNMENT,
+    MATRIX_ASSIGNMENT,
+    MULTIPLE_ASSIGNMENT,
+    LIST_CREATION,
+    DICT_CREATION,
+    MATRIX_CREATION,
+    LIST_APPEND,
+    LIST_BULK_APPEND,
+    LIST_LOAD,
+    LIST_SAVE,
+    PRINT,
+    BREAK,
+    CONTINUE,
+    IF,
+    WHILE,
+    NONE = 255
+};
+
+/**
+ * "PYPCACH1" read as a 64-bit integer, it changes with the encoding
+ */
+static const uint64_t CACHE_MAGIC = 0x3148434143505950ULL;
+
+// ================= ENCODING =================
+
+/**
+ * Appends the encoding of every node it visits
+ */
+class ProgramEncoder : public ASTVisitor {
+private:
+    std::string& out;
+
+    template<typename T>
+    void field(T value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void tag(NodeTag nodeTag) {
+        field(static_cast<uint8_t>(nodeTag));
+    }
+
+    void name(const std::string& text) {
+        field(static_cast<uint32_t>(text.size()));
+        out += text;
+    }
+
+    void child(ASTNode* node) {
+        if (node) {
+            node->accept(*this);
+        } else {
+            tag(NodeTag::NONE);
+        }
+    }
+
+public:
+    explicit ProgramEncoder(std::string& output) : out(output) {}
+
+    void visit(NumberLiteral& node) override {
+        tag(NodeTag::NUMBER);
+        field(static_cast<int32_t>(node.value));
+    }
+
+    void visit(BooleanLiteral& node) override {
+        tag(NodeTag::BOOLEAN);
+        field(static_cast<uint8_t>(node.value ? 1 : 0));
+    }
+
+    void visit(Identifier& node) override {
+        tag(NodeTag::IDENTIFIER);
+        name(node.name);
+    }
+
+    void visit(ListAccess& node) override {
+        tag(NodeTag::LIST_ACCESS);
+        name(node.listName);
+        child(node.index.get());
+    }
+
+    void visit(MatrixAccess& node) override {
+        tag(NodeTag::MATRIX_ACCESS);
+        name(node.matrixName);
+        child(node.row.get());
+        child(node.column.get());
+    }
+
+    void visit(Length& node) override {
+        tag(NodeTag::LENGTH);
+        child(node.operand.get());
+    }
+
+    void visit(UnaryOperation& node) override {
+        tag(NodeTag::UNARY);
+        field(static_cast<uint8_t>(node.op));
+        child(node.operand.get());
+    }
+
+    /**
+     * A chain (1 + 2 + ... + n) is written without recursing into the left operands: the tags and operators
+     * of the left spine, the innermost left operand, then the right operands from the innermost outwards,
+     * the same bytes as a recursive walk
+     */
+    void visit(BinaryOperation& node) override {
+        std::vector<BinaryOperation*> spine;
+        for (BinaryOperation* current = &node; current; current = dynamic_cast<BinaryOperation*>(current->left.get())) {
+            tag(NodeTag::BINARY);
+            field(static_cast<uint8_t>(current->op));
+            spine.push_back(current);
+        }
+        child(spine.back()->left.get());
+        for (size_t i = spine.size(); i-- > 0;) {
+            child(spine[i]->right.get());
+        }
+    }
+
+    void visit(Assignment& node) override {
+        tag(NodeTag::ASSIGNMENT);
+        name(node.variableName);
+        child(node.value.get());
+    }
+
+    void visit(ListAssignment& node) override {
+        tag(NodeTag::LIST_ASSIGNMENT);
+        name(node.listName);
+        child(node.index.get());
+        child(node.value.get());
+    }
+
+    void visit(MatrixAssignment& node) override {
+        tag(NodeTag::MATRIX_ASSIGNMENT);
+        name(node.matrixName);
+        child(node.row.get());
+        child(node.column.get());
+        child(node.value.get());
+    }
+
+    void visit(MultipleAssignment& node) override {
+        tag(NodeTag::MULTIPLE_ASSIGNMENT);
+        field(static_cast<uint32_t>(node.targets.size()));
+        for (auto& target : node.targets) {
+            name(target.name);
+            child(target.index.get());
+            child(target.column.get());
+        }
+        field(static_cast<uint32_t>(node.values.size()));
+        for (auto& value : node.values) {
+            child(value.get());
+        }
+    }
+
+    void visit(ListCreation& node) override {
+        tag(NodeTag::LIST_CREATION);
+        name(node.variableName);
+    }
+
+    void visit(DictCreation& node) override {
+        tag(NodeTag::DICT_CREATION);
+        name(node.variableName);
+    }
+
+    void visit(MatrixCreation& node) override {
+        tag(NodeTag::MATRIX_CREATION);
+        name(node.variableName);
+        child(node.rows.get());
+        child(node.columns.get());
+    }
+
+    void visit(ListAppend& node) override {
+        tag(NodeTag::LIST_APPEND);
+        name(node.listName);
+        child(node.value.get());
+    }
+
+    void visit(ListBulkAppend& node) override {
+        tag(NodeTag::LIST_BULK_APPEND);
+        name(node.listName);
+        field(static_cast<uint8_t>(node.elementType));
+        field(static_cast<uint32_t>(node.values.size()));
+        out.append(reinterpret_cast<const char*>(node.values.data()), node.values.size() * sizeof(int));
+    }
+
+    void visit(ListLoad& node) override {
+        tag(NodeTag::LIST_LOAD);
+        name(node.variableName);
+        name(node.path);
+    }
+
+    void visit(ListSave& node) override {
+        tag(NodeTag::LIST_SAVE);
+        name(node.listName);
+        name(node.path);
+    }
+
+    void visit(PrintStatement& node) override {
+        tag(NodeTag::PRINT);
+        child(node.expression.get());
+    }
+
+    void visit(BreakStatement&) override {
+        tag(NodeTag::BREAK);
+    }
+
+    void visit(ContinueStatement&) override {
+        tag(NodeTag::CONTINUE);
+    }
+
+    void visit(IfStatement& node) override {
+        tag(NodeTag::IF);
+        child(node.condition.get());
+        child(node.thenBlock.get());
+        field(static_cast<uint32_t>(node.elifClauses.size()));
+        for (auto& elif : node.elifClauses) {
+            child(elif.condition.get());
+            child(elif.body.get());
+        }
+        child(node.elseBlock.get());
+    }
+
+    void visit(WhileStatement& node) override {
+        tag(NodeTag::WHILE);
+        child(node.condition.get());
+        child(node.body.get());
+    }
+
+    void visit(Block& node) override {
+        tag(NodeTag::BLOCK);
+        field(static_cast<uint32_t>(node.statements.size()));
+        for (auto& stmt : node.statements) {
+            child(stmt.get());
+        }
+    }
+
+    void visit(Program& node) override {
+        field(static_cast<uint32_t>(node.statements.size()));
+        for (auto& stmt : node.statements) {
+            child(stmt.get());
+        }
+    }
+};
+
+std::string encodeProgram(Program& program) {
+    std::string out;
+    ProgramEncoder encoder(out);
+    program.accept(encoder);
+    return out;
+}
+
+// ================= DECODING =================
+
+/**
+ * Reads the encoding back into nodes, checking every length and tag
+ *
+ * The depth is limited like the nesting accepted by the parser, so invalid bytes cannot exhaust the stack;
+ * the left spine of a chain of binary operators is read in a loop and does not count, as in the parser
+ */
+class ProgramDecoder {
+private:
+    static constexpr size_t MAX_DEPTH = 4096;
+
+    const char* cursor;
+    const char* end;
+    size_t depth = 0;
+
+    [[noreturn]] void fail() const {
+        throw std::runtime_error("Invalid program in the cache");
+    }
+
+    void require(size_t size) const {
+        if (static_cast<size_t>(end - cursor) < size) fail();
+    }
+
+    template<typename T>
+    T field() {
+        require(sizeof(T));
+        T value;
+        std::memcpy(&value, cursor, sizeof(T));
+        cursor += sizeof(T);
+        return value;
+    }
+
+    std::string name() {
+        uint32_t length = field<uint32_t>();
+        require(length);
+        std::string text(cursor, length);
+        cursor += length;
+        return text;
+    }
+
+    NodeTag tag() {
+        return static_cast<NodeTag>(field<uint8_t>());
+    }
+
+    /**
+     * Node of any kind, or nullptr for NONE
+     */
+    std::unique_ptr<ASTNode> node(NodeTag nodeTag) {
+        if (++depth > MAX_DEPTH) fail();
+        std::unique_ptr<ASTNode> result = decode(nodeTag);
+        depth--;
+        return result;
+    }
+
+    template<typename T>
+    std::unique_ptr<T> child(bool optional = false) {
+        return typed<T>(node(tag()), optional);
+    }
+
+    template<typename T>
+    std::unique_ptr<T> typed(std::unique_ptr<ASTNode> decoded, bool optional = false) {
+        if (!decoded) {
+            if (!optional) fail();
+            return nullptr;
+        }
+        T* typed = dynamic_cast<T*>(decoded.get());
+        if (!typed) fail();
+        decoded.release();
+        return std::unique_ptr<T>(typed);
+    }
+
+    std::unique_ptr<ASTNode> decode(NodeTag nodeTag) {
+        switch (nodeTag) {
+            case NodeTag::NUMBER:
+                return std::make_unique<NumberLiteral>(field<int32_t>());
+            case NodeTag::BOOLEAN:
+                return std::make_unique<BooleanLiteral>(field<uint8_t>() != 0);
+            case NodeTag::IDENTIFIER:
+                return std::make_unique<Identifier>(name());
+            case NodeTag::LIST_ACCESS: {
+                std::string listName = name();
+                return std::make_unique<ListAccess>(listName, child<Expression>());
+            }
+            case NodeTag::MATRIX_ACCESS: {
+                std::string matrixName = name();
+                auto row = child<Expression>();
+                return std::make_unique<MatrixAccess>(matrixName, std::move(row), child<Expression>());
+            }
+            case NodeTag::LENGTH:
+                return std::make_unique<Length>(child<Expression>());
+            case NodeTag::UNARY: {
+                uint8_t op = field<uint8_t>();
+                if (op > static_cast<uint8_t>(UnaryOperation::Operator::NOT)) fail();
+                return std::make_unique<UnaryOperation>(static_cast<UnaryOperation::Operator>(op), child<Expression>());
+            }
+            case NodeTag::BINARY: {
+                std::vector<BinaryOperation::Operator> operators;
+                NodeTag next = NodeTag::BINARY;
+                while (next == NodeTag::BINARY) {
+                    uint8_t op = field<uint8_t>();
+                    if (op > static_cast<uint8_t>(BinaryOperation::Operator::NOT_IN)) fail();
+                    operators.push_back(static_cast<BinaryOperation::Operator>(op));
+                    next = tag();
+                }
+                auto expr = typed<Expression>(node(next));
+                for (size_t i = operators.size(); i-- > 0;) {
+                    auto right = child<Expression>();
+                    expr = std::make_unique<BinaryOperation>(std::move(expr), operators[i], std::move(right));
+                }
+                return expr;
+            }
+            case NodeTag::BLOCK: {
+                auto block = std::make_unique<Block>();
+                uint32_t count = field<uint32_t>();
+                for (uint32_t i = 0; i < count; i++) {
+                    block->addStatement(child<Statement>());
+                }
+                return block;
+            }
+            case NodeTag::ASSIGNMENT: {
+                std::string variableName = name();
+                return std::make_unique<Assignment>(variableName, child<Expression>());
+            }
+            case NodeTag::LIST_ASSIGNMENT: {
+                std::string listName = name();
+                auto index = child<Expression>();
+                return std::make_unique<ListAssignment>(listName, std::move(index), child<Expression>());
+            }
+            case NodeTag::MATRIX_ASSIGNMENT: {
+                std::string matrixName = name();
+                auto row = child<Expression>();
+                auto column = child<Expression>();
+                return std::make_unique<MatrixAssignment>(matrixName, std::move(row), std::move(column),
+                                                          child<Expression>());
+            }
+            case NodeTag::MULTIPLE_ASSIGNMENT: {
+                auto assignment = std::make_unique<MultipleAssignment>();
+                uint32_t targets = field<uint32_t>();
+                for (uint32_t i = 0; i < targets; i++) {
+                    std::string targetName = name();
+                    auto index = child<Expression>(true);
+                    auto column = child<Expression>(true);
+                    assignment->targets.emplace_back(targetName, std::move(index), std::move(column));
+                }
+                uint32_t values = field<uint32_t>();
+                for (uint32_t i = 0; i < values; i++) {
+                    assignment->values.push_back(child<Expression>());
+                }
+                return assignment;
+            }
+            case NodeTag::LIST_CREATION:
+                return std::make_unique<ListCreation>(name());
+            case NodeTag::DICT_CREATION:
+                return std::make_unique<DictCreation>(name());
+            case NodeTag::MATRIX_CREATION: {
+                std::string variableName = name();
+                auto rows = child<Expression>();
+                return std::make_unique<MatrixCreation>(variableName, std::move(rows), child<Expression>());
+            }
+            case NodeTag::LIST_APPEND: {
+                std::string listName = name();
+                return std::make_unique<ListAppend>(listName, child<Expression>());
+            }
+            case NodeTag::LIST_BULK_APPEND: {
+                std::string listName = name();
+                uint8_t type = field<uint8_t>();
+                if (type > static_cast<uint8_t>(DataType::UNDEFINED)) fail();
+                auto append = std::make_unique<ListBulkAppend>(listName, static_cast<DataType>(type));
+                uint32_t count = field<uint32_t>();
+                require(static_cast<size_t>(count) * sizeof(int));
+                append->values.resize(count);
+                std::memcpy(append->values.data(), cursor, static_cast<size_t>(count) * sizeof(int));
+                cursor += static_cast<size_t>(count) * sizeof(int);
+                return append;
+            }
+            case NodeTag::LIST_LOAD: {
+                std::string variableName = name();
+                return std::make_unique<ListLoad>(variableName, name());
+            }
+            case NodeTag::LIST_SAVE: {
+                std::string listName = name();
+                return std::make_unique<ListSave>(listName, name());
+            }
+            case NodeTag::PRINT:
+                return std::make_unique<PrintStatement>(child<Expression>());
+            case NodeTag::BREAK:
+                return std::make_unique<BreakStatement>();
+            case NodeTag::CONTINUE:
+                return std::make_unique<ContinueStatement>();
+            case NodeTag::IF: {
+                auto condition = child<Expression>();
+                auto ifStmt = std::make_unique<IfStatement>(std::move(condition), child<Block>());
+                uint32_t elifs = field<uint32_t>();
+                for (uint32_t i = 0; i < elifs; i++) {
+                    auto elifCondition = child<Expression>();
+                    ifStmt->addElif(std::move(elifCondition), child<Block>());
+                }
+                ifStmt->setElse(child<Block>(true));
+                return ifStmt;
+            }
+            case NodeTag::WHILE: {
+                auto condition = child<Expression>();
+                return std::make_unique<WhileStatement>(std::move(condition), child<Block>());
+            }
+            case NodeTag::NONE:
+                return nullptr;
+        }
+        fail();
+    }
+
+public:
+    ProgramDecoder(const char* data, size_t size) : cursor(data), end(data + size) {}
+
+    std::unique_ptr<Program> program() {
+        auto decoded = std::make_unique<Program>();
+        uint32_t count = field<uint32_t>();
+        for (uint32_t i = 0; i < count; i++) {
+            decoded->addStatement(child<Statement>());
+        }
+        if (cursor != end) fail();
+        return decoded;
+    }
+};
+
+std::unique_ptr<Program> decodeProgram(const char* data, size_t size) {
+    ProgramDecoder decoder(data, size);
+    return decoder.program();
+}
+
+// ================= SHARED CACHE =================
+
+#ifndef _WIN32
+
+/**
+ * Opens the shared memory object, creating it if it does not exist yet, and maps it
+ */
+ProgramCache::ProgramCache(const std::string& cacheName)
+    : name(cacheName[0] == '/' ? cacheName : "/" + cacheName), hits(0), misses(0) {
+    bool created = true;
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0 && errno == EEXIST) {
+        created = false;
+        fd = shm_open(name.c_str(), O_RDWR, 0600);
+    }
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open program cache " + name);
+    }
+
+    if (created && ftruncate(fd, SEGMENT_SIZE) != 0) {
+        ::close(fd);
+        shm_unlink(name.c_str());
+        throw std::runtime_error("Cannot open program cache " + name);
+    }
+
+    struct stat info;
+    for (int attempt = 0; !created && attempt < 1000; attempt++) {
+        if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= SEGMENT_SIZE) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (!created && (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < SEGMENT_SIZE)) {
+        ::close(fd);
+        throw std::runtime_error("Cannot open program cache " + name);
+    }
+
+    void* readOnly = mmap(nullptr, SEGMENT_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+    void* readWrite = mmap(nullptr, SEGMENT_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (readOnly == MAP_FAILED || readWrite == MAP_FAILED) {
+        if (readOnly != MAP_FAILED) munmap(readOnly, SEGMENT_SIZE);
+        if (readWrite != MAP_FAILED) munmap(readWrite, SEGMENT_SIZE);
+        throw std::runtime_error("Cannot open program cache " + name);
+    }
+    view = static_cast<const char*>(readOnly);
+    writable = static_cast<char*>(readWrite);
+
+    Header& shared = *reinterpret_cast<Header*>(writable);
+    if (created) {
+        shared.slotCount = SLOT_COUNT;
+        shared.dataStart = sizeof(Header) + SLOT_COUNT * sizeof(Slot);
+        shared.used.store(0);
+        shared.magic.store(CACHE_MAGIC, std::memory_order_release);
+        return;
+    }
+
+    for (int attempt = 0; attempt < 1000; attempt++) {
+        if (header().magic.load(std::memory_order_acquire) == CACHE_MAGIC) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (header().magic.load(std::memory_order_acquire) != CACHE_MAGIC || header().slotCount != SLOT_COUNT) {
+        munmap(const_cast<char*>(view), SEGMENT_SIZE);
+        munmap(writable, SEGMENT_SIZE);
+        view = nullptr;
+        writable = nullptr;
+        throw std::runtime_error("Program cache " + name + " is not valid");
+    }
+}
+
+ProgramCache::~ProgramCache() {
+    if (view) munmap(const_cast<char*>(view), SEGMENT_SIZE);
+    if (writable) munmap(writable, SEGMENT_SIZE);
+}
+
+#else
+
+ProgramCache::ProgramCache(const std::string& cacheName) : name(cacheName), hits(0), misses(0) {
+    throw std::runtime_error("The program cache needs POSIX shared memory");
+}
+
+ProgramCache::~ProgramCache() {}
+
+#endif
+
+/**
+ * Key of a source in the table, the two smallest values mark the empty slots and those being filled
+ */
+uint64_t ProgramCache::keyOf(uint64_t hash) {
+    return hash > FILLING ? hash : hash + 2;
+}
+
+const ProgramCache::Header& ProgramCache::header() const {
+    return *reinterpret_cast<const Header*>(view);
+}
+
+const ProgramCache::Slot& ProgramCache::slotAt(size_t index) const {
+    return reinterpret_cast<const Slot*>(view + sizeof(Header))[index];
+}
+
+/**
+ * Decodes the program of the source with that hash and size from the read-only mapping, nullptr if it is
+ * not cached (an entry that does not decode counts as missing)
+ */
+std::unique_ptr<Program> ProgramCache::find(uint64_t hash, size_t sourceSize) const {
+    uint64_t key = keyOf(hash);
+    for (size_t probe = 0; probe < SLOT_COUNT; probe++) {
+        const Slot& slot = slotAt((hash + probe) % SLOT_COUNT);
+        uint64_t stored = slot.key.load(std::memory_order_acquire);
+        if (stored == EMPTY) break;
+        if (stored != key || slot.sourceSize != sourceSize) continue;
+
+        if (slot.offset < header().dataStart || slot.offset > SEGMENT_SIZE || slot.size > SEGMENT_SIZE - slot.offset) break;
+        try {
+            auto program = decodeProgram(view + slot.offset, slot.size);
+            hits++;
+            return program;
+        } catch (const std::runtime_error&) {
+            break;
+        }
+    }
+    misses++;
+    return nullptr;
+}
+
+/**
+ * Takes room for size bytes at the end of the data area, false if they do not fit
+ *
+ * The room is taken with a compare-and-swap, so a cache that is full stays as it is
+ */
+bool ProgramCache::reserve(size_t size, uint64_t& offset) {
+    Header& shared = *reinterpret_cast<Header*>(writable);
+    uint64_t room = (size + 7) & ~static_cast<uint64_t>(7);
+    uint64_t capacity = SEGMENT_SIZE - shared.dataStart;
+    uint64_t used = shared.used.load();
+    do {
+        if (room > capacity - used) return false;
+    } while (!shared.used.compare_exchange_weak(used, used + room));
+    offset = shared.dataStart + used;
+    return true;
+}
+
+/**
+ * Adds the encoded program of a source, unless the cache is full or the source is already there
+ *
+ * The slot is claimed (FILLING) before any room is taken, so a source that another process has added or is
+ * adding costs no space: a slot being filled is waited for, up to FILLING_WAIT yields, and compared when its
+ * key is published; if it is still being filled (its process may have died) the program is not cached.
+ * If the data area is full the claimed slot goes back to EMPTY
+ */
+void ProgramCache::insert(uint64_t hash, size_t sourceSize, const std::string& encoded) {
+    uint64_t key = keyOf(hash);
+    Slot* slots = reinterpret_cast<Slot*>(writable + sizeof(Header));
+    size_t probe = 0;
+    while (probe < SLOT_COUNT) {
+        Slot& slot = slots[(hash + probe) % SLOT_COUNT];
+        uint64_t stored = slot.key.load(std::memory_order_acquire);
+        for (size_t wait = 0; stored == FILLING && wait < FILLING_WAIT; wait++) {
+            std::this_thread::yield();
+            stored = slot.key.load(std::memory_order_acquire);
+        }
+        if (stored == FILLING) return;
+        if (stored == key && slot.sourceSize == sourceSize) return;
+        if (stored != EMPTY) {
+            probe++;
+            continue;
+        }
+        if (!slot.key.compare_exchange_strong(stored, FILLING)) {
+            continue; // another process claimed the slot first, look at it again
+        }
+
+        uint64_t offset;
+        if (!reserve(encoded.size(), offset)) {
+            slot.key.store(EMPTY, std::memory_order_release);
+            return;
+        }
+        std::memcpy(writable + offset, encoded.data(), encoded.size());
+        slot.sourceSize = sourceSize;
+        slot.offset = offset;
+        slot.size = encoded.size();
+        slot.key.store(key, std::memory_order_release);
+        return;
+    }
+}
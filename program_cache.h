@@ -0,0 +1,115 @@
+/**
+ * Guard Headers
+ */
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+/**
+ * Include for AST definitions, the cache holds encoded Programs
+ *
+ * Include for std::string used for the name and the encoded programs
+ *
+ * Include for std::unique_ptr used to return the decoded programs
+ *
+ * Include for std::atomic used for the slots shared between processes and for the counters
+ *
+ * Include for uint64_t used for the hashes and the offsets
+ */
+#include "ast.h"
+#include <string>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * Flat encoding of a Program: every node is a tag followed by its fields and its children in order,
+ * numbers are stored as they are in memory and names as their length and bytes
+ *
+ * It contains no pointers, so it can be decoded wherever it is mapped; the annotations of the Optimizer
+ * are not part of it, every decoded Program is analyzed again
+ */
+std::string encodeProgram(Program& program);
+
+/**
+ * Rebuilds the Program, throws std::runtime_error if the bytes are not a valid encoding
+ */
+std::unique_ptr<Program> decodeProgram(const char* data, size_t size);
+
+/**
+ * Programs already parsed by any process of the host (--program-cache=NAME)
+ *
+ * The cache is a POSIX shared memory object of SEGMENT_SIZE bytes: a header, a table of SLOT_COUNT slots
+ * and a data area holding the encoded programs. A process maps it twice, read-only to look programs up and
+ * decode them, and writable to add the programs it had to parse
+ *
+ * A slot holds the hash of the source (the key), its size and where its program is in the data area;
+ * the slot of a source is found by linear probing from its hash
+ *
+ * Lookups take no lock: the key of a slot is published with a release store after the rest of the slot and
+ * the program have been written, so a process that reads the key (acquire) also sees the program. To add a
+ * program a process claims an empty slot with a compare-and-swap (FILLING), only then takes room at the end
+ * of the data area, copies the program there and stores the key. Entries are never removed: when the data
+ * area or the table is full new programs are simply not cached
+ *
+ * The first process creates and initializes the object, the others wait until its header is ready;
+ * the object stays until it is removed (shm_unlink, or /dev/shm on Linux)
+ */
+class ProgramCache {
+public:
+    static constexpr size_t SEGMENT_SIZE = 64 * 1024 * 1024;
+    static constexpr size_t SLOT_COUNT = 16384;
+
+private:
+    struct Header {
+        std::atomic<uint64_t> magic;
+        uint64_t slotCount;
+        uint64_t dataStart;
+        std::atomic<uint64_t> used;
+    };
+
+    struct Slot {
+        std::atomic<uint64_t> key;
+        uint64_t sourceSize;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    static constexpr uint64_t EMPTY = 0;
+    static constexpr uint64_t FILLING = 1;
+    static constexpr size_t FILLING_WAIT = 100000;
+
+    std::string name;
+    const char* view = nullptr;
+    char* writable = nullptr;
+
+    mutable std::atomic<size_t> hits;
+    mutable std::atomic<size_t> misses;
+
+    static uint64_t keyOf(uint64_t hash);
+
+    const Header& header() const;
+    const Slot& slotAt(size_t index) const;
+
+    bool reserve(size_t size, uint64_t& offset);
+
+public:
+    explicit ProgramCache(const std::string& cacheName);
+    ~ProgramCache();
+
+    ProgramCache(const ProgramCache&) = delete;
+    ProgramCache& operator=(const ProgramCache&) = delete;
+
+    std::unique_ptr<Program> find(uint64_t hash, size_t sourceSize) const;
+
+    void insert(uint64_t hash, size_t sourceSize, const std::string& encoded);
+
+    size_t hitCount() const {
+        return hits;
+    }
+
+    size_t missCount() const {
+        return misses;
+    }
+};
+
+#endif // PROGRAM_CACHE_H
@@ -0,0 +1,226 @@
+/**
+ * Implementation of the RecordReader class
+ * 
+ * Include for uint64_t and int64_t used by the varint decoding
+ * 
+ * Include for std::numeric_limits used to check the decoded integers
+ */
+#include "record_reader.h"
+#include <cstdint>
+#include <limits>
+
+/**
+ * Initializes the reader at the beginning of the buffer
+ */
+RecordReader::RecordReader(const char* buffer, size_t length, OutputFormat recordFormat)
+    : data(buffer), size(length), pos(0), format(recordFormat) {
+    if (format == OutputFormat::TEXT) {
+        throw RuntimeError("The text format cannot be read back, use ndjson or binary");
+    }
+}
+
+/**
+ * Decodes the next printed value
+ * 
+ * Returns false at the end of the buffer
+ */
+bool RecordReader::next(Value& value) {
+    if (format == OutputFormat::NDJSON) {
+        skipSpaces();
+        if (pos >= size) return false;
+        value = readJson();
+        skipSpaces();
+        return true;
+    }
+
+    if (pos >= size) return false;
+    value = readBinary();
+    return true;
+}
+
+// ================= BINARY =================
+
+/**
+ * Reads an unsigned LEB128 varint
+ */
+uint64_t RecordReader::readVarint() {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= size) {
+            throw RuntimeError("Truncated varint in binary output");
+        }
+        unsigned char byte = static_cast<unsigned char>(data[pos++]);
+        result |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return result;
+        }
+    }
+    throw RuntimeError("Varint too long in binary output");
+}
+
+/**
+ * Reads one record: tag byte followed by its payload
+ */
+Value RecordReader::readBinary() {
+    if (pos >= size) {
+        throw RuntimeError("Truncated record in binary output");
+    }
+
+    switch (static_cast<RecordTag>(static_cast<unsigned char>(data[pos++]))) {
+        case RecordTag::INT: {
+            uint64_t zigzag = readVarint();
+            int64_t n = static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+            if (n < std::numeric_limits<int>::min() || n > std::numeric_limits<int>::max()) {
+                throw RuntimeError("Integer out of range in binary output");
+            }
+            return Value(static_cast<int>(n));
+        }
+        case RecordTag::BOOL:
+            if (pos >= size) {
+                throw RuntimeError("Truncated boolean in binary output");
+            }
+            return Value(data[pos++] != 0);
+        case RecordTag::LIST: {
+            uint64_t count = readVarint();
+            if (count > size - pos) {
+                throw RuntimeError("Invalid list length in binary output");
+            }
+            List list;
+            list.reserve(count);
+            for (uint64_t i = 0; i < count; i++) {
+                list.push_back(readBinary());
+            }
+            return Value(list);
+        }
+        case RecordTag::DICT: {
+            uint64_t count = readVarint();
+            if (count > size - pos) {
+                throw RuntimeError("Invalid dictionary length in binary output");
+            }
+            Dict dict;
+            for (uint64_t i = 0; i < count; i++) {
+                Value key = readBinary();
+                dict[key] = readBinary();
+            }
+            return Value(std::move(dict));
+        }
+    }
+    throw RuntimeError("Unknown record tag in binary output");
+}
+
+// ================= NDJSON =================
+
+/**
+ * Skips spaces and the newlines between records
+ */
+void RecordReader::skipSpaces() {
+    while (pos < size && (data[pos] == ' ' || data[pos] == '\n' || data[pos] == '\r' || data[pos] == '\t')) {
+        pos++;
+    }
+}
+
+/**
+ * Reads a JSON value among the ones produced by the interpreter: integers, true/false, arrays
+ * and objects whose keys are the quoted integers or booleans of a dictionary
+ */
+Value RecordReader::readJson() {
+    skipSpaces();
+    if (pos >= size) {
+        throw RuntimeError("Truncated value in ndjson output");
+    }
+
+    char c = data[pos];
+
+    if (c == '[') {
+        pos++;
+        List list;
+        skipSpaces();
+        if (pos < size && data[pos] == ']') {
+            pos++;
+            return Value(list);
+        }
+        while (true) {
+            list.push_back(readJson());
+            skipSpaces();
+            if (pos < size && data[pos] == ',') {
+                pos++;
+            } else if (pos < size && data[pos] == ']') {
+                pos++;
+                return Value(list);
+            } else {
+                throw RuntimeError("Expected ',' or ']' in ndjson output");
+            }
+        }
+    }
+
+    if (c == '{') {
+        pos++;
+        Dict dict;
+        skipSpaces();
+        if (pos < size && data[pos] == '}') {
+            pos++;
+            return Value(std::move(dict));
+        }
+        while (true) {
+            skipSpaces();
+            if (pos >= size || data[pos] != '"') {
+                throw RuntimeError("Expected '\"' in ndjson output");
+            }
+            pos++;
+            Value key = readJson();
+            if (pos >= size || data[pos] != '"') {
+                throw RuntimeError("Expected '\"' in ndjson output");
+            }
+            pos++;
+            skipSpaces();
+            if (pos >= size || data[pos] != ':') {
+                throw RuntimeError("Expected ':' in ndjson output");
+            }
+            pos++;
+            dict[key] = readJson();
+            skipSpaces();
+            if (pos < size && data[pos] == ',') {
+                pos++;
+            } else if (pos < size && data[pos] == '}') {
+                pos++;
+                return Value(std::move(dict));
+            } else {
+                throw RuntimeError("Expected ',' or '}' in ndjson output");
+            }
+        }
+    }
+
+    if (size - pos >= 4 && data[pos] == 't' && std::string(data + pos, 4) == "true") {
+        pos += 4;
+        return Value(true);
+    }
+
+    if (size - pos >= 5 && data[pos] == 'f' && std::string(data + pos, 5) == "false") {
+        pos += 5;
+        return Value(false);
+    }
+
+    bool negative = false;
+    if (c == '-') {
+        negative = true;
+        pos++;
+    }
+
+    if (pos >= size || data[pos] < '0' || data[pos] > '9') {
+        throw RuntimeError("Unexpected character in ndjson output");
+    }
+
+    int64_t n = 0;
+    while (pos < size && data[pos] >= '0' && data[pos] <= '9') {
+        n = n * 10 + (data[pos] - '0');
+        if (n > static_cast<int64_t>(std::numeric_limits<int>::max()) + 1) {
+            throw RuntimeError("Integer out of range in ndjson output");
+        }
+        pos++;
+    }
+    if (negative) n = -n;
+    if (n > std::numeric_limits<int>::max()) {
+        throw RuntimeError("Integer out of range in ndjson output");
+    }
+    return Value(static_cast<int>(n));
+}
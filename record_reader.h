@@ -0,0 +1,47 @@
+/**
+ * Guard Headers
+ */
+#ifndef RECORD_READER_H
+#define RECORD_READER_H
+
+/**
+ * Include for OutputFormat and the binary record tags
+ * 
+ * Include for Value returned to the consumer
+ * 
+ * Include for size_t used for buffer positions
+ */
+#include "format.h"
+#include "value.h"
+#include <cstddef>
+
+/**
+ * Reader for the output produced with --output-format=ndjson or --output-format=binary
+ * 
+ * Small library for the programs that consume the output of the interpreter:
+ * it decodes the printed values back into Value objects, one per print statement
+ * 
+ * The reader does not own the data, the buffer must stay alive while reading
+ * 
+ * Malformed input is reported with RuntimeError
+ */
+class RecordReader {
+private:
+    const char* data;
+    size_t size;
+    size_t pos;
+    OutputFormat format;
+
+    Value readBinary();
+    uint64_t readVarint();
+
+    Value readJson();
+    void skipSpaces();
+
+public:
+    RecordReader(const char* buffer, size_t length, OutputFormat recordFormat);
+
+    bool next(Value& value);
+};
+
+#endif // RECORD_READER_H
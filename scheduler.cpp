@@ -0,0 +1,307 @@
+/**
+ * Implementation of the green threads and of the work-stealing scheduler
+ *
+ * Include for std::thread used for the workers
+ *
+ * Include for std::chrono used by the idle workers to wait
+ *
+ * Include for std::runtime_error used when a stack cannot be allocated
+
+ *
+ * Include for mmap, mprotect and munmap used for the stacks
+ */
+#include "scheduler.h"
+#include <thread>
+#include <chrono>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+thread_local Scheduler::GreenThread* Scheduler::running = nullptr;
+
+Scheduler::GreenThread::~GreenThread() {
+#ifdef __linux__
+    if (stack) {
+        munmap(stack, GUARD_SIZE + STACK_SIZE);
+    }
+#endif
+}
+
+/**
+ * A scheduler with workerCount workers (at least one), they start with run()
+ */
+Scheduler::Scheduler(size_t workerCount) : nextPending(0), live(0), remaining(0), switches(0), steals(0) {
+    if (workerCount == 0) {
+        workerCount = 1;
+    }
+    for (size_t i = 0; i < workerCount; i++) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+}
+
+/**
+ * Releases the stacks kept for reuse
+ */
+Scheduler::~Scheduler() {
+#ifdef __linux__
+    for (void* stack : freeStacks) {
+        munmap(stack, GUARD_SIZE + STACK_SIZE);
+    }
+#endif
+}
+
+/**
+ * Adds a task before run(), the tasks start in the order of spawn
+ */
+void Scheduler::spawn(std::function<void()> task) {
+    auto thread = std::make_unique<GreenThread>();
+    thread->index = threads.size();
+    thread->task = std::move(task);
+    pending.push_back(thread.get());
+    threads.push_back(std::move(thread));
+    errors.emplace_back();
+}
+
+/**
+ * Runs every task to the end, the calling thread is the first worker
+ *
+ * A task that ends with an exception does not stop the others, its error is returned by error()
+ */
+void Scheduler::run() {
+    remaining = 0;
+    for (const auto& thread : threads) {
+        if (thread) remaining++;
+    }
+
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < workers.size(); i++) {
+        pool.emplace_back(&Scheduler::work, this, i);
+    }
+    work(0);
+    for (auto& worker : pool) {
+        worker.join();
+    }
+}
+
+/**
+ * The exception that ended a task (null if it returned normally), the one thrown when its stack
+ * could not be allocated included
+ */
+std::exception_ptr Scheduler::error(size_t task) const {
+    return errors[task];
+}
+
+Scheduler::Stats Scheduler::getStats() const {
+    Stats stats;
+    stats.tasks = threads.size();
+    stats.switches = switches;
+    stats.steals = steals;
+    return stats;
+}
+
+/**
+ * The next task that has not started, if there is one and fewer than MAX_LIVE_THREADS threads are alive
+ */
+Scheduler::GreenThread* Scheduler::startNext() {
+    size_t count = live;
+    while (count < MAX_LIVE_THREADS) {
+        if (live.compare_exchange_weak(count, count + 1)) {
+            size_t next = nextPending++;
+            if (next < pending.size()) {
+                return pending[next];
+            }
+            live--;
+            return nullptr;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * Next thread for a worker: a task that has not started, otherwise the front of its own queue, otherwise
+ * the back of the first other queue that is not empty
+ */
+Scheduler::GreenThread* Scheduler::take(size_t index) {
+    if (GreenThread* thread = startNext()) {
+        return thread;
+    }
+
+    Worker& own = *workers[index];
+    {
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.queue.empty()) {
+            GreenThread* thread = own.queue.front();
+            own.queue.pop_front();
+            return thread;
+        }
+    }
+
+    for (size_t i = 1; i < workers.size(); i++) {
+        Worker& victim = *workers[(index + i) % workers.size()];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.queue.empty()) {
+            GreenThread* thread = victim.queue.back();
+            victim.queue.pop_back();
+            steals++;
+            return thread;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * Loop of a worker: resumes threads until every task has finished; a thread that yielded goes
+ * to the end of the queue of the worker that ran it
+ *
+ * A worker that finds no thread waits a little (the others may be about to yield one) and looks again
+ */
+void Scheduler::work(size_t index) {
+    Worker& worker = *workers[index];
+    while (remaining > 0) {
+        GreenThread* thread = take(index);
+        if (!thread) {
+            std::unique_lock<std::mutex> lock(idleLock);
+            idle.wait_for(lock, std::chrono::milliseconds(1), [this] { return remaining == 0; });
+            continue;
+        }
+
+        resume(worker, *thread);
+
+        if (thread->finished) {
+            finish(*thread);
+        } else {
+            switches++;
+            std::lock_guard<std::mutex> guard(worker.lock);
+            worker.queue.push_back(thread);
+        }
+    }
+}
+
+/**
+ * Releases the arena of a finished thread, keeping only its error; its stack is kept for the next thread
+ */
+void Scheduler::finish(GreenThread& thread) {
+    size_t index = thread.index;
+    errors[index] = thread.error;
+#ifdef __linux__
+    if (thread.stack) {
+        std::lock_guard<std::mutex> guard(stackLock);
+        freeStacks.push_back(thread.stack);
+        thread.stack = nullptr;
+    }
+#endif
+    threads[index].reset();
+    live--;
+
+    if (--remaining == 0) {
+        std::lock_guard<std::mutex> lock(idleLock);
+        idle.notify_all();
+    }
+}
+
+/**
+ * Gives the thread the stack of a finished one, or maps a new one with its guard page; returns false
+ * if the memory or the mappings are exhausted
+ */
+bool Scheduler::allocateStack(GreenThread& thread) {
+#ifdef __linux__
+    {
+        std::lock_guard<std::mutex> guard(stackLock);
+        if (!freeStacks.empty()) {
+            thread.stack = freeStacks.back();
+            freeStacks.pop_back();
+            return true;
+        }
+    }
+
+    void* memory = mmap(nullptr, GUARD_SIZE + STACK_SIZE, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+    if (memory == MAP_FAILED) {
+        return false;
+    }
+    if (mprotect(memory, GUARD_SIZE, PROT_NONE) != 0) {
+        munmap(memory, GUARD_SIZE + STACK_SIZE);
+        return false;
+    }
+    thread.stack = memory;
+    return true;
+#else
+    (void)thread;
+    return true;
+#endif
+}
+
+/**
+ * Runs a thread on the worker until it yields or finishes, with its arena active
+ *
+ * The stack is allocated the first time; if that fails the thread finishes with the error
+ */
+void Scheduler::resume(Worker& worker, GreenThread& thread) {
+    running = &thread;
+    Arena* previous = Arena::exchangeActive(thread.activeArena);
+
+#ifdef __linux__
+    if (!thread.started) {
+        thread.started = true;
+        if (!allocateStack(thread)) {
+            thread.error = std::make_exception_ptr(std::runtime_error("Cannot allocate the stack of a script"));
+            thread.finished = true;
+        } else {
+            getcontext(&thread.context);
+            thread.context.uc_stack.ss_sp = static_cast<char*>(thread.stack) + GUARD_SIZE;
+            thread.context.uc_stack.ss_size = STACK_SIZE;
+            thread.context.uc_link = nullptr;
+            makecontext(&thread.context, &Scheduler::start, 0);
+        }
+    }
+    if (!thread.finished) {
+        thread.resumer = &worker.context;
+        swapcontext(&worker.context, &thread.context);
+    }
+#else
+    (void)worker;
+    thread.started = true;
+    try {
+        thread.task();
+    } catch (...) {
+        thread.error = std::current_exception();
+    }
+    thread.finished = true;
+#endif
+
+    thread.activeArena = Arena::exchangeActive(previous);
+    running = nullptr;
+}
+
+/**
+ * First function on the stack of a green thread: runs the task and goes back to the worker that resumed
+ * it last (not necessarily the one that started it), never returns
+ */
+void Scheduler::start() {
+#ifdef __linux__
+    GreenThread* self = running;
+    try {
+        self->task();
+    } catch (...) {
+        self->error = std::current_exception();
+    }
+    self->finished = true;
+    setcontext(self->resumer);
+#endif
+}
+
+/**
+ * Suspends the running green thread, its worker puts it back in the queue; outside a green thread it does nothing
+ *
+ * It must not be called inside a catch block: the exception being handled belongs to the worker,
+ * and the thread may continue on another one
+ */
+void Scheduler::yield() {
+#ifdef __linux__
+    GreenThread* self = running;
+    if (!self) return;
+    swapcontext(&self->context, self->resumer);
+#endif
+}
@@ -0,0 +1,158 @@
+/**
+ * Guard Headers
+ */
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+/**
+ * Include for Arena, every green thread has its own
+ *
+ * Include for size_t used for counters
+ *
+ * Include for std::function used for the tasks
+ *
+ * Include for std::deque, std::vector and std::unique_ptr used for the queues and the workers
+ *
+ * Include for std::mutex, std::condition_variable and std::atomic used between the workers
+ *
+ * Include for std::exception_ptr used to keep the error of a task that could not run
+ *
+ * Include for ucontext_t used to switch between the stacks of the green threads
+ */
+#include "arena.h"
+#include <cstddef>
+#include <functional>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+
+#ifdef __linux__
+#include <ucontext.h>
+#endif
+
+/**
+ * Runs many tasks (the scripts of a batch) as green threads on a few OS threads (workers)
+ *
+ * A green thread executes on its own stack, allocated on the heap when it starts, so the recursive
+ * visit calls of a script are suspended with it and resumed later, possibly by another worker;
+ * a suspended thread costs only the pages of its stack that it has touched
+ *
+ * Preemption is cooperative: a task calls yield() (the Interpreter does it at the back-edges of its loops
+ * when its step quantum is spent) and the worker puts it at the end of its queue and resumes the next one
+ *
+ * The tasks wait in the order of spawn and a worker starts the next one while fewer than MAX_LIVE_THREADS
+ * threads are alive (started and not finished), so a batch of any size uses a bounded number of stacks; the
+ * stack of a finished thread is kept and given to the next one
+ *
+ * Otherwise a worker takes threads from the front of its own queue; when that is empty it steals from the back
+ * of the queue of another worker, so the work spreads over the workers even when some tasks are much
+ * longer than others
+ *
+ * Each green thread has its own arena, active only while it runs: the lists of a suspended script stay
+ * where they are and the next script does not allocate on top of them
+ *
+ * Without ucontext (not Linux) every task runs to the end on the stack of its worker and yield() does nothing
+ */
+class Scheduler {
+public:
+    /**
+     * How many tasks ran, how many times they yielded and how many were stolen by another worker
+     */
+    struct Stats {
+        size_t tasks = 0;
+        size_t switches = 0;
+        size_t steals = 0;
+    };
+
+private:
+    /**
+     * Stack size of a green thread, as large as the usual stack of a program so the nesting allowed by the parser
+     * fits; the memory is reserved, not committed, and a page without access below it stops an overflow
+     */
+    static constexpr size_t STACK_SIZE = 8 * 1024 * 1024;
+    static constexpr size_t GUARD_SIZE = 4096;
+
+    /**
+     * Threads alive at the same time, each stack takes two mappings (the stack and its guard) out of the
+     * 65530 a Linux process has by default, and 32 GiB of address space
+     */
+    static constexpr size_t MAX_LIVE_THREADS = 4096;
+
+    struct GreenThread {
+        size_t index = 0;
+        std::function<void()> task;
+        Arena arena;
+        Arena* activeArena = &arena;
+        std::exception_ptr error;
+        bool started = false;
+        bool finished = false;
+#ifdef __linux__
+        void* stack = nullptr;
+        ucontext_t context;
+        ucontext_t* resumer = nullptr;
+#endif
+        ~GreenThread();
+    };
+
+    struct Worker {
+        std::mutex lock;
+        std::deque<GreenThread*> queue;
+#ifdef __linux__
+        ucontext_t context;
+#endif
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::unique_ptr<GreenThread>> threads;
+    std::vector<std::exception_ptr> errors;
+
+    std::vector<GreenThread*> pending;
+    std::atomic<size_t> nextPending;
+    std::atomic<size_t> live;
+
+    std::mutex stackLock;
+    std::vector<void*> freeStacks;
+
+    std::atomic<size_t> remaining;
+    std::atomic<size_t> switches;
+    std::atomic<size_t> steals;
+
+    std::mutex idleLock;
+    std::condition_variable idle;
+
+    static thread_local GreenThread* running;
+
+    GreenThread* startNext();
+    GreenThread* take(size_t index);
+    void work(size_t index);
+    void resume(Worker& worker, GreenThread& thread);
+    void finish(GreenThread& thread);
+
+    bool allocateStack(GreenThread& thread);
+
+    static void start();
+
+public:
+    explicit Scheduler(size_t workerCount);
+
+    ~Scheduler();
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    void spawn(std::function<void()> task);
+
+    void run();
+
+    std::exception_ptr error(size_t task) const;
+
+    Stats getStats() const;
+
+    static void yield();
+};
+
+#endif // SCHEDULER_H
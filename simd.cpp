@@ -0,0 +1,235 @@
+/**
+ * Implementation of the column operations
+ *
+ * Include for std::numeric_limits used for the int range
+ *
+ * Include for the x86 intrinsics when they are available
+ */
+#include "simd.h"
+#include <limits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace simd {
+
+static const int64_t INT_MIN_64 = std::numeric_limits<int>::min();
+static const int64_t INT_MAX_64 = std::numeric_limits<int>::max();
+
+/**
+ * Instruction sets supported by the kernels
+ */
+enum class Level {
+    SCALAR,
+    SSE42,
+    AVX2
+};
+
+/**
+ * Detects once the best instruction set of the processor
+ */
+static Level level() {
+#ifdef SIMD_X86
+    static const Level detected = __builtin_cpu_supports("avx2") ? Level::AVX2
+                                : __builtin_cpu_supports("sse4.2") ? Level::SSE42
+                                : Level::SCALAR;
+    return detected;
+#else
+    return Level::SCALAR;
+#endif
+}
+
+const char* instructionSet() {
+    switch (level()) {
+        case Level::AVX2: return "avx2";
+        case Level::SSE42: return "sse4.2";
+        case Level::SCALAR: return "scalar";
+    }
+    return "scalar";
+}
+
+// ================= SCALAR =================
+
+static void addScalar(const int64_t* a, const int64_t* b, int64_t* out, size_t from, size_t n) {
+    for (size_t i = from; i < n; i++) out[i] = a[i] + b[i];
+}
+
+static void subtractScalar(const int64_t* a, const int64_t* b, int64_t* out, size_t from, size_t n) {
+    for (size_t i = from; i < n; i++) out[i] = a[i] - b[i];
+}
+
+static void multiplyScalar(const int64_t* a, const int64_t* b, int64_t* out, size_t from, size_t n) {
+    for (size_t i = from; i < n; i++) out[i] = a[i] * b[i];
+}
+
+static size_t rangeScalar(const int64_t* a, size_t from, size_t n) {
+    for (size_t i = from; i < n; i++) {
+        if (a[i] < INT_MIN_64 || a[i] > INT_MAX_64) return i;
+    }
+    return n;
+}
+
+#ifdef SIMD_X86
+
+// ================= AVX2 =================
+
+/**
+ * _mm256_mul_epi32 multiplies the low signed 32 bits of each 64-bit lane,
+ * which is exact because the inputs fit in an int
+ */
+__attribute__((target("avx2")))
+static size_t addAvx2(const int64_t* a, const int64_t* b, int64_t* out, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_add_epi64(x, y));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t subtractAvx2(const int64_t* a, const int64_t* b, int64_t* out, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_sub_epi64(x, y));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t multiplyAvx2(const int64_t* a, const int64_t* b, int64_t* out, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_mul_epi32(x, y));
+    }
+    return i;
+}
+
+/**
+ * Returns true and the position of the first value out of range, otherwise false and the number of checked values
+ */
+__attribute__((target("avx2")))
+static bool rangeAvx2(const int64_t* a, size_t n, size_t& pos) {
+    const __m256i low = _mm256_set1_epi64x(INT_MIN_64);
+    const __m256i high = _mm256_set1_epi64x(INT_MAX_64);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i bad = _mm256_or_si256(_mm256_cmpgt_epi64(low, x), _mm256_cmpgt_epi64(x, high));
+        if (!_mm256_testz_si256(bad, bad)) {
+            pos = rangeScalar(a, i, i + 4);
+            return true;
+        }
+    }
+    pos = i;
+    return false;
+}
+
+// ================= SSE4.2 =================
+
+__attribute__((target("sse4.2")))
+static size_t addSse(const int64_t* a, const int64_t* b, int64_t* out, size_t n) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_add_epi64(x, y));
+    }
+    return i;
+}
+
+__attribute__((target("sse4.2")))
+static size_t subtractSse(const int64_t* a, const int64_t* b, int64_t* out, size_t n) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_sub_epi64(x, y));
+    }
+    return i;
+}
+
+__attribute__((target("sse4.2")))
+static size_t multiplySse(const int64_t* a, const int64_t* b, int64_t* out, size_t n) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_mul_epi32(x, y));
+    }
+    return i;
+}
+
+__attribute__((target("sse4.2")))
+static bool rangeSse(const int64_t* a, size_t n, size_t& pos) {
+    const __m128i low = _mm_set1_epi64x(INT_MIN_64);
+    const __m128i high = _mm_set1_epi64x(INT_MAX_64);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i bad = _mm_or_si128(_mm_cmpgt_epi64(low, x), _mm_cmpgt_epi64(x, high));
+        if (!_mm_testz_si128(bad, bad)) {
+            pos = rangeScalar(a, i, i + 2);
+            return true;
+        }
+    }
+    pos = i;
+    return false;
+}
+
+#endif
+
+// ================= DISPATCH =================
+
+/**
+ * Each operation runs the vector loop for the widest supported instruction set
+ * and finishes the remaining elements with the scalar loop
+ */
+void add(const int64_t* a, const int64_t* b, int64_t* out, size_t n) {
+    size_t done = 0;
+#ifdef SIMD_X86
+    if (level() == Level::AVX2) done = addAvx2(a, b, out, n);
+    else if (level() == Level::SSE42) done = addSse(a, b, out, n);
+#endif
+    addScalar(a, b, out, done, n);
+}
+
+void subtract(const int64_t* a, const int64_t* b, int64_t* out, size_t n) {
+    size_t done = 0;
+#ifdef SIMD_X86
+    if (level() == Level::AVX2) done = subtractAvx2(a, b, out, n);
+    else if (level() == Level::SSE42) done = subtractSse(a, b, out, n);
+#endif
+    subtractScalar(a, b, out, done, n);
+}
+
+void multiply(const int64_t* a, const int64_t* b, int64_t* out, size_t n) {
+    size_t done = 0;
+#ifdef SIMD_X86
+    if (level() == Level::AVX2) done = multiplyAvx2(a, b, out, n);
+    else if (level() == Level::SSE42) done = multiplySse(a, b, out, n);
+#endif
+    multiplyScalar(a, b, out, done, n);
+}
+
+void negate(const int64_t* a, int64_t* out, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = -a[i];
+}
+
+size_t firstOutOfIntRange(const int64_t* a, size_t n) {
+    size_t done = 0;
+#ifdef SIMD_X86
+    if (level() == Level::AVX2 && rangeAvx2(a, n, done)) return done;
+    if (level() == Level::SSE42 && rangeSse(a, n, done)) return done;
+#endif
+    return rangeScalar(a, done, n);
+}
+
+}
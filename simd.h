@@ -0,0 +1,46 @@
+/**
+ * Guard Headers
+ */
+#ifndef SIMD_H
+#define SIMD_H
+
+/**
+ * Include for int64_t used by the columns
+ *
+ * Include for size_t used for the lengths
+ */
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Element-wise operations on columns of integers used by the vectorized loops
+ *
+ * The values are stored as int64_t but every input must fit in an int, so additions,
+ * subtractions and multiplications are always exact and the caller can detect overflows with firstOutOfIntRange
+ *
+ * Each function uses AVX2 or SSE4.2 when the processor supports them, the last elements
+ * (and processors without those extensions) use plain scalar code
+ */
+namespace simd {
+
+void add(const int64_t* a, const int64_t* b, int64_t* out, size_t n);
+
+void subtract(const int64_t* a, const int64_t* b, int64_t* out, size_t n);
+
+void multiply(const int64_t* a, const int64_t* b, int64_t* out, size_t n);
+
+void negate(const int64_t* a, int64_t* out, size_t n);
+
+/**
+ * Returns the index of the first value that does not fit in an int, or n if all of them fit
+ */
+size_t firstOutOfIntRange(const int64_t* a, size_t n);
+
+/**
+ * Name of the instruction set selected at runtime ("avx2", "sse4.2" or "scalar")
+ */
+const char* instructionSet();
+
+}
+
+#endif // SIMD_H
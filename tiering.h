@@ -0,0 +1,96 @@
+/**
+ * Guard Headers
+ */
+#ifndef TIERING_H
+#define TIERING_H
+
+/**
+ * Include for CompiledLoop, the code of tier 1
+ *
+ * Include for std::unique_ptr used to own the compiled loops
+ *
+ * Include for size_t used for the counters
+ */
+#include "compiler.h"
+#include <memory>
+#include <cstddef>
+
+/**
+ * Execution tiers of a loop
+ *
+ * TIER0: the tree walker, every loop starts here
+ *
+ * TIER1: the loop compiled into closures (CompiledLoop)
+ *
+ * TIER2: the vectorized LoopKernel, only for the loops it recognizes
+ */
+enum Tier {
+    TIER0,
+    TIER1,
+    TIER2,
+    TIER_COUNT
+};
+
+/**
+ * Number of back-edges after which a loop is promoted (--tier1-threshold=N, --tier2-threshold=N)
+ *
+ * The counter adds up the iterations of all the executions of the loop; it is checked when the loop
+ * is entered and, while it runs in the tree walker, at the back-edge that reaches a threshold
+ * (on-stack replacement)
+ *
+ * trace: iterations of a compiled loop before the path through its body is recorded, and times a side exit
+ * is taken before the path through its branch is recorded (--trace-threshold=N)
+ */
+struct TierThresholds {
+    size_t tier1 = 1000;
+    size_t tier2 = 0;
+    size_t trace = 100;
+};
+
+/**
+ * Counters reported with --stats
+ *
+ * iterations: loop iterations executed by each tier
+ *
+ * compiledLoops: loops compiled to tier 1
+ *
+ * replacements: promotions of a loop while it was running (on-stack replacement)
+ *
+ * deoptimizations: compiled loops that failed a guard and went back to the tree walker
+ *
+ * hoistedChecks: entries of counted loops that ran the version without bounds checks
+ *
+ * traces, sideTraces: paths recorded and compiled, sideTraces counts those recorded at a side exit
+ *
+ * sideExits: times a trace left its path at an if statement
+ */
+struct TierStats {
+    size_t iterations[TIER_COUNT] = {0, 0, 0};
+    size_t compiledLoops = 0;
+    size_t replacements = 0;
+    size_t deoptimizations = 0;
+    size_t hoistedChecks = 0;
+    size_t traces = 0;
+    size_t sideTraces = 0;
+    size_t sideExits = 0;
+};
+
+/**
+ * What the tiering knows about a loop
+ *
+ * backEdges: its hotness
+ *
+ * nextPromotion: back-edge at which the running loop tries again to move to a higher tier
+ *
+ * feedback: where the speculation of its compiled versions failed
+ *
+ * compiled: its code in tier 1, once promoted
+ */
+struct LoopProfile {
+    size_t backEdges = 0;
+    size_t nextPromotion = 0;
+    TypeFeedback feedback;
+    std::unique_ptr<CompiledLoop> compiled;
+};
+
+#endif // TIERING_H
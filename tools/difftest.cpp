@@ -0,0 +1,795 @@
+/**
+ * Differential testing of the execution engines
+ *
+ * Runs every program with the reference configuration (--opt-level=0, only the tree walker) and with every
+ * optimized configuration, and reports the programs whose standard output, standard error or exit code differ
+ *
+ * Usage:
+ *
+ *     difftest [--interpreter=PATH] [--timeout=SECONDS] FILE...
+ *     difftest [--interpreter=PATH] [--timeout=SECONDS] --fuzz=N [--seed=S] [--failures=DIR]
+ *
+ * With --fuzz the programs are generated at random following the grammar of the Parser; a program that
+ * diverges is minimized (statements are removed while it still diverges) and written to the failures directory
+ *
+ * The exit code is 0 when every engine agrees, 1 when there are divergences, 2 for a wrong command line
+ *
+ * Include for std::cout and std::cerr used for the report
+ *
+ * Include for std::ifstream and std::ofstream used for programs and captured outputs
+ *
+ * Include for std::stringstream used to read whole files
+ *
+ * Include for std::string and std::vector used for programs, arguments and results
+ *
+ * Include for std::mt19937 used by the program generator
+ *
+ * Include for std::filesystem used for the temporary and failures directories
+ *
+ * Include for std::chrono and std::this_thread used for the timeout
+ *
+ * Include for the POSIX primitives used to run the interpreter (fork, execv, waitpid, kill)
+ */
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <filesystem>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+/**
+ * A way of running the interpreter
+ *
+ * outputFile: the print statements go to a file (--output=FILE), which is compared as standard output
+ *
+ * profiled: the program is run twice with the same --profile file, the second run is compared
+ *
+ * checkpointed: the program is run with --checkpoint-every=1 and, if it wrote a checkpoint, run again from it
+ * with --resume on the same output file, the resumed run is compared
+ */
+struct Engine {
+    std::string name;
+    std::vector<std::string> flags;
+    bool outputFile = false;
+    bool profiled = false;
+    bool checkpointed = false;
+};
+
+/**
+ * The first engine is the reference, the others cover every tier, the traces, the on-stack replacement, the output paths
+ * the green threads of a batch (preempted every few iterations) and the resume from a checkpoint
+ */
+static const std::vector<Engine> ENGINES = {
+    {"reference", {"--opt-level=0"}},
+    {"default", {}},
+    {"tier1-eager", {"--tier1-threshold=0"}},
+    {"tier1-osr", {"--tier1-threshold=3"}},
+    {"closures-only", {"--tier1-threshold=0", "--tier2-threshold=1000000000"}},
+    {"kernels-late", {"--tier2-threshold=5"}},
+    {"traces-eager", {"--tier1-threshold=0", "--trace-threshold=0"}},
+    {"traces-late", {"--tier1-threshold=3", "--trace-threshold=4"}},
+    {"profiled", {"--tier1-threshold=3"}, false, true},
+    {"async-output", {"--async-output"}},
+    {"green-thread", {"--threads=2", "--quantum=3", "--tier1-threshold=3"}},
+    {"file-output", {}, true},
+    {"checkpointed", {}, true, false, true},
+};
+
+/**
+ * What a run produced, timedOut is set when the interpreter was stopped by the timeout
+ */
+struct Outcome {
+    std::string out;
+    std::string err;
+    int exitCode = 0;
+    bool timedOut = false;
+
+    bool operator==(const Outcome& other) const {
+        return out == other.out && err == other.err && exitCode == other.exitCode && timedOut == other.timedOut;
+    }
+};
+
+static std::string readAll(const fs::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+static void writeAll(const fs::path& path, const std::string& text) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << text;
+}
+
+/**
+ * Runs the interpreter with the given arguments, standard output and error are captured in files
+ *
+ * The interpreter runs in its own process group, which is killed at the timeout together with any process
+ * it started (the interpreter can be a script that wraps the real one)
+ */
+class Runner {
+private:
+    std::string interpreter;
+    unsigned timeout;
+    fs::path workDir;
+
+    Outcome execute(const std::vector<std::string>& arguments);
+
+public:
+    Runner(const std::string& interpreterPath, unsigned seconds, const fs::path& directory)
+        : interpreter(interpreterPath), timeout(seconds), workDir(directory) {}
+
+    Outcome run(const Engine& engine, const fs::path& program);
+};
+
+Outcome Runner::execute(const std::vector<std::string>& arguments) {
+    fs::path outPath = workDir / "stdout";
+    fs::path errPath = workDir / "stderr";
+    Outcome outcome;
+
+#ifdef _WIN32
+    std::string command = "\"\"" + interpreter + "\"";
+    for (const auto& argument : arguments) {
+        command += " \"" + argument + "\"";
+    }
+    command += " > \"" + outPath.string() + "\" 2> \"" + errPath.string() + "\"\"";
+    outcome.exitCode = std::system(command.c_str());
+#else
+    pid_t child = fork();
+    if (child < 0) {
+        throw std::runtime_error("Cannot start the interpreter");
+    }
+    if (child == 0) {
+        int out = ::open(outPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        int err = ::open(errPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out < 0 || err < 0) _exit(127);
+        dup2(out, STDOUT_FILENO);
+        dup2(err, STDERR_FILENO);
+
+        std::vector<char*> argv;
+        argv.push_back(const_cast<char*>(interpreter.c_str()));
+        for (const auto& argument : arguments) {
+            argv.push_back(const_cast<char*>(argument.c_str()));
+        }
+        argv.push_back(nullptr);
+
+        setpgid(0, 0);
+        execv(interpreter.c_str(), argv.data());
+        _exit(127);
+    }
+    setpgid(child, child);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(timeout);
+    int status = 0;
+    while (waitpid(child, &status, WNOHANG) == 0) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            kill(-child, SIGKILL);
+            waitpid(child, &status, 0);
+            outcome.timedOut = true;
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (WIFEXITED(status)) {
+        outcome.exitCode = WEXITSTATUS(status);
+    } else if (WIFSIGNALED(status)) {
+        outcome.exitCode = 128 + WTERMSIG(status);
+    }
+#endif
+
+    outcome.out = readAll(outPath);
+    outcome.err = readAll(errPath);
+    return outcome;
+}
+
+Outcome Runner::run(const Engine& engine, const fs::path& program) {
+    std::vector<std::string> arguments = engine.flags;
+
+    fs::path outputPath = workDir / "output";
+    if (engine.outputFile) {
+        fs::remove(outputPath);
+        arguments.push_back("--output=" + outputPath.string());
+    }
+
+    fs::path profilePath = workDir / "profile";
+    if (engine.profiled) {
+        fs::remove(profilePath);
+        arguments.push_back("--profile=" + profilePath.string());
+    }
+
+    fs::path copyPath = workDir / "resumed.txt";
+    fs::path checkpointPath = workDir / "resumed.txt.checkpoint";
+    if (engine.checkpointed) {
+        fs::copy_file(program, copyPath, fs::copy_options::overwrite_existing);
+        fs::remove(checkpointPath);
+        arguments.push_back("--checkpoint-every=1");
+        arguments.push_back(copyPath.string());
+    } else {
+        arguments.push_back(program.string());
+    }
+
+    if (engine.profiled) {
+        Outcome first = execute(arguments);
+        if (first.timedOut) return first;
+    }
+    Outcome outcome = execute(arguments);
+
+    if (engine.checkpointed && !outcome.timedOut && fs::exists(checkpointPath)) {
+        arguments.insert(arguments.end() - 1, "--resume=" + checkpointPath.string());
+        outcome = execute(arguments);
+    }
+
+    if (engine.outputFile) {
+        outcome.out = readAll(outputPath) + outcome.out;
+    }
+    return outcome;
+}
+
+/**
+ * A difference between the reference and one engine
+ */
+struct Divergence {
+    const Engine* engine;
+    Outcome expected;
+    Outcome actual;
+};
+
+/**
+ * Runs the program on every engine, returns false if the reference itself timed out (nothing to compare)
+ *
+ * If only is not null, only that engine is compared with the reference (used while minimizing)
+ */
+static bool compareEngines(Runner& runner, const fs::path& program, std::vector<Divergence>& divergences,
+                           const Engine* only = nullptr, Outcome* reference = nullptr) {
+    Outcome expected = runner.run(ENGINES[0], program);
+    if (reference) *reference = expected;
+    if (expected.timedOut) return false;
+
+    for (size_t i = 1; i < ENGINES.size(); i++) {
+        if (only && only != &ENGINES[i]) continue;
+        Outcome actual = runner.run(ENGINES[i], program);
+        if (!(actual == expected)) {
+            divergences.push_back({&ENGINES[i], expected, actual});
+        }
+    }
+    return true;
+}
+
+/**
+ * Text of an output for the report, long outputs are cut
+ */
+static std::string excerpt(const std::string& text) {
+    const size_t LIMIT = 400;
+    if (text.size() <= LIMIT) return text;
+    return text.substr(0, LIMIT) + "... (" + std::to_string(text.size()) + " bytes)";
+}
+
+static void printOutcome(const char* label, const Outcome& outcome) {
+    std::cout << "  " << label << ": exit " << outcome.exitCode << (outcome.timedOut ? " (timeout)" : "") << "\n";
+    std::cout << "    stdout: " << excerpt(outcome.out) << "\n";
+    std::cout << "    stderr: " << excerpt(outcome.err) << "\n";
+}
+
+static void report(const std::string& program, const Divergence& divergence) {
+    std::cout << "DIVERGENCE " << program << " [" << divergence.engine->name;
+    for (const auto& flag : divergence.engine->flags) std::cout << " " << flag;
+    std::cout << "]\n";
+    printOutcome("expected", divergence.expected);
+    printOutcome("actual", divergence.actual);
+}
+
+/**
+ * Random programs that follow the grammar of the Parser
+ *
+ * Every loop has its own counter, incremented as first statement of the body and never assigned elsewhere,
+ * so every program terminates; counted loops increment it as last statement instead, and have no continue.
+ * Integer assignments keep the values below 1000 (x = e - e // 1000 * 1000) and * only multiplies by a digit,
+ * so the programs do not reach signed overflow, whose result is not defined
+ *
+ * Lists are never empty and indexes are reduced modulo their length (the rows and columns of the 3 x 4 matrix g
+ * use counters and literals), a counted loop reads its own list below its length, so most programs run to the end;
+ * about one program in four mixes types on purpose (a boolean in an integer variable, an index out of range,
+ * a missing key, a division by zero), so the guards, the deoptimizations and the error messages are exercised too
+ */
+class Generator {
+private:
+    std::mt19937 random;
+    std::string text;
+    std::vector<std::string> counters;
+    int loops = 0;
+    bool mixTypes = false;
+    std::string countedCounter;
+    std::string countedList;
+
+    static constexpr int MAX_DEPTH = 3;
+    static constexpr int MAX_LOOPS = 6;
+
+    bool chance(int percent) {
+        return static_cast<int>(random() % 100) < percent;
+    }
+
+    int pick(int count) {
+        return static_cast<int>(random() % count);
+    }
+
+    std::string integerVariable() {
+        static const char* names[] = {"a", "b", "c", "d"};
+        return names[pick(4)];
+    }
+
+    std::string listVariable() {
+        return chance(70) ? "v" : "w";
+    }
+
+    std::string literal() {
+        return std::to_string(chance(85) ? pick(10) : pick(100));
+    }
+
+    std::string counter() {
+        return counters[pick(static_cast<int>(counters.size()))];
+    }
+
+    std::string index(const std::string& list) {
+        if (mixTypes && chance(10)) return integerExpression(1);
+        if (chance(30)) return "0";
+        std::string value = !counters.empty() && chance(60) ? counter() : integerVariable();
+        return value + " - " + value + " // len(" + list + ") * len(" + list + ")";
+    }
+
+    std::string element() {
+        std::string list = listVariable();
+        return list + "[" + index(list) + "]";
+    }
+
+    /**
+     * Element of the list of the counted loop at the counter minus 0, 1 or 2: the counter starts from 2 and stays
+     * below the length of the list, unless the program mixes types, then the index can also go one past it
+     */
+    std::string counterElement() {
+        std::string index = countedCounter;
+        int offset = mixTypes && chance(20) ? 1 : -pick(3);
+        if (offset > 0) index += " + " + std::to_string(offset);
+        if (offset < 0) index += " - " + std::to_string(-offset);
+        return countedList + "[" + index + "]";
+    }
+
+    std::string cell() {
+        if (mixTypes && chance(10)) return "g[" + std::to_string(pick(5)) + "][" + integerExpression(1) + "]";
+        std::string row = !counters.empty() && chance(60) ? counter() : std::to_string(pick(3));
+        std::string column = !counters.empty() && chance(40) ? counter() : std::to_string(pick(4));
+        return "g[" + row + " - " + row + " // 3 * 3][" + column + " - " + column + " // 4 * 4]";
+    }
+
+    std::string key() {
+        if (mixTypes && chance(10)) return std::to_string(6 + pick(4));
+        return std::to_string(pick(6));
+    }
+
+    std::string integerAtom() {
+        if (!countedCounter.empty() && chance(40)) return counterElement();
+        int choice = pick(100);
+        if (choice < 25) return literal();
+        if (choice < 55) return integerVariable();
+        if (choice < 65 && !counters.empty()) return counter();
+        if (choice < 75) return "len(" + listVariable() + ")";
+        if (choice < 82) return element();
+        if (choice < 90 || !mixTypes) return cell();
+        if (choice < 96) return "m[" + key() + "]";
+        return chance(50) ? "True" : "v";
+    }
+
+    std::string integerExpression(int depth) {
+        if (depth <= 0 || chance(30)) return integerAtom();
+
+        std::string left = integerExpression(depth - 1);
+        switch (pick(6)) {
+            case 0: return left + " + " + integerExpression(depth - 1);
+            case 1: return left + " - " + integerExpression(depth - 1);
+            case 2: return "(" + left + ") * " + std::to_string(1 + pick(9));
+            case 3:
+                if (mixTypes && chance(20)) return "(" + left + ") // (" + integerExpression(depth - 1) + ")";
+                return "(" + left + ") // " + std::to_string(1 + pick(9));
+            case 4: return "-" + integerAtom();
+            default: return "(" + left + ")";
+        }
+    }
+
+    std::string bounded() {
+        std::string expression = integerExpression(2);
+        return expression + " - (" + expression + ") // 1000 * 1000";
+    }
+
+    std::string condition(int depth) {
+        static const char* comparisons[] = {" < ", " <= ", " > ", " >= ", " == ", " != "};
+        if (depth <= 0 || chance(40)) {
+            int choice = pick(100);
+            if (choice < 70) return integerExpression(1) + comparisons[pick(6)] + integerExpression(1);
+            if (choice < 80) return chance(50) ? "True" : "False";
+            if (choice < 90) return integerAtom() + " in " + listVariable();
+            return integerAtom() + " in m";
+        }
+        switch (pick(4)) {
+            case 0: return "not (" + condition(depth - 1) + ")";
+            case 1: return condition(depth - 1) + " and " + condition(depth - 1);
+            case 2: return condition(depth - 1) + " or " + condition(depth - 1);
+            default: return "(" + condition(depth - 1) + ")";
+        }
+    }
+
+    void line(int indent, const std::string& content) {
+        text += std::string(indent * 4, ' ') + content + "\n";
+    }
+
+    void simpleStatement(int indent) {
+        int choice = pick(100);
+        if (choice < 30) {
+            line(indent, integerVariable() + " = " + bounded());
+        } else if (choice < 34) {
+            line(indent, integerVariable() + " = " + (mixTypes ? condition(1) : bounded()));
+        } else if (choice < 40) {
+            line(indent, element() + " = " + bounded());
+        } else if (choice < 46) {
+            line(indent, cell() + " = " + (mixTypes && chance(10) ? condition(1) : bounded()));
+        } else if (choice < 58) {
+            line(indent, listVariable() + ".append(" + bounded() + ")");
+        } else if (choice < 60) {
+            line(indent, "w = list()");
+            line(indent, "w.append(" + literal() + ")");
+        } else if (choice < 68) {
+            line(indent, "m[" + (!counters.empty() && chance(30) ? counter() : key()) + "] = " + bounded());
+        } else if (choice < 76) {
+            std::string first = integerVariable();
+            std::string second = integerVariable();
+            line(indent, first + ", " + second + " = " + bounded() + ", " + bounded());
+        } else if (choice < 78) {
+            line(indent, cell() + ", " + cell() + " = " + integerAtom() + ", " + integerAtom());
+        } else if (choice < 80) {
+            std::string list = listVariable();
+            line(indent, list + "[" + index(list) + "], " + list + "[" + index(list) + "] = " + integerAtom() + ", " +
+                 integerAtom());
+        } else {
+            int what = pick(10);
+            if (what < 6) {
+                line(indent, "print(" + integerExpression(2) + ")");
+            } else if (what < 8) {
+                line(indent, "print(" + condition(1) + ")");
+            } else if (what < 9) {
+                line(indent, "print(" + (chance(50) ? listVariable() : std::string("g")) + ")");
+            } else {
+                line(indent, "print(m)");
+            }
+        }
+    }
+
+    /**
+     * Body of a counted loop: reads and writes at the counter plus an offset, no appends, break or continue,
+     * so the loop can run the version whose bounds are checked on entry
+     */
+    void countedStatement(int indent) {
+        int choice = pick(100);
+        if (choice < 40) {
+            line(indent, integerVariable() + " = " + bounded());
+        } else if (choice < 70) {
+            line(indent, counterElement() + " = " + bounded());
+        } else if (choice < 85) {
+            line(indent, "if " + condition(1) + ":");
+            line(indent + 1, integerVariable() + " = " + bounded());
+        } else {
+            line(indent, "print(" + integerExpression(2) + ")");
+        }
+    }
+
+    void countedLoop(int indent) {
+        std::string name = "i" + std::to_string(++loops);
+        std::string list = listVariable();
+        line(indent, name + " = " + std::to_string(2 + pick(2)));
+        if (!mixTypes || chance(50)) {
+            line(indent, "while " + name + " < len(" + list + "):");
+        } else {
+            line(indent, "while " + name + (chance(50) ? " < " : " <= ") + std::to_string(pick(8)) + ":");
+        }
+        countedCounter = name;
+        countedList = list;
+        int count = 1 + pick(3);
+        for (int i = 0; i < count; i++) countedStatement(indent + 1);
+        countedCounter.clear();
+        line(indent + 1, name + " = " + name + " + 1");
+    }
+
+    /**
+     * Loop whose if statement changes branch with the counter, so the traces leave their path and side traces
+     * are recorded; the branches can hold more if statements
+     */
+    void branchyLoop(int indent, int depth) {
+        std::string name = "i" + std::to_string(++loops);
+        std::string period = std::to_string(2 + pick(4));
+        line(indent, name + " = 0");
+        line(indent, "while " + name + " < " + std::to_string(8 + pick(40)) + ":");
+        line(indent + 1, name + " = " + name + " + 1");
+        counters.push_back(name);
+        line(indent + 1, "if " + name + " - " + name + " // " + period + " * " + period + " == 0:");
+        block(indent + 2, depth + 1, 1 + pick(3));
+        if (chance(50)) {
+            line(indent + 1, "elif " + name + " > " + std::to_string(pick(30)) + ":");
+            block(indent + 2, depth + 1, 1 + pick(2));
+        }
+        line(indent + 1, "else:");
+        block(indent + 2, depth + 1, 1 + pick(2));
+        block(indent + 1, depth + 1, pick(3));
+        counters.pop_back();
+    }
+
+    void block(int indent, int depth, int count) {
+        for (int i = 0; i < count; i++) {
+            statement(indent, depth);
+        }
+    }
+
+    void statement(int indent, int depth) {
+        int choice = pick(100);
+        if (depth < MAX_DEPTH && choice < 15) {
+            line(indent, "if " + condition(2) + ":");
+            block(indent + 1, depth + 1, 1 + pick(3));
+            int elifs = pick(3);
+            for (int i = 0; i < elifs; i++) {
+                line(indent, "elif " + condition(2) + ":");
+                block(indent + 1, depth + 1, 1 + pick(2));
+            }
+            if (chance(50)) {
+                line(indent, "else:");
+                block(indent + 1, depth + 1, 1 + pick(2));
+            }
+        } else if (depth < MAX_DEPTH && loops < MAX_LOOPS && choice < 30) {
+            std::string name = "i" + std::to_string(++loops);
+            int bound = depth == 0 ? pick(60) : pick(12);
+            line(indent, name + " = 0");
+            std::string header = "while " + name + " < " + std::to_string(bound);
+            if (chance(25)) header += " and (" + condition(1) + ")";
+            line(indent, header + ":");
+            line(indent + 1, name + " = " + name + " + 1");
+            counters.push_back(name);
+            block(indent + 1, depth + 1, 1 + pick(4));
+            counters.pop_back();
+        } else if (depth < MAX_DEPTH && loops < MAX_LOOPS && choice < 40) {
+            countedLoop(indent);
+        } else if (depth < MAX_DEPTH && loops < MAX_LOOPS && choice < 46) {
+            branchyLoop(indent, depth);
+        } else if (!counters.empty() && choice < 52) {
+            line(indent, "if " + condition(1) + ":");
+            line(indent + 1, chance(50) ? "break" : "continue");
+        } else {
+            simpleStatement(indent);
+        }
+    }
+
+public:
+    explicit Generator(unsigned seed) : random(seed) {}
+
+    std::string program() {
+        text.clear();
+        counters.clear();
+        loops = 0;
+        mixTypes = chance(25);
+
+        line(0, "a = " + literal());
+        line(0, "b = " + literal());
+        line(0, "c = " + literal());
+        line(0, "d = " + literal());
+        line(0, "v = list()");
+        for (int i = 0; i < 3; i++) line(0, "v.append(" + literal() + ")");
+        line(0, "w = list()");
+        line(0, "w.append(" + literal() + ")");
+        line(0, "m = dict()");
+        for (int i = 0; i < 6; i++) line(0, "m[" + std::to_string(i) + "] = " + literal());
+        line(0, "g = matrix(3, 4)");
+
+        block(0, 0, 4 + pick(10));
+        line(0, "print(a + b + c + d)");
+        line(0, "print(v)");
+        line(0, "print(g)");
+        return text;
+    }
+};
+
+static std::vector<std::string> splitLines(const std::string& text) {
+    std::vector<std::string> lines;
+    std::istringstream stream(text);
+    std::string line;
+    while (std::getline(stream, line)) lines.push_back(line);
+    return lines;
+}
+
+static std::string joinLines(const std::vector<std::string>& lines) {
+    std::string text;
+    for (const auto& line : lines) text += line + "\n";
+    return text;
+}
+
+static size_t indentation(const std::string& line) {
+    return line.find_first_not_of(' ') == std::string::npos ? line.size() : line.find_first_not_of(' ');
+}
+
+/**
+ * Index after the last line of the statement starting at first (its nested block included)
+ */
+static size_t statementEnd(const std::vector<std::string>& lines, size_t first) {
+    size_t end = first + 1;
+    while (end < lines.size() && indentation(lines[end]) > indentation(lines[first])) end++;
+    return end;
+}
+
+/**
+ * True for the increment of a loop counter of the Generator (iN = iN + 1), without it the loop would not end
+ */
+static bool isCounterIncrement(const std::string& line) {
+    std::istringstream words(line);
+    std::string target, assign, source, plus, one;
+    if (!(words >> target >> assign >> source >> plus >> one) || !words.eof()) return false;
+    return target.size() > 1 && target[0] == 'i' && target.find_first_not_of("0123456789", 1) == std::string::npos &&
+           assign == "=" && source == target && plus == "+" && one == "1";
+}
+
+/**
+ * Removes statements, and replaces compound statements with their body, while the engine still diverges
+ *
+ * The reference must keep its standard error, so the program is not reduced to a different error (a parse error);
+ * loop counter increments are kept, a whole loop is removed instead
+ */
+static std::string minimize(Runner& runner, const fs::path& program, const std::string& text,
+                            const Divergence& divergence) {
+    auto stillDiverges = [&](const std::vector<std::string>& candidate) {
+        writeAll(program, joinLines(candidate));
+        std::vector<Divergence> divergences;
+        Outcome reference;
+        return compareEngines(runner, program, divergences, divergence.engine, &reference) &&
+               !divergences.empty() && reference.err == divergence.expected.err;
+    };
+
+    std::vector<std::string> lines = splitLines(text);
+    bool reduced = true;
+    while (reduced) {
+        reduced = false;
+        for (size_t first = 0; first < lines.size(); first++) {
+            size_t end = statementEnd(lines, first);
+            if (isCounterIncrement(lines[first])) continue;
+
+            std::vector<std::string> candidate(lines.begin(), lines.begin() + first);
+            candidate.insert(candidate.end(), lines.begin() + end, lines.end());
+            if (stillDiverges(candidate)) {
+                lines = candidate;
+                reduced = true;
+                first--;
+                continue;
+            }
+
+            if (end > first + 1) {
+                candidate.assign(lines.begin(), lines.begin() + first);
+                size_t removed = indentation(lines[first + 1]) - indentation(lines[first]);
+                for (size_t i = first + 1; i < end; i++) candidate.push_back(lines[i].substr(removed));
+                candidate.insert(candidate.end(), lines.begin() + end, lines.end());
+                if (stillDiverges(candidate)) {
+                    lines = candidate;
+                    reduced = true;
+                }
+            }
+        }
+    }
+
+    writeAll(program, joinLines(lines));
+    return joinLines(lines);
+}
+
+/**
+ * Command line options, see the usage at the top of the file
+ */
+struct Options {
+    std::string interpreter = "./interpreter";
+    unsigned timeout = 10;
+    size_t fuzz = 0;
+    unsigned seed = 1;
+    std::string failures = "difftest-failures";
+    std::vector<std::string> files;
+};
+
+static bool parseOptions(int argc, char* argv[], Options& options) {
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg.rfind("--interpreter=", 0) == 0) {
+                options.interpreter = arg.substr(14);
+            } else if (arg.rfind("--timeout=", 0) == 0) {
+                options.timeout = static_cast<unsigned>(std::stoul(arg.substr(10)));
+            } else if (arg.rfind("--fuzz=", 0) == 0) {
+                options.fuzz = std::stoull(arg.substr(7));
+            } else if (arg.rfind("--seed=", 0) == 0) {
+                options.seed = static_cast<unsigned>(std::stoul(arg.substr(7)));
+            } else if (arg.rfind("--failures=", 0) == 0) {
+                options.failures = arg.substr(11);
+            } else if (arg.rfind("--", 0) == 0) {
+                return false;
+            } else {
+                options.files.push_back(arg);
+            }
+        }
+    } catch (const std::exception&) {
+        return false;
+    }
+    return options.timeout > 0 && (options.fuzz > 0 || !options.files.empty());
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [--interpreter=PATH] [--timeout=SECONDS]"
+                  << " (FILE... | --fuzz=N [--seed=S] [--failures=DIR])" << std::endl;
+        return 2;
+    }
+
+    fs::path workDir = fs::temp_directory_path() / ("difftest-" + std::to_string(options.seed) + "-" +
+                                                    std::to_string(std::random_device()()));
+    fs::create_directories(workDir);
+    Runner runner(options.interpreter, options.timeout, workDir);
+
+    size_t checked = 0;
+    size_t skipped = 0;
+    size_t diverging = 0;
+
+    for (const auto& file : options.files) {
+        std::vector<Divergence> divergences;
+        if (!compareEngines(runner, file, divergences)) {
+            std::cout << "TIMEOUT " << file << " (reference)\n";
+            skipped++;
+            continue;
+        }
+        checked++;
+        if (!divergences.empty()) diverging++;
+        for (const auto& divergence : divergences) report(file, divergence);
+    }
+
+    Generator generator(options.seed);
+    fs::path program = workDir / "program.txt";
+    for (size_t i = 0; i < options.fuzz; i++) {
+        std::string text = generator.program();
+        writeAll(program, text);
+
+        std::vector<Divergence> divergences;
+        if (!compareEngines(runner, program, divergences)) {
+            skipped++;
+            continue;
+        }
+        checked++;
+        if (divergences.empty()) continue;
+        diverging++;
+
+        const Engine* engine = divergences.front().engine;
+        std::string reduced = minimize(runner, program, text, divergences.front());
+        divergences.clear();
+        compareEngines(runner, program, divergences, engine);
+
+        fs::create_directories(options.failures);
+        fs::path saved = fs::path(options.failures) /
+                         ("seed" + std::to_string(options.seed) + "-" + std::to_string(i) + ".txt");
+        writeAll(saved, reduced);
+
+        for (const auto& divergence : divergences) report(saved.string(), divergence);
+        std::cout << reduced;
+    }
+
+    fs::remove_all(workDir);
+
+    std::cout << checked << " programs checked, " << diverging << " diverging, " << skipped << " skipped" << std::endl;
+    return diverging == 0 ? 0 : 1;
+}
@@ -0,0 +1,479 @@
+/**
+ * Performance fuzzer: looks for inputs whose cost grows faster than their size
+ *
+ * Every input family builds a program from a size n (nesting depth, number of statements, length of an expression);
+ * the family is measured at doubling sizes, separately for Lexer::tokenize, Parser::parseProgram and the execution,
+ * and a stage is flagged when its time grows with an exponent above the threshold with respect to the bytes
+ * of the input (1 is linear, 2 quadratic). Besides the fixed families, random families repeat a fragment of
+ * random statements, the fragment of a flagged random family is minimized by removing statements
+ *
+ * For every flagged stage the smallest program that still shows the growth is written to the corpus directory
+ * as <family>.<stage>.n<size>.txt; --replay measures the programs of a corpus and reports their cost per byte
+ *
+ * Usage:
+ *
+ *     perffuzz [--random=N] [--seed=S] [--corpus=DIR] [--threshold=E] [--opt-level=0|1]
+ *     perffuzz --replay=DIR [--budget=NANOSECONDS] [--opt-level=0|1]
+ *
+ * Everything runs in the process, without external services. The exit code is 1 when a stage is flagged
+ * (or, with --replay, exceeds the budget per byte), 2 for a wrong command line
+ *
+ * Build (from the root of the repository):
+ *
+ *     g++ -std=c++20 -O2 -pthread tools/perffuzz.cpp $(ls *.cpp | grep -v '^main.cpp$') -o perffuzz
+ *
+ * Include for the Lexer, the Parser and the Interpreter measured by the fuzzer
+ *
+ * Include for std::cout and std::cerr used for the report
+ *
+ * Include for std::ifstream and std::ofstream used for the corpus
+ *
+ * Include for std::string, std::vector and std::function used for the families
+ *
+ * Include for std::mt19937 used by the random families
+ *
+ * Include for std::min, std::max and std::sort
+ *
+ * Include for std::chrono used to measure the stages
+ *
+ * Include for std::log used to compute the growth exponents
+ *
+ * Include for std::filesystem used for the corpus directory
+ */
+#include "../lexer.h"
+#include "../parser.h"
+#include "../interpreter.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <random>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+/**
+ * Sink that drops the output, only the work of the interpreter is measured
+ */
+class DiscardSink : public OutputSink {
+public:
+    void write(const char*, size_t) override {}
+    void flush() override {}
+};
+
+enum Stage { LEX, PARSE, EXECUTE, STAGES };
+
+static const char* STAGE_NAMES[STAGES] = {"lexer", "parser", "executor"};
+
+/**
+ * Seconds spent by every stage on one input
+ */
+struct Cost {
+    double seconds[STAGES] = {0, 0, 0};
+};
+
+/**
+ * Runs the stages on the source, each stage is repeated and the fastest time is kept
+ *
+ * A stage that fails (error token, ParseError, RuntimeError) stops the following ones, their time stays 0
+ */
+static Cost measure(const std::string& source, int optimizationLevel, int repeats = 3) {
+    using Clock = std::chrono::steady_clock;
+    Cost cost;
+    for (int s = 0; s < STAGES; s++) cost.seconds[s] = 1e30;
+
+    for (int r = 0; r < repeats; r++) {
+        auto start = Clock::now();
+        Lexer lexer(source);
+        std::vector<Token> tokens = lexer.tokenize();
+        auto lexed = Clock::now();
+        cost.seconds[LEX] = std::min(cost.seconds[LEX], std::chrono::duration<double>(lexed - start).count());
+
+        bool valid = true;
+        for (const auto& token : tokens) {
+            if (token.type == TokenType::ERROR) valid = false;
+        }
+        if (!valid) {
+            cost.seconds[PARSE] = cost.seconds[EXECUTE] = 0;
+            continue;
+        }
+
+        std::unique_ptr<Program> program;
+        auto parseStart = Clock::now();
+        try {
+            Parser parser(std::move(tokens));
+            program = parser.parseProgram();
+        } catch (const ParseError&) {
+        }
+        auto parsed = Clock::now();
+        cost.seconds[PARSE] = std::min(cost.seconds[PARSE], std::chrono::duration<double>(parsed - parseStart).count());
+        if (!program) {
+            cost.seconds[EXECUTE] = 0;
+            continue;
+        }
+
+        DiscardSink sink;
+        Interpreter interpreter;
+        interpreter.setOutput(sink);
+        interpreter.setOptimizationLevel(optimizationLevel);
+        auto executeStart = Clock::now();
+        try {
+            interpreter.execute(*program);
+        } catch (const RuntimeError&) {
+        }
+        auto executed = Clock::now();
+        cost.seconds[EXECUTE] = std::min(cost.seconds[EXECUTE],
+                                         std::chrono::duration<double>(executed - executeStart).count());
+    }
+    return cost;
+}
+
+/**
+ * A family of inputs, build returns the program of size n
+ */
+struct Family {
+    std::string name;
+    std::function<std::string(size_t)> build;
+};
+
+static std::string repeat(const std::string& text, size_t count) {
+    std::string result;
+    result.reserve(text.size() * count);
+    for (size_t i = 0; i < count; i++) result += text;
+    return result;
+}
+
+static std::string indent(size_t depth) {
+    return std::string(depth * 2, ' ');
+}
+
+/**
+ * Families aimed at the known risks: deep nesting and DEDENT cascades in the Lexer, recursion and long chains
+ * in the Parser, reads of large lists and dictionaries in the executor
+ */
+static std::vector<Family> fixedFamilies() {
+    std::vector<Family> families;
+
+    families.push_back({"nested-if", [](size_t n) {
+        std::string text;
+        for (size_t i = 0; i < n; i++) text += indent(i) + "if True:\n";
+        text += indent(n) + "a = 1\n";
+        return text + "print(a)\n";
+    }});
+
+    families.push_back({"dedent-cascade", [](size_t n) {
+        std::string text = "a = 0\n";
+        for (size_t block = 0; block < 8; block++) {
+            for (size_t i = 0; i < n; i++) text += indent(i) + "if True:\n";
+            text += indent(n) + "a = a + 1\n";
+        }
+        return text + "print(a)\n";
+    }});
+
+    families.push_back({"nested-parentheses", [](size_t n) {
+        return "a = " + std::string(n, '(') + "1" + std::string(n, ')') + "\nprint(a)\n";
+    }});
+
+    families.push_back({"long-sum", [](size_t n) {
+        return "a = 1" + repeat(" + 1", n) + "\nprint(a)\n";
+    }});
+
+    families.push_back({"long-condition", [](size_t n) {
+        return "a = True" + repeat(" and True", n) + "\nprint(a)\n";
+    }});
+
+    families.push_back({"many-statements", [](size_t n) {
+        return "a = 0\n" + repeat("a = a + 1\n", n) + "print(a)\n";
+    }});
+
+    families.push_back({"elif-chain", [](size_t n) {
+        std::string text = "a = " + std::to_string(n) + "\nif a == 0:\n  b = 0\n";
+        for (size_t i = 1; i <= n; i++) text += "elif a == " + std::to_string(i) + ":\n  b = " + std::to_string(i) + "\n";
+        return text + "print(b)\n";
+    }});
+
+    families.push_back({"long-identifier", [](size_t n) {
+        std::string name = "a" + std::string(n, 'b');
+        return name + " = 1\n" + name + " = " + name + " + 1\nprint(" + name + ")\n";
+    }});
+
+    families.push_back({"list-length", [](size_t n) {
+        return "v = list()\n" + repeat("v.append(1)\n", n) + repeat("a = len(v)\n", n) + "print(a)\n";
+    }});
+
+    families.push_back({"dict-membership", [](size_t n) {
+        std::string text = "m = dict()\n";
+        for (size_t i = 0; i < n; i++) text += "m[" + std::to_string(i) + "] = 1\n";
+        return text + repeat("a = 2 in m\n", n) + "print(a)\n";
+    }});
+
+    families.push_back({"list-element", [](size_t n) {
+        return "v = list()\n" + repeat("v.append(1)\n", n) + repeat("a = v[0]\n", n) + "print(a)\n";
+    }});
+
+    families.push_back({"dict-inserts", [](size_t n) {
+        std::string text = "m = dict()\n";
+        for (size_t i = 0; i < n; i++) text += "m[" + std::to_string(i * 7919) + "] = 1\n";
+        return text + "print(m[0])\n";
+    }});
+
+    return families;
+}
+
+/**
+ * Statements of the random fragments, all of them terminate and keep the values small
+ *
+ * The prefix defines every variable used by the statements
+ */
+static const char* RANDOM_PREFIX = "a = 1\nb = 2\nv = list()\nv.append(1)\nw = list()\nm = dict()\nm[1] = 1\n";
+
+static const std::vector<std::string> RANDOM_STATEMENTS = {
+    "v.append(a)\n",
+    "w.append(b)\n",
+    "a = len(v)\n",
+    "b = len(w) - len(w) // 10 * 10\n",
+    "a = v[0]\n",
+    "b = a in v\n",
+    "b = a in m\n",
+    "m[a] = b\n",
+    "m[len(v)] = 1\n",
+    "w = v\n",
+    "a, b = b, a\n",
+    "a = a + 1 - a // 2\n",
+    "if a < b:\n  a = b\n",
+    "if True:\n  b = a\nelse:\n  a = b\n",
+    "print(a)\n",
+    "print(v[0])\n",
+};
+
+static Family randomFamily(std::mt19937& random, size_t index, std::vector<std::string>& fragment) {
+    fragment.clear();
+    size_t count = 1 + random() % 4;
+    for (size_t i = 0; i < count; i++) {
+        fragment.push_back(RANDOM_STATEMENTS[random() % RANDOM_STATEMENTS.size()]);
+    }
+    std::string body;
+    for (const auto& statement : fragment) body += statement;
+    return {"random" + std::to_string(index), [body](size_t n) { return RANDOM_PREFIX + repeat(body, n); }};
+}
+
+/**
+ * Result of the analysis of a family: the measured sizes and, for every stage, the growth exponent
+ * over the last two doublings where the stage was slow enough to be measured (the smaller of the two,
+ * a single slow measurement is not enough to flag a stage)
+ */
+struct Growth {
+    std::vector<size_t> sizes;
+    std::vector<size_t> bytes;
+    std::vector<Cost> costs;
+    double exponent[STAGES] = {0, 0, 0};
+};
+
+/**
+ * Limits of the measurement: the sizes double until the input reaches MAX_BYTES or a stage takes MAX_SECONDS,
+ * and a stage is considered only when it takes at least MIN_SECONDS (shorter times are mostly noise)
+ */
+static const size_t FIRST_SIZE = 64;
+static const size_t MAX_BYTES = 1024 * 1024;
+static const double MAX_SECONDS = 0.5;
+static const double MIN_SECONDS = 0.002;
+
+/**
+ * Growth exponent of the stage between the measurements i - 1 and i, negative if they are too short
+ */
+static double exponentAt(const Growth& growth, int stage, size_t i) {
+    double before = growth.costs[i - 1].seconds[stage];
+    double after = growth.costs[i].seconds[stage];
+    if (before < MIN_SECONDS || after < MIN_SECONDS) return -1;
+    return std::log(after / before) / std::log(static_cast<double>(growth.bytes[i]) / growth.bytes[i - 1]);
+}
+
+static Growth analyze(const Family& family, int optimizationLevel) {
+    Growth growth;
+    for (size_t n = FIRST_SIZE;; n *= 2) {
+        std::string source = family.build(n);
+        if (source.size() > MAX_BYTES) break;
+
+        Cost cost = measure(source, optimizationLevel);
+        growth.sizes.push_back(n);
+        growth.bytes.push_back(source.size());
+        growth.costs.push_back(cost);
+
+        double slowest = 0;
+        for (double seconds : cost.seconds) slowest = std::max(slowest, seconds);
+        if (slowest > MAX_SECONDS) break;
+    }
+
+    for (int s = 0; s < STAGES; s++) {
+        for (size_t i = growth.sizes.size(); i-- > 2;) {
+            double first = exponentAt(growth, s, i - 1);
+            double second = exponentAt(growth, s, i);
+            if (first < 0 || second < 0) continue;
+            growth.exponent[s] = std::min(first, second);
+            break;
+        }
+    }
+    return growth;
+}
+
+/**
+ * Smallest size where the stage still grows above the threshold for two doublings
+ */
+static size_t minimalSize(const Growth& growth, int stage, double threshold) {
+    for (size_t i = 2; i < growth.sizes.size(); i++) {
+        if (exponentAt(growth, stage, i - 1) > threshold && exponentAt(growth, stage, i) > threshold) {
+            return growth.sizes[i];
+        }
+    }
+    return growth.sizes.back();
+}
+
+/**
+ * Command line options, see the usage at the top of the file
+ */
+struct Options {
+    size_t randomFamilies = 20;
+    unsigned seed = 1;
+    std::string corpus = "tools/perfcorpus";
+    double threshold = 1.7;
+    int optimizationLevel = 1;
+    std::string replay;
+    double budget = 0;
+};
+
+static bool parseOptions(int argc, char* argv[], Options& options) {
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg.rfind("--random=", 0) == 0) {
+                options.randomFamilies = std::stoull(arg.substr(9));
+            } else if (arg.rfind("--seed=", 0) == 0) {
+                options.seed = static_cast<unsigned>(std::stoul(arg.substr(7)));
+            } else if (arg.rfind("--corpus=", 0) == 0) {
+                options.corpus = arg.substr(9);
+            } else if (arg.rfind("--threshold=", 0) == 0) {
+                options.threshold = std::stod(arg.substr(12));
+            } else if (arg.rfind("--opt-level=", 0) == 0) {
+                options.optimizationLevel = std::stoi(arg.substr(12));
+                if (options.optimizationLevel != 0 && options.optimizationLevel != 1) return false;
+            } else if (arg.rfind("--replay=", 0) == 0) {
+                options.replay = arg.substr(9);
+            } else if (arg.rfind("--budget=", 0) == 0) {
+                options.budget = std::stod(arg.substr(9));
+            } else {
+                return false;
+            }
+        }
+    } catch (const std::exception&) {
+        return false;
+    }
+    return options.threshold > 1;
+}
+
+/**
+ * Measures every program of the corpus and prints its cost per byte for every stage
+ */
+static int replay(const Options& options) {
+    bool overBudget = false;
+    std::vector<fs::path> files;
+    for (const auto& entry : fs::directory_iterator(options.replay)) {
+        if (entry.path().extension() == ".txt") files.push_back(entry.path());
+    }
+    std::sort(files.begin(), files.end());
+
+    for (const auto& file : files) {
+        std::ifstream input(file, std::ios::binary);
+        std::stringstream buffer;
+        buffer << input.rdbuf();
+        std::string source = buffer.str();
+
+        Cost cost = measure(source, options.optimizationLevel);
+        std::cout << file.filename().string() << " (" << source.size() << " bytes):";
+        for (int s = 0; s < STAGES; s++) {
+            double perByte = cost.seconds[s] * 1e9 / std::max<size_t>(source.size(), 1);
+            std::cout << " " << STAGE_NAMES[s] << " " << perByte << " ns/byte";
+            if (options.budget > 0 && perByte > options.budget) {
+                std::cout << " (over budget)";
+                overBudget = true;
+            }
+        }
+        std::cout << "\n";
+    }
+    return overBudget ? 1 : 0;
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0]
+                  << " [--random=N] [--seed=S] [--corpus=DIR] [--threshold=E] [--opt-level=0|1]"
+                  << " | --replay=DIR [--budget=NANOSECONDS] [--opt-level=0|1]" << std::endl;
+        return 2;
+    }
+    if (!options.replay.empty()) {
+        return replay(options);
+    }
+
+    std::vector<Family> families = fixedFamilies();
+    std::vector<std::vector<std::string>> fragments(families.size());
+
+    std::mt19937 random(options.seed);
+    for (size_t i = 0; i < options.randomFamilies; i++) {
+        std::vector<std::string> fragment;
+        families.push_back(randomFamily(random, i, fragment));
+        fragments.push_back(fragment);
+    }
+
+    size_t flagged = 0;
+    for (size_t f = 0; f < families.size(); f++) {
+        const Growth measured = analyze(families[f], options.optimizationLevel);
+
+        std::cout << families[f].name << ": up to " << measured.bytes.back() << " bytes,";
+        for (int s = 0; s < STAGES; s++) {
+            std::cout << " " << STAGE_NAMES[s] << " " << measured.exponent[s];
+        }
+        std::cout << "\n";
+
+        for (int s = 0; s < STAGES; s++) {
+            if (measured.exponent[s] <= options.threshold) continue;
+            flagged++;
+
+            Family family = families[f];
+            Growth growth = measured;
+            std::vector<std::string> fragment = fragments[f];
+            for (size_t i = 0; i < fragment.size() && fragment.size() > 1;) {
+                std::vector<std::string> smaller = fragment;
+                smaller.erase(smaller.begin() + i);
+                std::string body;
+                for (const auto& statement : smaller) body += statement;
+                Family candidate = {family.name, [body](size_t n) { return RANDOM_PREFIX + repeat(body, n); }};
+                Growth candidateGrowth = analyze(candidate, options.optimizationLevel);
+                if (candidateGrowth.exponent[s] > options.threshold) {
+                    fragment = smaller;
+                    family = candidate;
+                    growth = candidateGrowth;
+                } else {
+                    i++;
+                }
+            }
+
+            size_t size = minimalSize(growth, s, options.threshold);
+            fs::create_directories(options.corpus);
+            fs::path file = fs::path(options.corpus) /
+                            (family.name + "." + STAGE_NAMES[s] + ".n" + std::to_string(size) + ".txt");
+            std::ofstream output(file, std::ios::binary | std::ios::trunc);
+            output << family.build(size);
+
+            std::cout << "  SUPERLINEAR " << STAGE_NAMES[s] << " (exponent " << growth.exponent[s]
+                      << "), saved " << file.string() << "\n";
+        }
+    }
+
+    std::cout << families.size() << " families, " << flagged << " superlinear stages" << std::endl;
+    return flagged == 0 ? 0 : 1;
+}
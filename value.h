@@ -0,0 +1,183 @@
+/**
+ * Guard Headers
+ */
+#ifndef VALUE_H
+#define VALUE_H
+
+/**
+ * Include for std::variant used in Value to store int, bool or list in one 
+ * 
+ * Include fot std::runtime_error used as base for RuntimeError
+ * 
+ * Include for std::string used by toString
+ *
+ * Include for Dict used inside Value to represent dictionaries
+ *
+ * Include for List used inside Value to represent lists
+ *
+ * Include for Matrix used inside Value to represent matrices
+ *
+ * Include for placement new used by the appends of List
+ */
+#include <new>
+#include <variant>
+#include <stdexcept>
+#include <string>
+#include "dict.h"
+#include "list.h"
+#include "matrix.h"
+
+/**
+ * Expetion for runtime errors
+ * 
+ * Inherits from std::runtime_error and prefixes the message with "Error:"
+ */
+class RuntimeError : public std::runtime_error {
+public:
+    RuntimeError(const std::string& message) : std::runtime_error("Error: " + message) {}
+};
+
+/**
+ * Rapresents a value in the Interpreter (interger, boolean, list, dictionary or matrix)
+ */
+class Value {
+public:
+    enum Type { INTEGER, BOOLEAN, LIST, DICT, MATRIX, UNDEFINED };
+    
+    Type type;
+    std::variant<int, bool, List, Dict, Matrix> data;
+    
+    Value() : type(UNDEFINED) {}
+    Value(int i) : type(INTEGER), data(i) {}
+    Value(bool b) : type(BOOLEAN), data(b) {}
+    Value(const List& l) : type(LIST), data(l) {}
+    Value(List&& l) : type(LIST), data(std::move(l)) {}
+    Value(Dict&& d) : type(DICT), data(std::move(d)) {}
+    Value(Matrix&& m) : type(MATRIX), data(std::move(m)) {}
+
+    int getInt() const {
+        if (type != INTEGER) throw RuntimeError("Expected integer value");
+        return std::get<int>(data);
+    }
+    
+    bool getBool() const {
+        if (type != BOOLEAN) throw RuntimeError("Expected boolean value");
+        return std::get<bool>(data);
+    }
+    
+    List& getList() {
+        if (type != LIST) throw RuntimeError("Expected list value");
+        return std::get<List>(data);
+    }
+    
+    const List& getList() const {
+        if (type != LIST) throw RuntimeError("Expected list value");
+        return std::get<List>(data);
+    }
+
+    Dict& getDict() {
+        if (type != DICT) throw RuntimeError("Expected dictionary value");
+        return std::get<Dict>(data);
+    }
+
+    const Dict& getDict() const {
+        if (type != DICT) throw RuntimeError("Expected dictionary value");
+        return std::get<Dict>(data);
+    }
+
+    Matrix& getMatrix() {
+        if (type != MATRIX) throw RuntimeError("Expected matrix value");
+        return std::get<Matrix>(data);
+    }
+
+    const Matrix& getMatrix() const {
+        if (type != MATRIX) throw RuntimeError("Expected matrix value");
+        return std::get<Matrix>(data);
+    }
+    
+    std::string toString() const {
+        switch (type) {
+            case INTEGER: return std::to_string(getInt());
+            case BOOLEAN: return getBool() ? "True" : "False";
+            case LIST: {
+                const auto& list = getList();
+                std::string result = "[";
+                for (size_t i = 0; i < list.size(); i++) {
+                    if (i > 0) result += ", ";
+                    result += list[i].toString();
+                }
+                result += "]";
+                return result;
+            }
+            case DICT: return getDict().toString();
+            case MATRIX: {
+                const auto& matrix = getMatrix();
+                std::string result = "[";
+                for (int i = 0; i < matrix.rows(); i++) {
+                    if (i > 0) result += ", ";
+                    result += "[";
+                    for (int j = 0; j < matrix.columns(); j++) {
+                        if (j > 0) result += ", ";
+                        result += std::to_string(matrix.at(i, j));
+                    }
+                    result += "]";
+                }
+                result += "]";
+                return result;
+            }
+            case UNDEFINED: return "undefined";
+        }
+        return "unknown";
+    }
+};
+
+/**
+ * Entry of a dictionary, defined here because it needs the complete Value
+ */
+struct Dict::Entry {
+    uint64_t key;
+    Value value;
+};
+
+/**
+ * Members of List that need the complete Value
+ */
+inline Value* List::end() {
+    return elements + count;
+}
+
+inline const Value* List::end() const {
+    return elements + count;
+}
+
+inline Value& List::operator[](size_t index) {
+    return elements[index];
+}
+
+inline const Value& List::operator[](size_t index) const {
+    return elements[index];
+}
+
+/**
+ * Appends of List
+ * When the buffer is full the value is moved out first, it may be an element of the same list
+ */
+inline void List::push_back(Value&& value) {
+    if (count == capacity) {
+        appendSlow(std::move(value));
+        return;
+    }
+    new (elements + count) Value(std::move(value));
+    count++;
+}
+
+inline void List::push_back(const Value& value) {
+    if (count == capacity) {
+        appendSlow(Value(value));
+        return;
+    }
+    new (elements + count) Value(value);
+    count++;
+}
+
+#endif // VALUE_H